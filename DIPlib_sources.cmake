@@ -38,6 +38,7 @@ include/diplib/math.h
 include/diplib/measurement.h
 include/diplib/microscopy.h
 include/diplib/morphology.h
+include/diplib/multithreading.h
 include/diplib/neighborlist.h
 include/diplib/nonlinear.h
 include/diplib/overload.h
@@ -91,6 +92,7 @@ src/library/image_data.cpp
 src/library/image_indexing.cpp
 src/library/image_manip.cpp
 src/library/image_views.cpp
+src/library/multithreading.cpp
 src/library/neighborhood.cpp
 src/library/physical_dimensions.cpp
 src/library/pixel_table.cpp
@@ -109,6 +111,7 @@ src/math/bitwise.cpp
 src/math/comparison.cpp
 src/math/dyadic_operators.cpp
 src/math/error.cpp
+src/math/integral_image.cpp
 src/math/mapping.cpp
 src/math/monadic_operators.cpp
 src/math/pixel.cpp
@@ -174,6 +177,8 @@ src/nonlinear/variancefilter.cpp
 src/regions/get_labels.cpp
 src/regions/label.cpp
 src/regions/labelingGrana2016.h
+src/regions/map_labels.cpp
+src/regions/map_labels.h
 src/segmentation/threshold.cpp
 src/support/math_functions.cpp
 src/support/matrix.cpp
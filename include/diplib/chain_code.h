@@ -519,7 +519,10 @@ class DIP_NO_EXPORT ConvexHull {
          return vertices_.Length();
       }
 
-      /// Returns the %Feret diameters of the convex hull
+      /// \brief Returns the %Feret diameters of the convex hull.
+      ///
+      /// The values are exact, computed with the rotating calipers algorithm in time linear in the
+      /// number of vertices of the convex hull.
       DIP_EXPORT FeretValues Feret() const;
 
       /// Returns the centroid of the convex hull
@@ -648,6 +651,7 @@ struct DIP_NO_EXPORT ChainCode {
    VertexInteger start = { 0, 0 };  ///< The coordinates of the start pixel
    dip::uint objectID;              ///< The label of the object from which this chain code is taken
    bool is8connected = true;        ///< Is false when connectivity = 1, true when connectivity = 2
+   bool isHole = false;             ///< Is true when the chain code traces the boundary of a hole in the object
 
    /// Adds a code to the end of the chain.
    void Push( Code const& code ) { codes.push_back( code ); }
@@ -676,7 +680,7 @@ struct DIP_NO_EXPORT ChainCode {
    DIP_EXPORT dfloat Length() const;
 
    /// \brief Returns the %Feret diameters, using an angular step size in radian of `angleStep`.
-   /// It is better to use `this->ConvexHull().Feret()`.
+   /// It is better to use `this->ConvexHull().Feret()`, which is faster and exact.
    DIP_EXPORT FeretValues Feret( dfloat angleStep ) const;
 
    /// Computes the bending energy.
@@ -747,14 +751,24 @@ using ChainCodeArray = std::vector< ChainCode >;
 /// \brief Returns the set of chain codes sequences that encode the contours of the given objects in a labeled image.
 ///
 /// Note that only the first closed contour for each label is found; if an object has multiple connected components,
-/// only part of it is found. The chain code traces the outer perimeter of the object, holes are ignored.
+/// only part of it is found. The chain code traces the outer perimeter of the object.
 ///
 /// `objectIDs` is a list with object IDs present in the labeled image. If an empty array is given, all objects in
-/// the image are used.
+/// the image are used. The output has one chain code for each object ID, in the same order.
+///
+/// If `holes` is `"include"`, the boundaries of the holes in each object are traced as well. These chain codes
+/// are appended to the output array, after the chain codes for the outer perimeters, and have their
+/// `dip::ChainCode::isHole` flag set. A hole is a region of the image not part of the object and not
+/// connected to the outside of the object (using the complementary connectivity). Holes can contain
+/// other objects. By default, `holes` is `"exclude"`, and holes are ignored.
+///
+/// The image is scanned once to find the start pixel of all objects. The objects are then traced
+/// independently, in parallel if possible (see \ref multithreading).
 ChainCodeArray DIP_NO_EXPORT GetImageChainCodes(
       Image const& labels,             ///< Labeled image, unsigned integer type
       UnsignedArray const& objectIDs,  ///< A list of object IDs to get chain codes for
-      dip::uint connectivity = 2       ///< Connectivity, see \ref connectivity
+      dip::uint connectivity = 2,      ///< Connectivity, see \ref connectivity
+      String const& holes = "exclude"  ///< Whether to trace holes: `"include"` or `"exclude"`
 );
 
 /// \brief Returns the chain codes sequence that encodes the contour of one object in a binary or labeled image.
@@ -38,7 +38,7 @@ namespace dip {
 
 /// \brief Euclidean distance transform
 ///
-/// This function computes the Euclidean distance transform of a 2D or 3D input binary image using the vector-based
+/// This function computes the Euclidean distance transform of an input binary image using the vector-based
 /// method as opposed to the chamfer method. This method computes distances from the objects (binary 1's) to
 /// the nearest background (binary 0's) of `in` and stored the result in `out`. `out` is of type `dip::DT_SFLOAT`.
 ///
@@ -53,9 +53,15 @@ namespace dip {
 ///  - `"fast"`: fastest, but most errors.
 ///  - `"ties"`: slower, but fewer errors.
 ///  - `"true"`: slow, uses lots of memory, but is "error free".
+///  - `"separable"`: exact, computes the squared distance along each image dimension in turn, using the lower
+///                   envelope of parabolas. Its cost is linear in the number of pixels.
 ///  - `"brute force"`: gives a result from which errors are calculated for the other methods. This method is
 ///                     extremely slow and should only be used for testing purposes.
 ///
+/// The `"separable"` method works for images of any dimensionality, the other methods support only 2D and 3D images.
+/// The `"separable"` method produces the same result as the `"true"` method, but is much faster and uses little
+/// memory. With `border` set to `"object"`, pixels in an image without background pixels are set to infinity.
+///
 /// Individual vector components of the Euclidean distance transform can be obtained with `dip::VectorDistanceTransform`.
 ///
 /// **Literature**
@@ -63,6 +69,7 @@ namespace dip {
 ///  - J.C. Mullikin, "The vector distance transform in two and three dimensions", CVGIP: Graphical Models and Image Processing 54(6):526-535, 1992.
 ///  - I. Ragnemalm, "Generation of Euclidean Distance Maps", Licentiate thesis, No. 206, Link&ouml;ping University, Sweden, 1990.
 ///  - Q.Z. Ye, "The signed Euclidean distance transform and its applications", in: 9th International Conference on Pattern Recognition, 495-499, 1988.
+///  - P.F. Felzenszwalb and D.P. Huttenlocher, "Distance Transforms of Sampled Functions", Theory of Computing 8:415-428, 2012.
 ///
 /// **Known bugs**
 ///  - The `"true"` transform type is prone to produce an internal buffer overflow when applied to larger (almost)
@@ -114,7 +121,10 @@ inline Image VectorDistanceTransform(
 /// the integral of `grey` along a path from each pixel that is set in `in` (foreground) to any pixel that is not set
 /// in `in` (background), with the path chosen such that this integral is minimal.
 ///
-/// The implemented algorithm uses a heap sort for sorting the pixels to be processed.
+/// The pixels to be processed are kept in a bucket queue (Dial's algorithm) with buckets as wide as the smallest
+/// step cost, if the ratio of largest to smallest step cost is not too large. This is the case for
+/// integer-valued `grey` images without zeros, for example. Otherwise, a heap is used. Both give the same result,
+/// but the bucket queue is faster. The images can have any number of dimensions.
 ///
 /// The images `in` and `grey` must have the same sizes. `in` is a binary image, `grey` is real-valued, and both
 /// must be scalar. `out` will have type `dip::DT_SFLOAT`.
@@ -21,6 +21,8 @@
 #ifndef DIP_FILE_IO_H
 #define DIP_FILE_IO_H
 
+#include <functional>
+
 #include "diplib.h"
 
 
@@ -67,6 +69,12 @@ struct FileInformation {
 /// interface set it might also be impossible to dictate what the stides will look like. In these cases,
 /// the flag is ignored.
 ///
+/// If `mode` is `"mmap"`, and the pixel data in the file is not compressed and is stored in the byte order
+/// of the machine, the file is mapped into memory instead of read. `out` then refers to the mapped file,
+/// with strides set according to the dimension order in the file (and the ROI, if given). No pixel data is
+/// copied, data is loaded from disk when it is accessed. Modifying `out` does not modify the file. If the file
+/// cannot be mapped, or if `out` is protected or has an external interface, the flag is ignored.
+///
 /// Information about the file and all metadata is returned in the `FileInformation` output argument.
 // TODO: read sensor information also into the history strings
 DIP_EXPORT FileInformation ImageReadICS(
@@ -175,37 +183,102 @@ DIP_EXPORT void ImageWriteICS(
 /// If the range indicates a single page, it is read as a 2D image. In this case, `{0}` is the first
 /// image. Some Zeiss confocal microscopes write TIFF files (with an ".lsm" extension) in which image
 /// planes and thumbnails alternate. A range such as {0,-1,2} reads all image planes skipping the
-/// thumbnails.
+/// thumbnails. Files with more than 65535 pages can only be read with libtiff 4.5 or newer. When reading
+/// many pages, these are read in parallel (see \ref multithreading).
+///
+/// `roi` can be set to read in a subset of the pixels in each image plane. If only one array element is given,
+/// it is used for both dimensions. An empty array indicates that all pixels should be read. Otherwise, the array
+/// should have two elements. Only the strips or tiles in the file that overlap the ROI are read and decompressed,
+/// so that reading a small region out of a large image is inexpensive.
 ///
 /// The pixels per inch value in the TIFF file will be used to set the pixel size of `out`.
 ///
+/// Both striped and tiled TIFF files are read. Compressed strips and tiles are decoded in parallel
+/// (see \ref multithreading).
+///
 /// TIFF is a very flexible file format. We have to limit the types of images that can be read to the
 /// more common ones. These are the most obvious limitations:
-///  - Tiled images are not supported.
 ///  - Only 1, 4, 8, 16 and 32 bits per pixel integer grayvalues are read, as well as 32-bit and 64-bit
 ///    floating point.
 ///  - Only 4 and 8 bits per pixel colormapped images are read.
 ///  - Class Y images (YCbCr) and Log-compressed images (LogLuv or LogL) are not supported.
-// TODO: Support tiled images, and reading ROIs from them.
 // TODO: Option to read an indexed image without applying the color map, and reading in the color map separately.
 DIP_EXPORT FileInformation ImageReadTIFF(
       Image& out,
       String const& filename,
-      Range imageNumbers = Range{ 0 }
+      Range imageNumbers = Range{ 0 },
+      RangeArray roi = {}
 );
 inline Image ImageReadTIFF(
       String const& filename,
-      Range const& imageNumbers = Range{ 0 }
+      Range const& imageNumbers = Range{ 0 },
+      RangeArray const& roi = {}
 ) {
    Image out;
-   ImageReadTIFF( out, filename, imageNumbers );
+   ImageReadTIFF( out, filename, imageNumbers, roi );
    return out;
 }
 
+/// \brief This function is an overload of the previous function that defines the ROI using different
+/// parameters.
+///
+/// The parameters `origin` and `sizes` define a ROI to read in, and `spacing` can be used to read in a
+/// subset of the pixels of the chosen ROI. These are handled as in the equivalent overload of
+/// `dip::ImageReadICS`, but can have at most two elements.
+///
+/// Information about the file and all metadata is returned in the `FileInformation` output argument.
+DIP_EXPORT FileInformation ImageReadTIFF(
+      Image& out,
+      String const& filename,
+      Range const& imageNumbers,
+      UnsignedArray const& origin,
+      UnsignedArray const& sizes = {},
+      UnsignedArray const& spacing = {}
+);
+inline Image ImageReadTIFF(
+      String const& filename,
+      Range const& imageNumbers,
+      UnsignedArray const& origin,
+      UnsignedArray const& sizes = {},
+      UnsignedArray const& spacing = {}
+) {
+   Image out;
+   ImageReadTIFF( out, filename, imageNumbers, origin, sizes, spacing );
+   return out;
+}
+
+/// \brief A function that processes one image plane read from a TIFF file, see `dip::ImageReadTIFFPages` and
+/// `dip::ImageReadTIFFSeries`.
+///
+/// `plane` is the image plane read, and `index` is its position in the sequence being read (0 for the first
+/// plane). Each call receives a newly allocated image, so `plane` can be modified or kept.
+using TIFFPlaneFunction = std::function< void( Image& plane, dip::uint index ) >;
+
+/// \brief Reads pages from the TIFF file `filename` one at a time, calling `function` for each one.
+///
+/// `imageNumbers` and `roi` are as in `dip::ImageReadTIFF`. Each page selected by `imageNumbers` is read as
+/// a 2D image and passed to `function`, in the order given by the range. While `function` processes one page,
+/// the next page is read in a separate thread, so that processing and reading overlap. Only two pages are
+/// held in memory at any one time, which makes it possible to process stacks that do not fit in memory.
+/// `function` is always called from the calling thread, and can itself use multiple threads. If multithreading
+/// is disabled (see \ref multithreading), reading and processing do not overlap.
+///
+/// Unlike with `dip::ImageReadTIFF`, the pages need not all have the same sizes and data type.
+DIP_EXPORT void ImageReadTIFFPages(
+      String const& filename,
+      Range imageNumbers,
+      TIFFPlaneFunction const& function,
+      RangeArray const& roi = {}
+);
+
 /// \brief Reads a set of 2D TIFF images as a single 3D image.
 ///
 /// `filenames` contains the paths to the TIFF files, which are read in the order given, and concatenated along the 3rd
-/// dimension. Only the first page of each TIFF file is read.
+/// dimension. Only the first page of each TIFF file is read, use `dip::ImageReadTIFFPages` to read all pages of
+/// each file.
+///
+/// The files are opened and read in parallel (see \ref multithreading), each directly into its slice of `out`.
+/// This avoids being limited by the latency of the file system when reading many small files.
 DIP_EXPORT void ImageReadTIFFSeries(
       Image& out,
       StringArray const& filenames
@@ -218,6 +291,16 @@ inline Image ImageReadTIFFSeries(
    return out;
 }
 
+/// \brief Reads a set of 2D TIFF images one at a time, calling `function` for each one.
+///
+/// `filenames` contains the paths to the TIFF files, which are read in the order given. Only the first page of
+/// each TIFF file is read. As with `dip::ImageReadTIFFPages`, the next file is read in a separate thread while
+/// `function` processes the current one, and the images need not all have the same sizes and data type.
+DIP_EXPORT void ImageReadTIFFSeries(
+      StringArray const& filenames,
+      TIFFPlaneFunction const& function
+);
+
 /// \brief Reads image information and metadata from the TIFF file `filename`, without reading the actual
 /// pixel data.
 DIP_EXPORT FileInformation ImageReadTIFFInfo( String const& filename, dip::uint imageNumber = 0 );
@@ -249,6 +332,8 @@ DIP_EXPORT bool ImageIsTIFF( String const& filename );
 ///    by compliant TIFF readers. Even small amounts of noise can cause this method to yield larger files than `"none"`.
 ///  - `"JPEG"`: uses **lossy** JPEG compression. `jpegLevel` determines the amount of compression applied. `jpegLevel`
 ///    is an integer between 1 and 100, with increasing numbers yielding larger files and fewer compression artifacts.
+///
+/// With `"deflate"`, `"LZW"` and `"PackBits"` compression, strips are compressed in parallel (see \ref multithreading).
 DIP_EXPORT void ImageWriteTIFF(
       Image const& image,
       String const& filename,
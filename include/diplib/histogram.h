@@ -204,6 +204,23 @@ class DIP_NO_EXPORT Histogram {
          DIP_END_STACK_TRACE
       }
 
+      /// \brief The constructor takes configuration options for each histogram dimension, and creates an
+      /// empty histogram (all bins are zero).
+      ///
+      /// Use `Add` to accumulate data into the histogram, for example to compute the histogram over a
+      /// set of images that do not fit in memory together. The configuration cannot have `lowerIsPercentile`
+      /// or `upperIsPercentile` set, as there is no data to compute the percentiles from.
+      explicit Histogram( ConfigurationArray configuration ) {
+         DIP_THROW_IF( configuration.empty(), E::ARRAY_ILLEGAL_SIZE );
+         DIP_STACK_TRACE_THIS( EmptyHistogram( configuration ));
+      }
+
+      /// \brief This version of the constructor is identical to the previous one, but creates a 1D histogram.
+      explicit Histogram( Configuration const& configuration ) {
+         ConfigurationArray newConfig{ configuration };
+         DIP_STACK_TRACE_THIS( EmptyHistogram( newConfig ));
+      }
+
       /// \brief Adds a histogram to *this. `other` must have identical properties.
       ///
       /// Adding multiple histograms together can be useful, for example, when accumulating pixel values
@@ -216,6 +233,43 @@ class DIP_NO_EXPORT Histogram {
          return *this;
       }
 
+      /// \brief Merges a histogram into *this, identical to `operator+=`. `other` must have identical properties.
+      ///
+      /// Histograms computed with the same configuration on different parts of the data (tiles, frames, or in
+      /// different threads or processes, see `Serialize`) can be merged to obtain the histogram of all the data.
+      Histogram& Merge( Histogram const& other ) {
+         return *this += other;
+      }
+
+      /// \brief Adds the pixels in `input` (optionally only those selected by `mask`) to the histogram.
+      ///
+      /// The pixels are binned with the same bins as the histogram already has, `input` must have as many tensor
+      /// elements as the histogram has dimensions. This is equivalent to merging in a histogram computed with the
+      /// configuration returned by `GetConfiguration`.
+      ///
+      /// Note that bin counts are 32-bit unsigned integers. The sum of histograms saturates, but a single call
+      /// to `Add` should not add more than 2<sup>32</sup>-1 pixels to a bin.
+      DIP_EXPORT void Add( Image const& input, Image const& mask = {} );
+
+      /// \brief Adds the pixel pairs in `input1` and `input2` (optionally only those selected by `mask`) to the
+      /// 2D histogram, as would be computed by the joint histogram constructor.
+      DIP_EXPORT void Add( Image const& input1, Image const& input2, Image const& mask );
+
+      /// \brief Returns the configuration for each histogram dimension.
+      ///
+      /// The configuration describes exactly the bins of this histogram; a histogram computed with it
+      /// will have identical properties and can be merged with this one.
+      DIP_EXPORT ConfigurationArray GetConfiguration() const;
+
+      /// \brief Writes the histogram to a stream in a compact binary form.
+      ///
+      /// The format is independent of the platform's byte order, so that histograms can be computed on
+      /// different machines and merged afterwards. Use `Deserialize` to read it back in.
+      DIP_EXPORT void Serialize( std::ostream& os ) const;
+
+      /// \brief Reads a histogram written by `Serialize` from a stream.
+      DIP_EXPORT static Histogram Deserialize( std::istream& is );
+
       /// \brief Returns the histogram dimensionality.
       dip::uint Dimensionality() const { return data_.Dimensionality(); }
 
@@ -391,6 +445,7 @@ class DIP_NO_EXPORT Histogram {
       Image data_;             // This is where the bins are stored. Always scalar and DT_UINT32.
       FloatArray lowerBounds_; // These are the lower bounds of the histogram along each dimension.
       FloatArray binSizes_;    // These are the sizes of the bins along each dimension.
+      BooleanArray excludeOutOfBoundValues_; // These are the `excludeOutOfBoundValues` settings for each dimension.
       // Compute the upper bound by : lowerBounds_[ii] + binSizes_[ii]*data_.Sizes(ii).
       // data_.Dimensionality() == lowerBounds_.size() == binSizes_.size()
       // Lower and upper bounds are not bin centers!
@@ -403,6 +458,9 @@ class DIP_NO_EXPORT Histogram {
          return static_cast< dip::uint >( bin );
       }
 
+      Histogram() = default; // Used by `Deserialize`.
+
+      DIP_EXPORT void EmptyHistogram( ConfigurationArray& configuration );
       DIP_EXPORT void ScalarImageHistogram( Image const& input, Image const& mask, Configuration& configuration );
       DIP_EXPORT void TensorImageHistogram( Image const& input, Image const& mask, ConfigurationArray& configuration );
       DIP_EXPORT void JointImageHistogram( Image const& input1, Image const& input2, Image const& mask, ConfigurationArray& configuration );
@@ -28,8 +28,10 @@
 #ifndef DIP_NUMERIC_H
 #define DIP_NUMERIC_H
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
+#include <vector>
 
 #include "diplib/library/sample_iterator.h"
 
@@ -533,6 +535,14 @@ class DIP_NO_EXPORT StatisticsAccumulator {
 
       /// Combine two accumulators
       StatisticsAccumulator& operator+=( StatisticsAccumulator const& b ) {
+         // Merging with an empty accumulator: the formulae below would divide 0 by 0
+         if( b.n_ == 0 ) {
+            return *this;
+         }
+         if( n_ == 0 ) {
+            *this = b;
+            return *this;
+         }
          dfloat an = static_cast< dfloat >( n_ );
          dfloat an2 = an * an;
          dfloat bn = static_cast< dfloat >( b.n_ );
@@ -652,6 +662,14 @@ class DIP_NO_EXPORT VarianceAccumulator {
 
       /// Combine two accumulators
       VarianceAccumulator& operator+=( VarianceAccumulator const& b ) {
+         // Merging with an empty accumulator: the formulae below would divide 0 by 0
+         if( b.n_ == 0 ) {
+            return *this;
+         }
+         if( n_ == 0 ) {
+            *this = b;
+            return *this;
+         }
          dfloat oldn = static_cast< dfloat >( n_ );
          n_ += b.n_;
          dfloat n = static_cast< dfloat >( n_ );
@@ -817,6 +835,71 @@ inline MinMaxAccumulator operator+( MinMaxAccumulator lhs, MinMaxAccumulator con
 }
 
 
+/// \brief `%KahanAccumulator` computes the sum of a sequence of values using compensated summation.
+///
+/// Samples are added one by one, using the `Push` method. The `Sum` method retrieves the result.
+///
+/// A plain floating-point sum of `n` values has a worst-case relative error proportional to `n`; when adding
+/// \f$ 10^{10} \f$ samples this error can be significant even in double precision, and catastrophic in single
+/// precision. This accumulator keeps a running compensation term for the low-order bits lost in each addition,
+/// so that the error is independent of `n` (Neumaier's improvement of Kahan summation, which is also correct
+/// when a new value is larger in magnitude than the running sum). The cost is three additional floating-point
+/// operations per sample.
+///
+/// It is possible to accumulate samples in different objects (e.g. when processing with multiple threads),
+/// and add the accumulators together using the `+` operator.
+///
+/// Note that compiling with value-unsafe floating-point optimizations (e.g. `-ffast-math`) removes the
+/// compensation.
+///
+/// \see StatisticsAccumulator, MomentAccumulator
+///
+/// **Literature**
+/// - A. Neumaier, "Rundungsfehleranalyse einiger Verfahren zur Summation endlicher Summen",
+///   Zeitschrift für Angewandte Mathematik und Mechanik 54(1):39-51, 1974.
+class DIP_NO_EXPORT KahanAccumulator {
+   public:
+      /// Reset the accumulator, leaving it as if newly allocated.
+      void Reset() {
+         sum_ = 0.0;
+         c_ = 0.0;
+      }
+
+      /// Add a sample to the accumulator
+      void Push( dfloat x ) {
+         dfloat t = sum_ + x;
+         if( std::abs( sum_ ) >= std::abs( x )) {
+            c_ += ( sum_ - t ) + x;
+         } else {
+            c_ += ( x - t ) + sum_;
+         }
+         sum_ = t;
+      }
+
+      /// Combine two accumulators
+      KahanAccumulator& operator+=( KahanAccumulator const& other ) {
+         Push( other.sum_ );
+         c_ += other.c_;
+         return *this;
+      }
+
+      /// Sum of all samples
+      dfloat Sum() const {
+         return sum_ + c_;
+      }
+
+   private:
+      dfloat sum_ = 0.0;   // running sum
+      dfloat c_ = 0.0;     // compensation, the sum of the rounding errors in `sum_`
+};
+
+/// \brief Combine two accumulators
+inline KahanAccumulator operator+( KahanAccumulator lhs, KahanAccumulator const& rhs ) {
+   lhs += rhs;
+   return lhs;
+}
+
+
 /// \brief `%MomentAccumulator` accumulates the zeroth order moment, the first order normalized moments, and the
 /// second order central normalized moments, in `N` dimensions.
 ///
@@ -963,6 +1046,156 @@ inline MomentAccumulator operator+( MomentAccumulator lhs, MomentAccumulator con
 }
 
 
+/// \brief `%QuantileAccumulator` computes approximate quantiles of a sequence of values in a single pass, using
+/// memory that grows only logarithmically with the number of values.
+///
+/// Samples are added one by one, using the `Push` method. Quantiles are retrieved with `Quantile` or `Percentile`.
+///
+/// The accumulator is a KLL-style sketch (Karnin, Lang and Liberty, "Optimal Quantile Approximation in Streams",
+/// FOCS 2016). Samples are collected in a stack of compactors, each of which can hold `k` samples. When a compactor
+/// is full, it is sorted, and every other sample (starting at a random offset) is promoted to the next compactor,
+/// where it represents twice as many input samples; the other half is discarded. With `n` samples, there are
+/// \f$ H \approx \log_2(n/k) \f$ compactors, and memory use is \f$ O(k \log(n/k)) \f$: at most \f$ k (H+1) \f$ values.
+///
+/// The returned quantile has a rank that differs from the requested rank by at most \f$ H n / k \f$ (each
+/// compactor level contributes at most \f$ n / k \f$ rank error). Because the compaction offsets are random,
+/// errors tend to cancel, and the typical rank error is of the order of \f$ \sqrt{H} n / k \f$. For example,
+/// with the default `k` = 2048 and \f$ 10^9 \f$ samples, the rank error is at most 0.9%, and is typically about
+/// 0.2%. While fewer than `k` samples have been pushed, the result is exact.
+///
+/// It is possible to accumulate samples in different objects (e.g. when processing with multiple threads),
+/// and add the accumulators together using the `+` operator. The error bounds above hold for the combined
+/// accumulator (Agarwal et al., "Mergeable Summaries", ACM TODS 38(4), 2013).
+///
+/// The random offsets are generated by a deterministic generator, so results are reproducible for a given
+/// sequence of operations.
+///
+/// NaN samples cannot be ordered, and are ignored: they are not counted in `Number`.
+///
+/// \see StatisticsAccumulator, MinMaxAccumulator
+class DIP_NO_EXPORT QuantileAccumulator {
+   public:
+      /// \brief The constructor determines the capacity `k` of each compactor. It is rounded up to an even value,
+      /// and to at least 8.
+      explicit QuantileAccumulator( dip::uint k = 2048 ) : k_( std::max< dip::uint >( k + ( k & 1u ), 8 )) {
+         levels_.resize( 1 );
+      }
+
+      /// Reset the accumulator, leaving it as if newly allocated.
+      void Reset() {
+         levels_.clear();
+         levels_.resize( 1 );
+         n_ = 0;
+      }
+
+      /// Add a sample to the accumulator
+      void Push( dfloat x ) {
+         if( std::isnan( x )) {
+            return; // NaN would break the ordering used when sorting
+         }
+         levels_[ 0 ].push_back( x );
+         ++n_;
+         if( levels_[ 0 ].size() >= k_ ) {
+            Compress();
+         }
+      }
+
+      /// Combine two accumulators
+      QuantileAccumulator& operator+=( QuantileAccumulator const& other ) {
+         if( levels_.size() < other.levels_.size() ) {
+            levels_.resize( other.levels_.size() );
+         }
+         for( dip::uint ii = 0; ii < other.levels_.size(); ++ii ) {
+            levels_[ ii ].insert( levels_[ ii ].end(), other.levels_[ ii ].begin(), other.levels_[ ii ].end() );
+         }
+         n_ += other.n_;
+         Compress();
+         return *this;
+      }
+
+      /// Number of samples
+      dip::uint Number() const {
+         return n_;
+      }
+
+      /// Capacity `k` of each compactor
+      dip::uint Capacity() const {
+         return k_;
+      }
+
+      /// \brief Approximate quantile, `fraction` is in the range [0,1]. Returns the sample with rank
+      /// `floor( fraction * Number() )`, with the rank error described above. Returns 0 if there are no samples.
+      dfloat Quantile( dfloat fraction ) const {
+         if( n_ == 0 ) {
+            return 0.0;
+         }
+         std::vector< std::pair< dfloat, dip::uint >> items;
+         for( dip::uint ii = 0; ii < levels_.size(); ++ii ) {
+            dip::uint weight = dip::uint( 1 ) << ii;
+            for( dfloat v : levels_[ ii ] ) {
+               items.emplace_back( v, weight );
+            }
+         }
+         std::sort( items.begin(), items.end() );
+         fraction = std::min( std::max( fraction, 0.0 ), 1.0 );
+         dip::uint rank = std::min( static_cast< dip::uint >( std::floor( fraction * static_cast< dfloat >( n_ ))), n_ - 1 );
+         dip::uint cumulative = 0; // the sum of weights equals n_
+         for( auto const& item : items ) {
+            cumulative += item.second;
+            if( cumulative > rank ) {
+               return item.first;
+            }
+         }
+         return items.back().first;
+      }
+
+      /// Approximate percentile, `percentile` is in the range [0,100].
+      dfloat Percentile( dfloat percentile ) const {
+         return Quantile( percentile / 100.0 );
+      }
+
+   private:
+      dip::uint k_;                                // capacity of each compactor
+      std::vector< std::vector< dfloat >> levels_;  // compactors; a sample at level `ii` has weight 2^ii
+      dip::uint n_ = 0;                            // number of samples pushed
+      uint32 random_ = 2463534242u;                // state for the xorshift generator
+
+      // Compacts all full levels, promoting half of their samples to the next level.
+      void Compress() {
+         for( dip::uint ii = 0; ii < levels_.size(); ++ii ) {
+            if( levels_[ ii ].size() < k_ ) {
+               continue;
+            }
+            if( ii + 1 == levels_.size() ) {
+               levels_.emplace_back(); // do this before taking references, it invalidates them
+            }
+            std::vector< dfloat >& level = levels_[ ii ];
+            std::vector< dfloat >& next = levels_[ ii + 1 ];
+            std::sort( level.begin(), level.end() );
+            dip::uint m = level.size() & ~dip::uint( 1 ); // if odd, the largest sample stays at this level
+            for( dip::uint jj = RandomBit(); jj < m; jj += 2 ) {
+               next.push_back( level[ jj ] );
+            }
+            level.erase( level.begin(), level.begin() + static_cast< dip::sint >( m ));
+         }
+      }
+
+      // Xorshift32 generator, returns 0 or 1.
+      dip::uint RandomBit() {
+         random_ ^= random_ << 13;
+         random_ ^= random_ >> 17;
+         random_ ^= random_ << 5;
+         return random_ >> 31;
+      }
+};
+
+/// \brief Combine two accumulators
+inline QuantileAccumulator operator+( QuantileAccumulator lhs, QuantileAccumulator const& rhs ) {
+   lhs += rhs;
+   return lhs;
+}
+
+
 /// \}
 
 } // namespace dip
@@ -1146,6 +1379,74 @@ DOCTEST_TEST_CASE("[DIPlib] testing the statictical accumulators") {
    }
 }
 
+DOCTEST_TEST_CASE("[DIPlib] testing the dip::KahanAccumulator class") {
+   // 1.0 followed by many values that are each too small to change the sum in double precision
+   dip::KahanAccumulator acc1;
+   acc1.Push( 1.0 );
+   dip::dfloat plain = 1.0;
+   for( dip::uint ii = 0; ii < 10000; ++ii ) {
+      acc1.Push( 1e-17 );
+      plain += 1e-17;
+   }
+   DOCTEST_CHECK( plain == 1.0 );
+   DOCTEST_CHECK( acc1.Sum() == doctest::Approx( 1.0 + 1e-13 ).epsilon( 1e-15 ));
+   DOCTEST_CHECK( acc1.Sum() > 1.0 );
+   // Large value after small ones, and cancellation
+   dip::KahanAccumulator acc2;
+   acc2.Push( 1.0 );
+   acc2.Push( 1e100 );
+   acc2.Push( 1.0 );
+   acc2.Push( -1e100 );
+   DOCTEST_CHECK( acc2.Sum() == 2.0 );
+   // Merging
+   acc2 += acc1;
+   DOCTEST_CHECK( acc2.Sum() == doctest::Approx( 3.0 + 1e-13 ).epsilon( 1e-15 ));
+}
+
+DOCTEST_TEST_CASE("[DIPlib] testing the dip::QuantileAccumulator class") {
+   // Samples 0..N-1 in a scrambled order, so that the sample with rank r has value r.
+   dip::uint N = 100000;
+   dip::uint step = 7919; // prime, co-prime with N
+   dip::QuantileAccumulator acc1( 256 );
+   for( dip::uint ii = 0; ii < N; ++ii ) {
+      acc1.Push( static_cast< dip::dfloat >(( ii * step ) % N ));
+   }
+   DOCTEST_CHECK( acc1.Number() == N );
+   dip::dfloat tolerance = static_cast< dip::dfloat >( N ) * 0.02;
+   for( dip::dfloat p : { 1.0, 5.0, 25.0, 50.0, 75.0, 95.0, 99.0 } ) {
+      DOCTEST_CHECK( std::abs( acc1.Percentile( p ) - p / 100.0 * static_cast< dip::dfloat >( N )) <= tolerance );
+   }
+   // Merging
+   dip::QuantileAccumulator acc2( 256 );
+   for( dip::uint ii = 0; ii < N; ++ii ) {
+      acc2.Push( static_cast< dip::dfloat >( N + ( ii * step ) % N ));
+   }
+   acc1 += acc2;
+   DOCTEST_CHECK( acc1.Number() == 2 * N );
+   for( dip::dfloat p : { 5.0, 50.0, 95.0 } ) {
+      DOCTEST_CHECK( std::abs( acc1.Percentile( p ) - p / 50.0 * static_cast< dip::dfloat >( N )) <= 2 * tolerance );
+   }
+   // Exact for few samples
+   dip::QuantileAccumulator acc3;
+   for( dip::dfloat v : { 5.0, 1.0, 4.0, 2.0, 3.0 } ) {
+      acc3.Push( v );
+   }
+   DOCTEST_CHECK( acc3.Quantile( 0.0 ) == 1.0 );
+   DOCTEST_CHECK( acc3.Quantile( 0.5 ) == 3.0 );
+   DOCTEST_CHECK( acc3.Quantile( 1.0 ) == 5.0 );
+   // NaN is ignored
+   acc3.Push( std::nan( "" ));
+   DOCTEST_CHECK( acc3.Number() == 5 );
+   DOCTEST_CHECK( acc3.Quantile( 1.0 ) == 5.0 );
+   dip::QuantileAccumulator acc4( 8 );
+   for( dip::uint ii = 0; ii < 1000; ++ii ) {
+      acc4.Push(( ii % 3 == 0 ) ? std::nan( "" ) : static_cast< dip::dfloat >( ii ));
+   }
+   DOCTEST_CHECK( acc4.Number() == 666 );
+   DOCTEST_CHECK( !std::isnan( acc4.Percentile( 50.0 )));
+   DOCTEST_CHECK( std::abs( acc4.Percentile( 50.0 ) - 500.0 ) <= 200.0 );
+}
+
 #endif // DIP__ENABLE_DOCTEST
 
 #endif // DIP_NUMERIC_H
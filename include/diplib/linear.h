@@ -88,6 +88,29 @@ using OneDimensionalFilterArray = std::vector< OneDimensionalFilter >;
 /// empty (it's `empty` method returns true, and it's `size` method return 0).
 DIP_EXPORT OneDimensionalFilterArray SeparateFilter( Image const& filter );
 
+/// \brief Approximates a linear filter (convolution kernel) by a sum of separable filters.
+///
+/// The output is a set of `dip::OneDimensionalFilterArray` objects, each of which can be applied using
+/// `dip::SeparableConvolution`. Summing the results of these convolutions yields (an approximation to)
+/// the convolution with `filter`.
+///
+/// The decomposition is computed through the singular value decomposition (SVD) of the filter kernel.
+/// The smallest number of terms is used such that the approximation error (the Frobenius norm of the
+/// difference between `filter` and the sum of the separable terms) is at most `tolerance` times the
+/// Frobenius norm of `filter`. If more than `maxRank` terms would be needed, the output is empty. Set
+/// `maxRank` to 0 to not limit the number of terms.
+///
+/// This decomposition is computed only for filters that have more than one pixel along exactly two
+/// dimensions. For 1D filters, and filters with more than two such dimensions, the output contains the
+/// result of `dip::SeparateFilter` as a single term, or is empty if `filter` is not separable.
+///
+/// \see dip::SeparateFilter, dip::Convolution
+DIP_EXPORT std::vector< OneDimensionalFilterArray > SeparateFilterLowRank(
+      Image const& filter,
+      dfloat tolerance = 1e-7,
+      dip::uint maxRank = 0
+);
+
 /// \brief Applies a convolution with a filter kernel (PSF) that is separable.
 ///
 /// `filter` is an array with exactly one element for each dimension of `in`. Alternatively, it can have a single
@@ -159,14 +182,15 @@ inline Image ConvolveFT(
 /// Note that this is a really expensive way to compute the convolution for any `filter` that has more than a
 /// small amount of non-zero values. It is always advantageous to try to separate your filter into a set of 1D
 /// filters (see `dip::SeparateFilter` and `dip::SeparableConvolution`). If this is not possible, use
-/// `dip::ConvolveFT` with larger filters to compute the convolution in the Fourier domain.
+/// `dip::ConvolveFT` with larger filters to compute the convolution in the Fourier domain. `dip::Convolution`
+/// makes this choice automatically.
 ///
 /// Also, if all non-zero filter weights have the same value, `dip::Uniform` implements a more efficient
 /// algorithm. If `filter` is a binary image, `dip::Uniform` is called.
 ///
 /// `boundaryCondition` indicates how the boundary should be expanded in each dimension. See `dip::BoundaryCondition`.
 ///
-/// \see dip::ConvolveFT, dip::SeparableConvolution, dip::SeparateFilter, dip::Uniform
+/// \see dip::Convolution, dip::ConvolveFT, dip::SeparableConvolution, dip::SeparateFilter, dip::Uniform
 DIP_EXPORT void GeneralConvolution(
       Image const& in,
       Image const& filter,
@@ -183,6 +207,49 @@ inline Image GeneralConvolution(
    return out;
 }
 
+/// \brief Applies a convolution with a filter kernel (PSF), choosing the most efficient implementation.
+///
+/// `method` can be one of:
+///
+/// - `"direct"`: compute the convolution sum directly, see `dip::GeneralConvolution`.
+/// - `"separable"`: decompose `filter` into a sum of separable filters (see `dip::SeparateFilterLowRank`), apply
+///   each of these with `dip::SeparableConvolution`, and sum the results. `tolerance` determines how accurately
+///   the sum of separable filters approximates `filter`.
+/// - `"fourier"`: compute the convolution in the Fourier domain, see `dip::ConvolveFT`. `boundaryCondition`
+///   is ignored, the image is always considered periodic.
+/// - `"best"`: picks the method that requires the fewest operations, based on a rough estimate of the cost
+///   of each. The Fourier domain method is only considered if `boundaryCondition` is `"periodic"` for all
+///   dimensions, such that all methods compute the same result. The separable method is only considered if
+///   at most 8 separable terms are needed to approximate `filter` to within `tolerance`. Note that the default
+///   `tolerance` allows a relative error of 1e-7 in the filter kernel. This is comparable to the precision of
+///   single-precision floating-point numbers, but the result can differ slightly from that of the other methods.
+///
+/// `filter` is an image, and must be equal in size or smaller than `in`. `filter` must be real-valued. If it
+/// is binary, `dip::Uniform` is called, independently of `method`.
+///
+/// `boundaryCondition` indicates how the boundary should be expanded in each dimension. See `dip::BoundaryCondition`.
+///
+/// \see dip::GeneralConvolution, dip::SeparableConvolution, dip::ConvolveFT, dip::SeparateFilterLowRank
+DIP_EXPORT void Convolution(
+      Image const& in,
+      Image const& filter,
+      Image& out,
+      String const& method = "best",
+      StringArray const& boundaryCondition = {},
+      dfloat tolerance = 1e-7
+);
+inline Image Convolution(
+      Image const& in,
+      Image const& filter,
+      String const& method = "best",
+      StringArray const& boundaryCondition = {},
+      dfloat tolerance = 1e-7
+) {
+   Image out;
+   Convolution( in, filter, out, method, boundaryCondition, tolerance );
+   return out;
+}
+
 /// \brief Applies a convolution with a kernel with uniform weights, leading to an average (mean) filter.
 ///
 /// The size and shape of the kernel is given by `kernel`, which you can define through a default
@@ -845,6 +912,10 @@ inline Image Divergence(
 ///
 /// The input image must be scalar.
 ///
+/// For the separable methods (finite differences, and Gaussian derivatives computed through `dip::GaussFIR`
+/// or `dip::GaussIIR`), the 1D filtering passes that the tensor elements have in common are computed
+/// only once. For example, for a 3D image, the smoothing along *x* is shared by *dyy*, *dzz* and *dyz*.
+///
 /// \see dip::Derivative, dip::Gradient, dip::Laplace
 DIP_EXPORT void Hessian (
       Image const& in,
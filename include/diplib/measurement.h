@@ -85,7 +85,103 @@ using ValueInformationArray = std::vector< ValueInformation >;
 
 
 /// \brief Maps object IDs to object indices
-using ObjectIdToIndexMap = std::map< dip::uint, dip::uint >;
+///
+/// Has the same interface as a `std::map< dip::uint, dip::uint >` for adding and finding elements
+/// (`emplace`, `find`, `count`, `end`), but a lookup costs constant time. When the object IDs are compact, as
+/// they are after `dip::Label`, a look-up table indexed by the object ID is used. Otherwise, an open-addressing
+/// hash table is used. The choice is made automatically as object IDs are added. Iterating over the
+/// map visits elements in the order they were added, not in sorted order.
+class DIP_NO_EXPORT ObjectIdToIndexMap {
+   public:
+      using value_type = std::pair< dip::uint, dip::uint >;
+      using const_iterator = std::vector< value_type >::const_iterator;
+      using iterator = const_iterator;
+
+      /// \brief Adds an object ID with its index, if the object ID is not yet present. The `bool` in the
+      /// output is false if the object ID was already present, the iterator points at its element.
+      std::pair< const_iterator, bool > emplace( dip::uint objectID, dip::uint index ) {
+         auto it = find( objectID );
+         if( it != end() ) {
+            return { it, false };
+         }
+         entries_.emplace_back( objectID, index );
+         maxID_ = std::max( maxID_, objectID );
+         if( dense_ && ( maxID_ >= MaxDenseSize( entries_.size() ))) {
+            dense_ = false;
+            Rebuild( 64 );
+         } else if( dense_ ) {
+            if( objectID >= table_.size() ) {
+               table_.resize( std::max( objectID + 1, table_.size() * 2 ), 0 );
+            }
+            table_[ objectID ] = entries_.size();
+         } else if( entries_.size() * 2 > table_.size() ) {
+            Rebuild( table_.size() * 2 );
+         } else {
+            table_[ Slot( objectID ) ] = entries_.size();
+         }
+         return { entries_.end() - 1, true };
+      }
+
+      /// \brief Finds the element for the object ID, returns `end()` if it is not present.
+      const_iterator find( dip::uint objectID ) const {
+         if( dense_ ) {
+            if(( objectID >= table_.size() ) || ( table_[ objectID ] == 0 )) {
+               return end();
+            }
+            return entries_.begin() + static_cast< dip::sint >( table_[ objectID ] - 1 );
+         }
+         if( table_.empty() ) {
+            return end();
+         }
+         dip::uint slot = table_[ Slot( objectID ) ];
+         return slot == 0 ? end() : entries_.begin() + static_cast< dip::sint >( slot - 1 );
+      }
+
+      /// \brief Returns 1 if the object ID is present, 0 otherwise.
+      dip::uint count( dip::uint objectID ) const {
+         return find( objectID ) == end() ? 0 : 1;
+      }
+
+      const_iterator begin() const { return entries_.begin(); }
+      const_iterator end() const { return entries_.end(); }
+      dip::uint size() const { return entries_.size(); }
+      bool empty() const { return entries_.empty(); }
+
+      /// \brief True if a look-up table is used, false if a hash table is used.
+      bool IsDense() const { return dense_; }
+
+   private:
+      std::vector< value_type > entries_;    // (objectID, index) pairs, in insertion order
+      std::vector< dip::uint > table_;       // position in `entries_` plus one, 0 for an empty element
+      dip::uint maxID_ = 0;
+      bool dense_ = true;                    // if true, `table_` is indexed by object ID
+
+      // The largest object ID we store in a look-up table, given the number of objects
+      static dip::uint MaxDenseSize( dip::uint nObjects ) {
+         return 4 * nObjects + 1024;
+      }
+
+      // Returns the slot in the hash table that contains `objectID`, or the empty slot where it goes
+      dip::uint Slot( dip::uint objectID ) const {
+         dip::uint mask = table_.size() - 1;
+         dip::uint slot = static_cast< dip::uint >(( static_cast< std::uint64_t >( objectID ) * 0x9E3779B97F4A7C15ull ) >> 32 ) & mask;
+         while(( table_[ slot ] != 0 ) && ( entries_[ table_[ slot ] - 1 ].first != objectID )) {
+            slot = ( slot + 1 ) & mask;
+         }
+         return slot;
+      }
+
+      // Creates a hash table of the given size (a power of two) and fills it with all elements
+      void Rebuild( dip::uint size ) {
+         while( size < entries_.size() * 2 ) {
+            size *= 2;
+         }
+         table_.assign( size, 0 );
+         for( dip::uint ii = 0; ii < entries_.size(); ++ii ) {
+            table_[ Slot( entries_[ ii ].first ) ] = ii + 1;
+         }
+      }
+};
 
 /// \brief Contains measurement results, as obtained through `dip::MeasurementTool::Measure`.
 ///
@@ -598,7 +694,8 @@ class DIP_EXPORT LineBased : public Base {
       LineBased( Information const& information ) : Base( information, Type::LINE_BASED ) {};
 
       /// \brief Called once for each image line, to accumulate information about each object.
-      /// This function is not called in parallel, and hence does not need to be thread-safe.
+      /// This function is not called in parallel on the same object, and hence does not need to be thread-safe.
+      /// See `dip::Feature::LineBased::CloneForThread` for how to allow the image to be scanned in parallel.
       ///
       /// The two line iterators can always be incremented exactly the same number of times.
       /// `coordinates[ dimension ]` should be incremented at the same time, if coordinate
@@ -619,6 +716,21 @@ class DIP_EXPORT LineBased : public Base {
 
       /// \brief Called once for each object, to finalize the measurement
       virtual void Finish( dip::uint objectIndex, Measurement::ValueIterator output ) = 0;
+
+      /// \brief Creates a copy of the feature object, to accumulate information in a separate thread.
+      ///
+      /// Called after `dip::Feature::Base::Initialize`, before any call to `dip::Feature::LineBased::ScanLine`.
+      /// The copy must have its own, newly initialized accumulators. Each thread scans a different part of
+      /// the image, the accumulators of the copies are afterwards added to those of `this` through
+      /// `dip::Feature::LineBased::Merge`.
+      ///
+      /// The default implementation returns a null pointer, which means that the feature does not support
+      /// parallel accumulation, and the image will be scanned in a single thread for this feature.
+      virtual std::unique_ptr< LineBased > CloneForThread() const { return nullptr; }
+
+      /// \brief Adds the information accumulated in `other`, a copy created with
+      /// `dip::Feature::LineBased::CloneForThread`, to `this`.
+      virtual void Merge( LineBased& /*other*/ ) {}
 };
 
 /// \brief The pure virtual base class for all image-based measurement features.
@@ -637,6 +749,12 @@ class DIP_EXPORT ChainCodeBased : public Base {
 
       /// \brief Called once for each object
       virtual void Measure( ChainCode const& chainCode, Measurement::ValueIterator output ) = 0;
+
+      /// \brief Returns true if `dip::Feature::ChainCodeBased::Measure` can be called in parallel for different objects.
+      ///
+      /// This is the case if `Measure` does not modify the state of the feature object. The default
+      /// implementation returns false, and `Measure` is called for one object at the time.
+      virtual bool IsThreadSafe() const { return false; }
 };
 
 /// \brief The pure virtual base class for all polygon-based measurement features.
@@ -646,6 +764,12 @@ class DIP_EXPORT PolygonBased : public Base {
 
       /// \brief Called once for each object
       virtual void Measure( Polygon const& polygon, Measurement::ValueIterator output ) = 0;
+
+      /// \brief Returns true if `dip::Feature::PolygonBased::Measure` can be called in parallel for different objects.
+      ///
+      /// This is the case if `Measure` does not modify the state of the feature object. The default
+      /// implementation returns false, and `Measure` is called for one object at the time.
+      virtual bool IsThreadSafe() const { return false; }
 };
 
 /// \brief The pure virtual base class for all convex-hull--based measurement features.
@@ -655,6 +779,12 @@ class DIP_EXPORT ConvexHullBased : public Base {
 
       /// \brief Called once for each object
       virtual void Measure( ConvexHull const& convexHull, Measurement::ValueIterator output ) = 0;
+
+      /// \brief Returns true if `dip::Feature::ConvexHullBased::Measure` can be called in parallel for different objects.
+      ///
+      /// This is the case if `Measure` does not modify the state of the feature object. The default
+      /// implementation returns false, and `Measure` is called for one object at the time.
+      virtual bool IsThreadSafe() const { return false; }
 };
 
 /// \brief The pure virtual base class for all composite measurement features.
@@ -815,6 +945,11 @@ class DIP_NO_EXPORT MeasurementTool {
       /// the `label` image into account. Those of `grey` are ignored. Some measurements require
       /// isotropic pixel sizes, if `label` is not isotropic, the pixel size is ignored and these
       /// measures will return values in pixels instead.
+      ///
+      /// Large images are scanned in parallel for line-based features that support it (see
+      /// `dip::Feature::LineBased::CloneForThread`), and chain-code, polygon and convex-hull based
+      /// features that are thread-safe are computed for different objects in parallel (see
+      /// `dip::Feature::ChainCodeBased::IsThreadSafe` and \ref multithreading).
       DIP_EXPORT Measurement Measure(
             Image const& label,
             Image const& grey,
@@ -885,6 +1020,30 @@ inline Image ObjectToMeasurement(
 }
 
 
+/// \brief Labels the connected components in a binary image, and measures some basic features for each.
+///
+/// This function labels `binary` exactly like `dip::Label` does, with the same `connectivity`, `minSize` and
+/// `maxSize` parameters. While labeling, it computes the number of pixels, the bounding box, and the sum of
+/// coordinates of each region. If `grey` is forged, it also computes the sum, minimum and maximum of its values
+/// within each region. These statistics are merged whenever two regions are found to be connected, so that
+/// no further passes through the image are needed to measure the objects.
+///
+/// The output measurement contains the features "Size", "Minimum", "Maximum" and "Center", and if `grey` is
+/// given, also "Mean", "MinVal" and "MaxVal". These have the same names, units and values as would be obtained
+/// by calling `dip::MeasurementTool::Measure` with the same features on the labeled output image `out`.
+///
+/// `grey` must be a real-valued scalar image of the same sizes as `binary`. No boundary condition can be given,
+/// and the labeling is always done using a single thread.
+DIP_EXPORT Measurement LabelAndMeasure(
+      Image const& binary,
+      Image const& grey,
+      Image& out,
+      dip::uint connectivity = 0,
+      dip::uint minSize = 0,
+      dip::uint maxSize = 0
+);
+
+
 /// \brief Returns the smallest feature value in the first column of `featureValues`.
 ///
 /// The input `featureValues` is a view over a specific feature in a `dip::Measurement` object. Only the
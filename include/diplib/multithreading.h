@@ -0,0 +1,61 @@
+/*
+ * DIPlib 3.0
+ * This file contains declarations for multithreading support.
+ *
+ * (c)2026, DIPlib contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DIP_MULTITHREADING_H
+#define DIP_MULTITHREADING_H
+
+#include "diplib.h"
+
+
+/// \file
+/// \brief Declares functions to control multithreading.
+
+
+namespace dip {
+
+
+/// \defgroup multithreading Multithreading
+/// \brief Controlling the number of threads used by parallelized algorithms.
+/// \ingroup infrastructure
+///
+/// Some *DIPlib* functions split their work among multiple threads. This requires the library to be
+/// built with OpenMP support (the CMake option `DIP_ENABLE_MULTITHREADING`). Without it, all functions
+/// run in the calling thread.
+/// \{
+
+/// \brief Sets the maximum number of threads to be used in parallelized algorithms.
+///
+/// The default value is the number of threads OpenMP uses for a parallel region, as given by
+/// `omp_get_max_threads()`. This is usually the number of processors, unless the `OMP_NUM_THREADS`
+/// environment variable is set. Set it to 1 to disable multithreading. A value of 0 resets the default.
+DIP_EXPORT void SetNumberOfThreads( dip::uint nThreads );
+
+/// \brief Gets the maximum number of threads that can be used in parallelized algorithms.
+///
+/// Always returns 1 if the library was built without OpenMP support.
+DIP_EXPORT dip::uint GetNumberOfThreads();
+
+/// \brief Algorithms split their work among threads only if it involves at least this many pixels.
+constexpr dip::uint threadingThreshold = 100000;
+
+/// \}
+
+} // namespace dip
+
+#endif // DIP_MULTITHREADING_H
@@ -47,6 +47,11 @@ namespace dip {
 /// The size and shape of the filter window is given by `kernel`, which you can define through a default
 /// shape with corresponding sizes, or through a binary image. See `dip::Kernel`.
 ///
+/// For 8-bit and 16-bit unsigned integer images, the filter keeps a histogram of the values within the
+/// filter window, which is updated as the window slides along the image line. The cost of this algorithm
+/// is proportional to the number of pixel runs in the kernel, rather than to the number of pixels. For other
+/// data types, a sorted copy of the values within the window is updated as the window slides.
+///
 /// `boundaryCondition` indicates how the boundary should be expanded in each dimension. See `dip::BoundaryCondition`.
 DIP_EXPORT void PercentileFilter(
       Image const& in,
@@ -100,7 +105,10 @@ inline Image MedianFilter(
 ///
 /// `boundaryCondition` indicates how the boundary should be expanded in each dimension. See `dip::BoundaryCondition`.
 ///
-/// Uses `dip::VarianceAccumulator` for the computation.
+/// Uses `dip::VarianceAccumulator` for the computation. For rectangular kernels of more than one dimension,
+/// the variance is instead computed from a `dip::IntegralImage` of the boundary-extended input, which takes
+/// constant time per pixel independently of the kernel size. To limit memory use and loss of precision, the
+/// integral image is computed for one slab of image lines at a time.
 DIP_EXPORT void VarianceFilter(
       Image const& in,
       Image& out,
@@ -43,8 +43,6 @@ namespace dip {
    dip_GrowRegionsWeighted (dip_regions.h)
 */
 
-// TODO: implement a relabel function.
-
 /// \brief Labels the connected components in a binary image
 ///
 /// The output is an unsigned integer image. Each object (respecting the connectivity,
@@ -60,6 +58,10 @@ namespace dip {
 ///
 /// The boundary conditions are generally ignored (labeling stops at the boundary). The exception
 /// is `"periodic"`, which is the only one that makes sense for this algorithm.
+///
+/// Large images are split into slabs that are labeled in parallel (see \ref multithreading).
+/// The labels are then merged across slab boundaries. The labels assigned to each object might
+/// differ from those assigned when using a single thread, but the objects found are identical.
 DIP_EXPORT dip::uint Label(
       Image const& binary,
       Image& out,
@@ -90,11 +92,51 @@ DIP_EXPORT UnsignedArray GetObjectLabels(
       String const& background = "exclude"
 );
 
+/// \brief Maps the labels in a labeled image through a lookup table.
+///
+/// Each pixel with label `ii` in `label` is set to `map[ ii ]` in `out`. Labels larger than or equal to
+/// `map.size()` are set to 0. This is done in a single pass through the image, and can be used to
+/// renumber, merge or remove objects. For example, to remove objects based on a measurement, set
+/// `map[ ii ]` to `ii` for the objects to keep, and to 0 for the ones to remove.
+///
+/// `label` must be of an unsigned integer type, `out` will be of the same type. Values in `map` that
+/// do not fit in that type are clamped.
+DIP_EXPORT void MapLabels(
+      Image const& label,
+      Image& out,
+      UnsignedArray const& map
+);
+inline Image MapLabels(
+      Image const& label,
+      UnsignedArray const& map
+) {
+   Image out;
+   MapLabels( label, out, map );
+   return out;
+}
+
+/// \brief Renumbers the labels in a labeled image such that they are consecutive.
+///
+/// The objects in `label` are given labels 1 to *N*, where *N* is the number of objects (which is
+/// returned). The relative order of labels is preserved. The background (label 0) is not changed.
+/// `label` must be of an unsigned integer type, `out` will be of the same type.
+DIP_EXPORT dip::uint Relabel(
+      Image const& label,
+      Image& out
+);
+inline Image Relabel(
+      Image const& label
+) {
+   Image out;
+   Relabel( label, out );
+   return out;
+}
+
 /// \brief Removes small objects from a labeled or binary image.
 ///
-/// If `in` is an unsigned integer image, it is assumed to be a labeled image. The size of the objects
-/// are measured using `dip::MeasurementTool`, and the labels for the objects with fewer than `threshold`
-/// pixels are removed. The `connectivity` parameter is ignored.
+/// If `in` is an unsigned integer image, it is assumed to be a labeled image. The number of pixels in
+/// each object is counted, and the labels for the objects with fewer than `threshold` pixels are
+/// removed using `dip::MapLabels`. The `connectivity` parameter is ignored.
 ///
 /// If `in` is a binary image, `dip::Label` is called with `minSize` set to `threshold`, and the result
 /// is binarized again. `connectivity` is passed to the labeling function.
@@ -75,6 +75,84 @@ inline Image CumulativeSum( Image const& in, Image const& mask = {}, BooleanArra
    return out;
 }
 
+/// \brief Holds a summed-area table (integral image), for computing sums over arbitrary boxes in constant time.
+///
+/// The integral image is computed by the constructor, with a single pass over the image along each dimension.
+/// Afterwards, the sum over any axis-aligned box can be found with 2<sup>*d*</sup> table lookups, for a
+/// *d*-dimensional image, independently of the size of the box. This makes it cheap to compute local means
+/// and variances for many different box sizes from the same table.
+///
+/// If `withSquares` is `true`, a second table with the sum of squared values is kept, which enables the
+/// `SumOfSquares` and `BoxVariance` methods.
+///
+/// The input image must be scalar and real-valued. For binary and 8-bit and 16-bit integer images, the
+/// tables use 64-bit integer accumulators, and results are exact. For other data types, the tables use
+/// double-precision floating-point accumulators. In that case the image mean is subtracted from the pixel
+/// values before accumulation, to reduce the loss of precision when computing variances. If `withSquares`
+/// is `true`, images with more than 2<sup>31</sup> pixels also use floating-point accumulators, as the
+/// integer table of squared values could overflow.
+///
+/// Boxes are clipped to the image domain; the mean and variance are computed over those pixels inside the
+/// image. Use `dip::ExtendImage` on the input image to obtain values at the image border according to some
+/// boundary condition.
+class DIP_NO_EXPORT IntegralImage {
+   public:
+      /// \brief The integral image is computed by the constructor. There is no default-constructed `%IntegralImage`.
+      explicit IntegralImage( Image const& in, bool withSquares = false ) {
+         DIP_STACK_TRACE_THIS( Compute( in, withSquares ));
+      }
+
+      /// \brief Returns the dimensionality of the image the table was computed for.
+      dip::uint Dimensionality() const { return sizes_.size(); }
+
+      /// \brief Returns the sizes of the image the table was computed for.
+      UnsignedArray const& Sizes() const { return sizes_; }
+
+      /// \brief Returns true if the table uses integer accumulators, and sums are exact.
+      bool IsExact() const { return exact_; }
+
+      /// \brief Returns true if the table of squared values was computed.
+      bool HasSquares() const { return withSquares_; }
+
+      /// \brief Returns the sum of the pixel values within the box with top-left corner at `origin` and
+      /// sizes `boxSizes`. The box is clipped to the image domain.
+      DIP_EXPORT dfloat Sum( IntegerArray const& origin, UnsignedArray const& boxSizes ) const;
+
+      /// \brief Returns the sum of the squared pixel values within the box with top-left corner at `origin`
+      /// and sizes `boxSizes`. The box is clipped to the image domain.
+      DIP_EXPORT dfloat SumOfSquares( IntegerArray const& origin, UnsignedArray const& boxSizes ) const;
+
+      /// \brief Computes, for each pixel, the sum of the values within a box of sizes `boxSizes`.
+      ///
+      /// `boxOrigin` gives the position of the top-left corner of the box relative to the pixel. By default,
+      /// the box is centered on the pixel, with the same origin as a rectangular `dip::Kernel` of the same
+      /// sizes. `out` is of type `dip::DT_DFLOAT` and has the same sizes as the input image.
+      DIP_EXPORT void BoxSum( Image& out, UnsignedArray boxSizes, IntegerArray boxOrigin = {} ) const;
+
+      /// \brief Computes, for each pixel, the mean of the values within a box of sizes `boxSizes`.
+      /// See `BoxSum` for the meaning of the arguments.
+      DIP_EXPORT void BoxMean( Image& out, UnsignedArray boxSizes, IntegerArray boxOrigin = {} ) const;
+
+      /// \brief Computes, for each pixel, the (unbiased) variance of the values within a box of sizes
+      /// `boxSizes`. See `BoxSum` for the meaning of the arguments. Requires `HasSquares`.
+      DIP_EXPORT void BoxVariance( Image& out, UnsignedArray boxSizes, IntegerArray boxOrigin = {} ) const;
+
+   private:
+      UnsignedArray sizes_;            // Sizes of the input image. The tables have one more element along each dimension.
+      IntegerArray strides_;           // Strides into the tables.
+      bool exact_ = false;             // If true, `intSums_` and `intSquares_` are used, otherwise `sums_` and `squares_`.
+      bool withSquares_ = false;
+      dfloat shift_ = 0.0;             // Value subtracted from each pixel before accumulation.
+      std::vector< std::int64_t > intSums_;
+      std::vector< std::int64_t > intSquares_;
+      std::vector< dfloat > sums_;
+      std::vector< dfloat > squares_;
+
+      enum class BoxStatistic { SUM, MEAN, VARIANCE };
+      DIP_EXPORT void Compute( Image const& in, bool withSquares );
+      DIP_EXPORT void BoxFilter( Image& out, UnsignedArray& boxSizes, IntegerArray& boxOrigin, BoxStatistic statistic ) const;
+};
+
 /// \brief Finds the largest and smallest value in the image, within an optional mask.
 ///
 /// If `mask` is not forged, all input pixels are considered. In case of a tensor
@@ -88,6 +166,17 @@ DIP_EXPORT MinMaxAccumulator MaximumAndMinimum( Image const& in, Image const& ma
 /// image, returns the statistics over all sample values. The image must be real-valued.
 DIP_EXPORT StatisticsAccumulator SampleStatistics( Image const& in, Image const& mask = {} );
 
+/// \brief Computes approximate quantiles of the pixel intensities, within an optional mask.
+///
+/// If `mask` is not forged, all input pixels are considered. In case of a tensor
+/// image, returns the quantiles over all sample values. The image must be real-valued.
+///
+/// The image is read in a single pass, and memory use grows only logarithmically with the number of pixels. See
+/// `dip::QuantileAccumulator` for the error bounds; `k` is the capacity passed to its constructor.
+/// NaN and infinite sample values are ignored.
+/// Use `dip::Percentile` to compute exact values.
+DIP_EXPORT QuantileAccumulator SampleQuantiles( Image const& in, Image const& mask = {}, dip::uint k = 2048 );
+
 // TODO: Covariance, Correlation (apply to tensor images, yield a matrix out with covariance or correlation between the channels).
 
 /// \brief Computes the center of mass (first order moments) of the image `in`, optionally using only
@@ -400,6 +489,11 @@ inline Image MinimumAbs( Image const& in, Image const& mask = {}, BooleanArray c
 /// For tensor images, the result is computed for each element independently. Input must be not complex.
 ///
 /// If `mask` is forged, only those pixels selected by the mask image are used.
+///
+/// For 8-bit and 16-bit integer images, the percentile is found by counting pixel values, which requires
+/// one or two passes over the data and no additional memory. For other data types, the pixel values are
+/// copied to a buffer and partially sorted. `dip::SampleQuantiles` computes an approximation in a single pass
+/// with little memory.
 DIP_EXPORT void Percentile( Image const& in, Image const& mask, Image& out, dfloat percentile, BooleanArray process = {} );
 inline Image Percentile( Image const& in, Image const& mask, dfloat percentile, BooleanArray const& process = {} ) {
    Image out;
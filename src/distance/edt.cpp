@@ -21,6 +21,8 @@
 #include "diplib.h"
 #include "diplib/distance.h"
 #include "diplib/math.h"
+#include "diplib/framework.h"
+#include "diplib/iterators.h"
 
 namespace dip {
 
@@ -1580,6 +1582,116 @@ static void EDTBruteForce3D(
    }
 }
 
+// Exact squared Euclidean distances along one image line, by computing the lower envelope of the parabolas
+// rooted at each pixel (Felzenszwalb and Huttenlocher). The first pass sees the binary image (0 or 1),
+// subsequent passes see the squared distances computed so far.
+class EDTSeparableLineFilter : public Framework::SeparableLineFilter {
+   public:
+      EDTSeparableLineFilter( FloatArray const& distance ) : distance_( distance ) {}
+      virtual void SetNumberOfThreads( dip::uint threads ) override {
+         buffers_.resize( threads );
+      }
+      virtual void Filter( Framework::SeparableLineFilterParameters const& params ) override {
+         constexpr dfloat infinity = std::numeric_limits< dfloat >::infinity();
+         dfloat const* in = static_cast< dfloat const* >( params.inBuffer.buffer );
+         dip::sint inStride = params.inBuffer.stride;
+         dip::sint border = static_cast< dip::sint >( params.inBuffer.border );
+         dfloat* out = static_cast< dfloat* >( params.outBuffer.buffer );
+         dip::sint outStride = params.outBuffer.stride;
+         dip::sint length = static_cast< dip::sint >( params.outBuffer.length );
+         bool firstPass = params.pass == 0;
+         dfloat weight = distance_[ params.dimension ] * distance_[ params.dimension ];
+         LineBuffers& buf = buffers_[ params.thread ];
+         dip::uint bufferSize = static_cast< dip::uint >( length + 2 * border ) + 1;
+         buf.vertex.resize( bufferSize );
+         buf.bound.resize( bufferSize );
+         dip::sint* vertex = buf.vertex.data(); // location of parabola k
+         dfloat* bound = buf.bound.data();      // parabola k is lowest between bound[k] and bound[k+1]
+         // Build the lower envelope, skipping pixels at infinite distance
+         dip::sint k = -1;
+         dfloat const* inPtr = in - border * inStride;
+         for( dip::sint q = -border; q < length + border; ++q, inPtr += inStride ) {
+            dfloat fq = *inPtr;
+            if( firstPass && ( fq != 0 )) {
+               continue; // object pixel
+            }
+            if( fq == infinity ) {
+               continue;
+            }
+            dfloat hq = fq + weight * static_cast< dfloat >( q * q );
+            dfloat s = -infinity;
+            while( k >= 0 ) {
+               dip::sint v = vertex[ k ];
+               dfloat hv = in[ v * inStride ];
+               hv = ( firstPass ? 0.0 : hv ) + weight * static_cast< dfloat >( v * v );
+               s = ( hq - hv ) / ( 2.0 * weight * static_cast< dfloat >( q - v ));
+               if( s > bound[ k ] ) {
+                  break;
+               }
+               --k;
+            }
+            ++k;
+            vertex[ k ] = q;
+            bound[ k ] = k == 0 ? -infinity : s;
+            bound[ k + 1 ] = infinity;
+         }
+         // Sample the lower envelope
+         if( k < 0 ) {
+            for( dip::sint ii = 0; ii < length; ++ii, out += outStride ) {
+               *out = infinity;
+            }
+            return;
+         }
+         k = 0;
+         for( dip::sint ii = 0; ii < length; ++ii, out += outStride ) {
+            while( bound[ k + 1 ] < static_cast< dfloat >( ii )) {
+               ++k;
+            }
+            dip::sint v = vertex[ k ];
+            dfloat fv = firstPass ? 0.0 : in[ v * inStride ];
+            dip::sint d = ii - v;
+            *out = fv + weight * static_cast< dfloat >( d * d );
+         }
+      }
+   private:
+      FloatArray const& distance_;
+      struct LineBuffers {
+         std::vector< dip::sint > vertex;
+         std::vector< dfloat > bound;
+      };
+      std::vector< LineBuffers > buffers_;
+};
+
+static void EDTSeparable(
+      Image const& in,
+      Image& out,
+      FloatArray const& distance,
+      bool border
+) {
+   // With a background border, a one-pixel border of zeros is added around the image. With an object border,
+   // the image edge does not contribute any distances.
+   UnsignedArray borderSizes( in.Dimensionality(), border ? 0 : 1 );
+   EDTSeparableLineFilter lineFilter( distance );
+   Framework::Separable( in, out, DT_DFLOAT, DT_SFLOAT, {}, borderSizes, { BoundaryCondition::ADD_ZEROS }, lineFilter );
+   if( !border ) {
+      // Dimensions of size 1 are skipped by the framework, but their border is at one pixel distance
+      dfloat maxDistance = std::numeric_limits< dfloat >::infinity();
+      for( dip::uint ii = 0; ii < in.Dimensionality(); ++ii ) {
+         if( in.Size( ii ) == 1 ) {
+            maxDistance = std::min( maxDistance, distance[ ii ] * distance[ ii ] );
+         }
+      }
+      if( maxDistance < std::numeric_limits< dfloat >::infinity() ) {
+         sfloat maxValue = static_cast< sfloat >( maxDistance );
+         ImageIterator< sfloat > it( out );
+         do {
+            *it = std::min( *it, maxValue );
+         } while( ++it );
+      }
+   }
+   Sqrt( out, out );
+}
+
 } // namespace
 
 void EuclideanDistanceTransform(
@@ -1592,7 +1704,8 @@ void EuclideanDistanceTransform(
    DIP_THROW_IF( !in.IsScalar(), E::IMAGE_NOT_SCALAR );
    DIP_THROW_IF( !in.DataType().IsBinary(), E::DATA_TYPE_NOT_SUPPORTED );
    dip::uint dim = in.Dimensionality();
-   DIP_THROW_IF(( dim > 3 ) || ( dim < 2 ), E::DIMENSIONALITY_NOT_SUPPORTED );
+   DIP_THROW_IF( dim < 1, E::DIMENSIONALITY_NOT_SUPPORTED );
+   DIP_THROW_IF(( method != "separable" ) && (( dim > 3 ) || ( dim < 2 )), E::DIMENSIONALITY_NOT_SUPPORTED );
    UnsignedArray sizes = in.Sizes();
 
    bool objectBorder;
@@ -1608,6 +1721,11 @@ void EuclideanDistanceTransform(
       }
    }
 
+   if( method == "separable" ) {
+      DIP_STACK_TRACE_THIS( EDTSeparable( in, out, dist, objectBorder ));
+      return;
+   }
+
    // Convert in to out and get data pointer of out
    Convert( in, out, DT_SFLOAT );
    IntegerArray stride = out.Strides();
@@ -1640,3 +1758,64 @@ void EuclideanDistanceTransform(
 }
 
 } // namespace dip
+
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+#include "diplib/generation.h"
+#include "diplib/random.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the separable EuclideanDistanceTransform") {
+   // 4D image with a single background pixel and anisotropic pixels
+   dip::Image img{ dip::UnsignedArray{ 6, 5, 4, 3 }, 1, dip::DT_BIN };
+   img.Fill( 1 );
+   dip::UnsignedArray bg{ 1, 2, 3, 0 };
+   img.At( bg ) = 0;
+   dip::FloatArray ps{ 1.0, 2.0, 0.5, 1.5 };
+   img.SetPixelSize( dip::PhysicalQuantityArray{ ps[ 0 ] * dip::Units::Micrometer(), ps[ 1 ] * dip::Units::Micrometer(),
+                                                 ps[ 2 ] * dip::Units::Micrometer(), ps[ 3 ] * dip::Units::Micrometer() } );
+   dip::Image out = dip::EuclideanDistanceTransform( img, "object", "separable" );
+   DOCTEST_REQUIRE( out.DataType() == dip::DT_SFLOAT );
+   dip::ImageIterator< dip::sfloat > it( out );
+   bool correct = true;
+   do {
+      dip::dfloat d = 0;
+      for( dip::uint ii = 0; ii < 4; ++ii ) {
+         dip::dfloat v = ( static_cast< dip::dfloat >( it.Coordinates()[ ii ] ) - static_cast< dip::dfloat >( bg[ ii ] )) * ps[ ii ];
+         d += v * v;
+      }
+      if( std::abs( *it - std::sqrt( d )) > 1e-5 ) {
+         correct = false;
+      }
+   } while( ++it );
+   DOCTEST_CHECK( correct );
+
+   // 2D random image with background border, compared to exhaustive search
+   img = dip::Image{ dip::UnsignedArray{ 14, 11 }, 1, dip::DT_SFLOAT };
+   img.Fill( 0 );
+   dip::Random random( 0 );
+   dip::UniformNoise( img, img, random );
+   img = img < 0.9;
+   out = dip::EuclideanDistanceTransform( img, "background", "separable" );
+   correct = true;
+   for( dip::sint y = 0; y < 11; ++y ) {
+      for( dip::sint x = 0; x < 14; ++x ) {
+         dip::sint d = std::min( std::min( x + 1, 14 - x ), std::min( y + 1, 11 - y ));
+         dip::sint best = d * d;
+         for( dip::sint yy = 0; yy < 11; ++yy ) {
+            for( dip::sint xx = 0; xx < 14; ++xx ) {
+               if( !img.At( static_cast< dip::uint >( xx ), static_cast< dip::uint >( yy )).As< bool >() ) {
+                  best = std::min( best, ( x - xx ) * ( x - xx ) + ( y - yy ) * ( y - yy ));
+               }
+            }
+         }
+         dip::dfloat value = out.At( static_cast< dip::uint >( x ), static_cast< dip::uint >( y )).As< dip::dfloat >();
+         if( std::abs( value - std::sqrt( static_cast< dip::dfloat >( best ))) > 1e-5 ) {
+            correct = false;
+         }
+      }
+   }
+   DOCTEST_CHECK( correct );
+}
+
+#endif // DIP__ENABLE_DOCTEST
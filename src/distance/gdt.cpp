@@ -220,38 +220,92 @@ void GDTQuickSort(
    }
 }
 
+// Sets the image border (of width `border`) to 0 and the remaining object pixels to the maximum value, and
+// returns the seeds: background pixels outside the border with at least one object neighbor.
+// Works for images of any dimensionality.
+std::vector< dip::sint > GDTInitialize(
+      sfloat* out,
+      UnsignedArray const& sizes,
+      IntegerArray const& strides,
+      UnsignedArray const& border,
+      IntegerArray const& offsets
+) {
+   dip::uint nDims = sizes.size();
+   dip::uint nPixels = sizes.product();
+   std::vector< dip::sint > seeds;
+   // First pass: border
+   UnsignedArray coords( nDims, 0 );
+   dip::sint offset = 0;
+   for( dip::uint ii = 0; ii < nPixels; ++ii ) {
+      for( dip::uint jj = 0; jj < nDims; ++jj ) {
+         if(( coords[ jj ] < border[ jj ] ) || ( coords[ jj ] >= sizes[ jj ] - border[ jj ] )) {
+            out[ offset ] = 0.0;
+            break;
+         }
+      }
+      for( dip::uint jj = 0; jj < nDims; ++jj ) {
+         ++coords[ jj ];
+         offset += strides[ jj ];
+         if( coords[ jj ] < sizes[ jj ] ) {
+            break;
+         }
+         offset -= static_cast< dip::sint >( coords[ jj ] ) * strides[ jj ];
+         coords[ jj ] = 0;
+      }
+   }
+   // Second pass: seeds and object pixels
+   coords.fill( 0 );
+   offset = 0;
+   for( dip::uint ii = 0; ii < nPixels; ++ii ) {
+      bool inBorder = false;
+      for( dip::uint jj = 0; jj < nDims; ++jj ) {
+         if(( coords[ jj ] < border[ jj ] ) || ( coords[ jj ] >= sizes[ jj ] - border[ jj ] )) {
+            inBorder = true;
+            break;
+         }
+      }
+      if( !inBorder ) {
+         if( out[ offset ] == 0.0 ) {
+            for( auto nbOffset : offsets ) {
+               if( out[ offset + nbOffset ] != 0.0 ) {
+                  seeds.push_back( offset );
+                  break;
+               }
+            }
+         } else {
+            out[ offset ] = std::numeric_limits< sfloat >::max();
+         }
+      }
+      for( dip::uint jj = 0; jj < nDims; ++jj ) {
+         ++coords[ jj ];
+         offset += strides[ jj ];
+         if( coords[ jj ] < sizes[ jj ] ) {
+            break;
+         }
+         offset -= static_cast< dip::sint >( coords[ jj ] ) * strides[ jj ];
+         coords[ jj ] = 0;
+      }
+   }
+   return seeds;
+}
+
 template< typename TPI >
 void GDTProcessHeap(
       void const* input,
       sfloat* out,
       sfloat* distance,
-      UnsignedArray const& sizes,
-      IntegerArray const& strides,
+      dip::uint nPixels,
+      std::vector< dip::sint > const& seeds,
       NeighborList const& neighborhood,
       IntegerArray const& offsets
 ) {
    TPI const* in = static_cast< TPI const* >( input );
-   dip::sint size = static_cast< dip::sint >( sizes.product() );
-   dip::sint width = static_cast< dip::sint >( sizes[ 0 ] );
-   dip::sint height = static_cast< dip::sint >( sizes[ 1 ] );
-   dip::sint depth = static_cast< dip::sint >( sizes.size() > 2 ? sizes[ 2 ] : 1 );
-   dip::sint sx = strides[ 0 ];
-   dip::sint sy = strides[ 1 ];
-   dip::sint sz = depth > 1 ? strides[ 2 ] : 1;
-
+   dip::sint size = static_cast< dip::sint >( nPixels );
    dip::uint nb_size = neighborhood.Size();
-   UnsignedArray border = neighborhood.Border();
-   dip::sint nb_x = static_cast< dip::sint >( border[ 0 ] );
-   dip::sint nb_y = static_cast< dip::sint >( border[ 1 ] );
-   dip::sint nb_z = static_cast< dip::sint >( border.size() > 2 ? border[ 2 ] : 0 );
    dip::sint const* address = offsets.data();
    std::vector< sfloat > neighborhoodDistances = neighborhood.CopyDistances< sfloat >();
    sfloat* metric = neighborhoodDistances.data(); // make copy so we can index with signed integers and not get compiler warnings.
 
-   dip::sint x_end = width - nb_x;
-   dip::sint y_end = height - nb_y;
-   dip::sint z_end = depth - nb_z;
-
    /*
     * create heap
     * maximum heap size equals the image size (we neglect the border pixels),
@@ -259,96 +313,16 @@ void GDTProcessHeap(
     * so we start with a smaller heap: 1/4-th of the max size.
     */
    dip::uint bottom = 1;
-   dip::uint heapmax = static_cast< dip::uint >( width * height * depth );
-   dip::uint heapsize = heapmax / 4;
+   dip::uint heapmax = nPixels;
+   dip::uint heapsize = std::max( heapmax / 4, seeds.size() );
    GDTNode init{ 0, std::numeric_limits< sfloat >::max() };
    std::vector< GDTNode > heap( heapsize + 1, init );
 
-   dip::sint xx, yy, zz, offset;
-
-   // top plane
-   for( zz = 0; zz < nb_z; zz++ ) {
-      for( yy = 0; yy < height; yy++ ) {
-         offset = yy * sy + zz * sz;
-         for( xx = 0; xx < width; xx++ ) {
-            out[ offset ] = 0.0;
-            offset += sx;
-         }
-      }
-   }
-
-   // middle section
-   for( zz = nb_z; zz < z_end; zz++ ) {
-      // left edge
-      for( yy = 0; yy < nb_y; yy++ ) {
-         offset = yy * sy + zz * sz;
-         for( xx = 0; xx < width; xx++ ) {
-            out[ offset ] = 0.0;
-            offset += sx;
-         }
-      }
-      for( yy = nb_y; yy < y_end; yy++ ) {
-         // top X edge
-         offset = yy * sy + zz * sz;
-         for( xx = 0; xx < nb_x; xx++ ) {
-            out[ offset ] = 0.0;
-            offset += sx;
-         }
-         // seeds
-         offset = nb_x * sx + yy * sy + zz * sz;
-         for( xx = nb_x; xx < x_end; xx++ ) {
-            if( out[ offset ] == 0.0 ) {
-               for( dip::uint ll = 0; ll < nb_size; ll++ ) {
-                  if( out[ offset + address[ ll ]] != 0.0 ) {
-                     heap[ bottom ].offset = offset;
-                     heap[ bottom ].value = 0.0;
-                     bottom++;
-
-                     // heap large enough?
-                     if(( bottom > heapsize ) && ( heapsize != heapmax )) {
-                        // reallocate heap
-                        heap.resize( heapmax + 1, init );
-                        // update heapsize
-                        heapsize = heapmax;
-                     }
-
-                     // heap still large enough?
-                     DIP_THROW_IF( bottom > heapsize, "bottom > heapsize" );
-                     break;
-                  }
-               }
-            } else {
-               out[ offset ] = std::numeric_limits< sfloat >::max();
-            }
-            offset += sx;
-         }
-
-         // bottom X edge
-         offset = x_end * sx + yy * sy + zz * sz;
-         for( xx = x_end; xx < width; xx++ ) {
-            out[ offset ] = 0.0;
-            offset += sx;
-         }
-      }
-      // right edge
-      for( yy = y_end; yy < height; yy++ ) {
-         offset = yy * sy + zz * sz;
-         for( xx = 0; xx < width; xx++ ) {
-            out[ offset ] = 0.0;
-            offset += sx;
-         }
-      }
-   }
-
-   // bottom plane
-   for( zz = z_end; zz < depth; zz++ ) {
-      for( yy = 0; yy < height; yy++ ) {
-         offset = yy * sy + zz * sz;
-         for( xx = 0; xx < width; xx++ ) {
-            out[ offset ] = 0.0;
-            offset += sx;
-         }
-      }
+   // seeds
+   for( auto offset : seeds ) {
+      heap[ bottom ].offset = offset;
+      heap[ bottom ].value = 0.0;
+      bottom++;
    }
 
    // generate distances
@@ -461,6 +435,62 @@ void GDTProcessHeap(
    }
 }
 
+// Maximum number of buckets for `GDTProcessBuckets`, beyond this we use the heap
+constexpr dip::uint GDT_MAX_BUCKETS = 1u << 20;
+
+// Processes the pixels using a circular bucket queue (Dial's algorithm), where bucket `k` holds the pixels with
+// a distance in [k*bucketWidth,(k+1)*bucketWidth). Because `bucketWidth` is no larger than the smallest step cost,
+// pixels in the same bucket cannot improve each other's distance, and each bucket can be processed in any order.
+// Steps cost at most `nBuckets-1` bucket widths, so only `nBuckets` buckets are ever in use at the same time.
+// Costs O(1) per queue operation, compared to O(log N) for the heap.
+template< typename TPI >
+void GDTProcessBuckets(
+      void const* input,
+      sfloat* out,
+      sfloat* distance,
+      std::vector< dip::sint > const& seeds,
+      NeighborList const& neighborhood,
+      IntegerArray const& offsets,
+      dfloat bucketWidth,
+      dip::uint nBuckets
+) {
+   TPI const* in = static_cast< TPI const* >( input );
+   std::vector< sfloat > metric = neighborhood.CopyDistances< sfloat >();
+   dip::uint nb_size = metric.size();
+   std::vector< std::vector< GDTNode >> buckets( nBuckets );
+   std::vector< GDTNode > current;
+   buckets[ 0 ].reserve( seeds.size() );
+   for( auto offset : seeds ) {
+      buckets[ 0 ].push_back( { offset, 0.0 } );
+   }
+   dip::uint pending = seeds.size();
+   for( dip::uint level = 0; pending > 0; ++level ) {
+      current.clear();
+      current.swap( buckets[ level % nBuckets ] );
+      pending -= current.size();
+      for( auto const& node : current ) {
+         dip::sint expanding = node.offset;
+         sfloat uptonow = out[ expanding ];
+         if( uptonow < node.value ) {
+            continue; // stale entry, this pixel was reached through a shorter path
+         }
+         for( dip::uint jj = 0; jj < nb_size; ++jj ) {
+            dip::sint neig = expanding + offsets[ jj ];
+            sfloat value = uptonow + metric[ jj ] * static_cast< sfloat >( in[ neig ] );
+            if( value < out[ neig ] ) {
+               out[ neig ] = value;
+               if( distance ) {
+                  distance[ neig ] = distance[ expanding ] + metric[ jj ];
+               }
+               dip::uint bucket = std::max( static_cast< dip::uint >( static_cast< dfloat >( value ) / bucketWidth ), level + 1 );
+               buckets[ bucket % nBuckets ].push_back( { neig, value } );
+               ++pending;
+            }
+         }
+      }
+   }
+}
+
 } // namespace
 
 void GreyWeightedDistanceTransform(
@@ -476,11 +506,12 @@ void GreyWeightedDistanceTransform(
    DIP_THROW_IF( !c_grey.DataType().IsReal(), E::DATA_TYPE_NOT_SUPPORTED );
    DIP_THROW_IF( !in.DataType().IsBinary(), E::IMAGE_NOT_BINARY );
    dip::uint dims = in.Dimensionality();
-   DIP_THROW_IF(( dims < 2 ) || ( dims > 3 ), E::DIMENSIONALITY_NOT_SUPPORTED );
+   DIP_THROW_IF( dims < 1, E::DIMENSIONALITY_NOT_SUPPORTED );
    DIP_THROW_IF( in.Sizes() != c_grey.Sizes(), E::SIZES_DONT_MATCH );
 
    // we can only support non-negative images
-   DIP_THROW_IF( Minimum( in ).As< dfloat >() < 0.0, "Minimum input value < 0.0" );
+   MinMaxAccumulator greyRange = MaximumAndMinimum( c_grey );
+   DIP_THROW_IF( greyRange.Minimum() < 0.0, "Minimum input value < 0.0" );
 
    // what will we output?
    bool outputGDT = false;
@@ -529,13 +560,27 @@ void GreyWeightedDistanceTransform(
    NeighborList neighborhood{ metric, dims };
    IntegerArray offsets = neighborhood.ComputeOffsets( grey.Strides() );
 
-   // call templated function
-   DIP_OVL_CALL_REAL( GDTProcessHeap, (
-         grey.Origin(),
-         static_cast< sfloat* >( gdt.Origin() ),
-         distance.IsForged() ? static_cast< sfloat* >( distance.Origin() ) : nullptr,
-         grey.Sizes(), grey.Strides(), neighborhood, offsets
-   ), grey.DataType());
+   // find seeds
+   sfloat* gdtPtr = static_cast< sfloat* >( gdt.Origin() );
+   sfloat* distancePtr = distance.IsForged() ? static_cast< sfloat* >( distance.Origin() ) : nullptr;
+   std::vector< dip::sint > seeds = GDTInitialize( gdtPtr, grey.Sizes(), grey.Strides(), neighborhood.Border(), offsets );
+
+   // use a bucket queue if the ratio of largest to smallest step cost is bounded, otherwise a heap
+   std::vector< dfloat > metricDistances = neighborhood.CopyDistances< dfloat >();
+   dfloat minStep = *std::min_element( metricDistances.begin(), metricDistances.end() ) * greyRange.Minimum();
+   dfloat maxStep = *std::max_element( metricDistances.begin(), metricDistances.end() ) * greyRange.Maximum();
+   dip::uint nPixels = grey.NumberOfPixels();
+   dip::uint maxBuckets = std::min( GDT_MAX_BUCKETS, std::max( dip::uint( 1024 ), nPixels ));
+   if(( minStep > 0.0 ) && ( maxStep / minStep < static_cast< dfloat >( maxBuckets - 2 ))) {
+      dip::uint nBuckets = static_cast< dip::uint >( std::floor( maxStep / minStep )) + 2;
+      DIP_OVL_CALL_REAL( GDTProcessBuckets, (
+            grey.Origin(), gdtPtr, distancePtr, seeds, neighborhood, offsets, minStep, nBuckets
+      ), grey.DataType());
+   } else {
+      DIP_OVL_CALL_REAL( GDTProcessHeap, (
+            grey.Origin(), gdtPtr, distancePtr, nPixels, seeds, neighborhood, offsets
+      ), grey.DataType());
+   }
 
    // copy to output image
    if( outputGDT && outputDistance ) {
@@ -551,3 +596,41 @@ void GreyWeightedDistanceTransform(
 }
 
 } // namespace dip
+
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+#include "diplib/generation.h"
+#include "diplib/random.h"
+#include "diplib/testing.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the GreyWeightedDistanceTransform") {
+   dip::Image bin{ dip::UnsignedArray{ 40, 30 }, 1, dip::DT_BIN };
+   bin.Fill( 1 );
+   bin.At( 10, 12 ) = 0;
+   bin.At( 30, 20 ) = 0;
+   dip::Image grey{ dip::UnsignedArray{ 40, 30 }, 1, dip::DT_SFLOAT };
+   grey.Fill( 0 );
+   dip::Random random( 0 );
+   dip::UniformNoise( grey, grey, random, 1.0, 100.0 );
+   grey.Convert( dip::DT_UINT8 );
+   // Integer weights between 1 and 100: bucket queue
+   dip::Image buckets = dip::GreyWeightedDistanceTransform( grey, bin );
+   // A zero weight in the image border (which is never entered) forces the heap
+   grey.At( 0, 0 ) = 0;
+   dip::Image heap = dip::GreyWeightedDistanceTransform( grey, bin );
+   DOCTEST_CHECK( dip::testing::CompareImages( buckets, heap, 1e-3 ));
+
+   // 4D image
+   bin = dip::Image{ dip::UnsignedArray{ 7, 7, 7, 7 }, 1, dip::DT_BIN };
+   bin.Fill( 1 );
+   bin.At( dip::UnsignedArray{ 3, 3, 3, 3 } ) = 0;
+   grey = dip::Image{ dip::UnsignedArray{ 7, 7, 7, 7 }, 1, dip::DT_UINT8 };
+   grey.Fill( 1 );
+   dip::Image gdt = dip::GreyWeightedDistanceTransform( grey, bin, { "chamfer", 1 } );
+   DOCTEST_CHECK( gdt.At( dip::UnsignedArray{ 3, 3, 3, 3 } ).As< dip::dfloat >() == 0.0 );
+   DOCTEST_CHECK( gdt.At( dip::UnsignedArray{ 4, 3, 3, 3 } ).As< dip::dfloat >() == doctest::Approx( 1.0 ));
+   DOCTEST_CHECK( gdt.At( dip::UnsignedArray{ 3, 3, 3, 5 } ).As< dip::dfloat >() == doctest::Approx( 2.0 ));
+}
+
+#endif // DIP__ENABLE_DOCTEST
@@ -21,6 +21,7 @@
 #ifdef DIP__HAS_ICS
 
 #include <cstdlib> // std::strtoul
+#include <cstring>
 
 #include "diplib.h"
 #include "diplib/file_io.h"
@@ -28,10 +29,22 @@
 #include "diplib/library/copy_buffer.h"
 
 #include "libics.h"
+#include "libics_ll.h"
+
+#if defined( _WIN32 )
+   #define DIP__HAS_MMAP
+   #define WIN32_LEAN_AND_MEAN
+   #define NOMINMAX
+   #include <windows.h>
+#elif defined( __unix__ ) || defined( __APPLE__ )
+   #define DIP__HAS_MMAP
+   #include <fcntl.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <unistd.h>
+#endif
 
 // TODO: Reorder dimensions when reading, to match standard x,y,z,t order.
-// TODO: When reading, check to see if image's strides match those in the file.
-// TODO: Option "fast" to reorder dimensions when reading, to read without strides.
 
 namespace dip {
 
@@ -274,6 +287,62 @@ class IcsFile {
       ICS* ics_ = nullptr;
 };
 
+// Maps `length` bytes of the file `filename`, starting at `offset`, into memory. Returns a data segment pointing
+// at the first mapped byte, which unmaps the file when released. Returns an empty data segment if the file cannot
+// be mapped. The mapping is copy-on-write: the image can be modified, but changes are never written to the file.
+DataSegment MapFile( char const* filename, dip::uint offset, dip::uint length ) {
+#if defined( _WIN32 )
+   HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+   if( file == INVALID_HANDLE_VALUE ) {
+      return {};
+   }
+   LARGE_INTEGER fileSize;
+   if( !GetFileSizeEx( file, &fileSize ) || ( static_cast< dip::uint >( fileSize.QuadPart ) < offset + length )) {
+      CloseHandle( file );
+      return {};
+   }
+   HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr );
+   CloseHandle( file ); // the mapping keeps the file open
+   if( mapping == nullptr ) {
+      return {};
+   }
+   SYSTEM_INFO info;
+   GetSystemInfo( &info );
+   dip::uint start = ( offset / info.dwAllocationGranularity ) * info.dwAllocationGranularity;
+   void* base = MapViewOfFile( mapping, FILE_MAP_COPY, static_cast< DWORD >( start >> 32 ),
+                               static_cast< DWORD >( start & 0xFFFFFFFFu ), offset - start + length );
+   CloseHandle( mapping ); // the view keeps the mapping alive
+   if( base == nullptr ) {
+      return {};
+   }
+   return DataSegment{ static_cast< uint8* >( base ) + ( offset - start ), [ base ]( void* ) { UnmapViewOfFile( base ); }};
+#elif defined( DIP__HAS_MMAP )
+   int fd = open( filename, O_RDONLY );
+   if( fd < 0 ) {
+      return {};
+   }
+   struct stat fileStat;
+   if(( fstat( fd, &fileStat ) != 0 ) || ( static_cast< dip::uint >( fileStat.st_size ) < offset + length )) {
+      close( fd );
+      return {};
+   }
+   dip::uint pageSize = static_cast< dip::uint >( sysconf( _SC_PAGESIZE ));
+   dip::uint start = ( offset / pageSize ) * pageSize;
+   dip::uint mapLength = offset - start + length;
+   void* base = mmap( nullptr, mapLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast< off_t >( start ));
+   close( fd ); // the mapping keeps the file open
+   if( base == MAP_FAILED ) {
+      return {};
+   }
+   return DataSegment{ static_cast< uint8* >( base ) + ( offset - start ), [ base, mapLength ]( void* ) { munmap( base, mapLength ); }};
+#else
+   ( void )filename;
+   ( void )offset;
+   ( void )length;
+   return {};
+#endif
+}
+
 struct GetICSInfoData {
    FileInformation fileInformation;
    UnsignedArray fileSizes;   // Sizes in the order they appear in the file (including the tensor dimension).
@@ -387,6 +456,88 @@ GetICSInfoData GetICSInfo( IcsFile& icsFile ) {
    return data;
 }
 
+// True if the samples, of size `sizeOf`, are stored in the file in the byte order of this machine
+bool IsNativeByteOrder( ICS const* ics, dip::uint sizeOf ) {
+   uint16 one = 1;
+   uint8 firstByte;
+   std::memcpy( &firstByte, &one, 1 );
+   bool littleEndian = firstByte == 1;
+   for( dip::uint ii = 0; ii < sizeOf; ++ii ) {
+      int expected = static_cast< int >( littleEndian ? ii + 1 : sizeOf - ii );
+      if( ics->byteOrder[ ii ] != expected ) {
+         return false;
+      }
+   }
+   return true;
+}
+
+// Finds the file that contains the pixel data, and the offset of the first pixel within it. Returns false if the
+// pixel data cannot be used directly, because it is compressed or not in the byte order of this machine.
+// libics has no public functions that give this information, so we read it from the `ICS` structure and use
+// `IcsGetIdsName` from the low-level interface. This is the only place where we rely on libics internals.
+bool GetICSRawDataLocation( ICS const* ics, dip::uint sizeOf, String& dataFile, dip::uint& offset ) {
+   if(( ics->compression != IcsCompr_uncompressed ) || !IsNativeByteOrder( ics, sizeOf )) {
+      return false;
+   }
+   if( ics->version == 1 ) {
+      char idsName[ ICS_MAXPATHLEN ];
+      IcsGetIdsName( idsName, ics->filename );
+      dataFile = idsName;
+      offset = 0;
+   } else {
+      if( ics->srcFile[ 0 ] == '\0' ) {
+         return false;
+      }
+      dataFile = ics->srcFile;
+      offset = ics->srcOffset;
+   }
+   return true;
+}
+
+// If the pixel data in the file can be used directly (uncompressed and in the native byte order), maps the file
+// into memory and sets `out` to refer to the part selected by `roi` and `channels`. `strides` are the strides of
+// the image in the file, with the tensor dimension last. Returns false if the file cannot be mapped.
+bool MapICSData(
+      Image& out,
+      IcsFile& icsFile,
+      GetICSInfoData const& data,
+      IntegerArray const& strides,
+      RangeArray const& roi,
+      Range const& channels
+) {
+   if( out.IsProtected() || out.HasExternalInterface() ) {
+      // We cannot replace the data segment of `out`
+      return false;
+   }
+   dip::uint sizeOf = data.fileInformation.dataType.SizeOf();
+   String dataFile;
+   dip::uint offset;
+   if( !GetICSRawDataLocation( icsFile, sizeOf, dataFile, offset )) {
+      return false;
+   }
+   DataSegment segment = MapFile( dataFile.c_str(), offset, data.fileSizes.product() * sizeOf );
+   if( !segment ) {
+      return false;
+   }
+   // Find the origin and strides of the ROI within the mapped data
+   dip::uint nDims = data.fileInformation.sizes.size();
+   uint8* origin = static_cast< uint8* >( segment.get() );
+   UnsignedArray sizes( nDims );
+   IntegerArray outStrides( nDims );
+   for( dip::uint ii = 0; ii < nDims; ++ii ) {
+      origin += static_cast< dip::sint >( roi[ ii ].Offset() * sizeOf ) * strides[ ii ];
+      sizes[ ii ] = roi[ ii ].Size();
+      outStrides[ ii ] = strides[ ii ] * static_cast< dip::sint >( roi[ ii ].step );
+   }
+   dip::sint tensorStride = 1;
+   if( data.fileInformation.tensorElements > 1 ) {
+      origin += static_cast< dip::sint >( channels.Offset() * sizeOf ) * strides.back();
+      tensorStride = strides.back() * static_cast< dip::sint >( channels.step );
+   }
+   out = Image( segment, origin, data.fileInformation.dataType, sizes, outStrides, Tensor( channels.Size() ), tensorStride );
+   return true;
+}
+
 } // namespace
 
 FileInformation ImageReadICS(
@@ -396,7 +547,15 @@ FileInformation ImageReadICS(
       Range channels,
       String const& mode
 ) {
-   bool fast = BooleanFromString( mode, "fast", "" );
+   bool fast = false;
+   bool map = false;
+   if( mode == "fast" ) {
+      fast = true;
+   } else if( mode == "mmap" ) {
+      map = true;
+   } else if( !mode.empty() ) {
+      DIP_THROW_INVALID_FLAG( mode );
+   }
 
    // open the ICS file
    IcsFile icsFile( filename, "r" );
@@ -479,8 +638,14 @@ FileInformation ImageReadICS(
       }
    }
 
-   // forge the image
-   out.ReForge( outSizes, outTensor, data.fileInformation.dataType );
+   // if "mmap", try to map the file into memory, otherwise forge the image
+   bool mapped = false;
+   if( map ) {
+      DIP_STACK_TRACE_THIS( mapped = MapICSData( out, icsFile, data, strides, roi, channels ));
+   }
+   if( !mapped ) {
+      out.ReForge( outSizes, outTensor, data.fileInformation.dataType );
+   }
    if( outTensor == data.fileInformation.tensorElements ) {
       out.SetColorSpace( data.fileInformation.colorSpace );
    }
@@ -527,13 +692,14 @@ FileInformation ImageReadICS(
    }
    //std::cout << "[ImageReadICS] outRef = " << outRef << std::endl;
 
-   if( strides == out.Strides() ) {
+   // If the file is mapped, there is nothing to read, pixels are loaded from the file when accessed
+   if( !mapped && ( strides == out.Strides() )) {
       // Fast reading!
       //std::cout << "[ImageReadICS] fast reading!\n";
 
       CALL_ICS( IcsGetData( icsFile, outRef.Origin(), outRef.NumberOfPixels() ), "Couldn't read pixel data from ICS file" );
 
-   } else {
+   } else if( !mapped ) {
       // Reading using strides
       //std::cout << "[ImageReadICS] reading with strides\n";
    
@@ -20,18 +20,26 @@
 
 #ifdef DIP__HAS_TIFF
 
+#include <exception>
+#include <future>
+#include <limits>
+
 #include "diplib.h"
 #include "diplib/file_io.h"
 #include "diplib/generic_iterators.h"
+#include "diplib/multithreading.h"
 
 #include <tiffio.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace dip {
 
 namespace {
 
 constexpr char const* TIFF_NO_TAG = "Invalid TIFF: Required tag not found";
-constexpr char const* TIFF_TILES_NOT_SUPPORTED = "Tiled TIFF format not yet supported";
 constexpr char const* TIFF_DIRECTORY_NOT_FOUND = "Could not find the requested image in the file";
 
 class TiffFile {
@@ -73,6 +81,50 @@ class TiffFile {
       String filename_;
 };
 
+//
+// Directories
+//
+
+// Directories are always selected by their index with `TIFFSetDirectory`. Jumping to a directory by its file
+// offset with `TIFFSetSubDirectory` confuses the directory loop detection in libtiff versions before 4.5.
+// `TIFFSetDirectory` takes a `tdir_t`, which is a 16-bit integer in those versions, and
+// `TIFFNumberOfDirectories` stops counting at the largest value a `tdir_t` can hold. Beyond that
+// value, we step through the directories one at a time with `TIFFReadDirectory`. Note that these old
+// versions of libtiff refuse to read more than 65535 directories even this way.
+constexpr dip::uint TIFF_MAX_DIRECTORY = std::numeric_limits< tdir_t >::max();
+
+void SetTIFFDirectory( TiffFile& tiff, dip::uint directory ) {
+   tdir_t first = static_cast< tdir_t >( std::min( directory, TIFF_MAX_DIRECTORY ));
+   DIP_THROW_IF( TIFFSetDirectory( tiff, first ) == 0, TIFF_DIRECTORY_NOT_FOUND );
+   for( dip::uint ii = first; ii < directory; ++ii ) {
+      DIP_THROW_IF( TIFFReadDirectory( tiff ) == 0, TIFF_DIRECTORY_NOT_FOUND );
+   }
+}
+
+dip::uint NumberOfTIFFDirectories( TiffFile& tiff ) {
+   dip::uint count = TIFFNumberOfDirectories( tiff );
+   if( count < TIFF_MAX_DIRECTORY ) {
+      return count;
+   }
+   dip::uint current = TIFFCurrentDirectory( tiff );
+   SetTIFFDirectory( tiff, count - 1 );
+   while( TIFFReadDirectory( tiff )) {
+      ++count;
+   }
+   SetTIFFDirectory( tiff, current );
+   return count;
+}
+
+// Returns the indices of the directories selected by `imageNumbers` (which must be fixed), in the
+// order given by the range.
+std::vector< dip::uint > TIFFDirectoryIndices( Range const& imageNumbers ) {
+   std::vector< dip::uint > indices( imageNumbers.Size() );
+   for( dip::uint ii = 0; ii < indices.size(); ++ii ) {
+      indices[ ii ] = static_cast< dip::uint >( imageNumbers.start + static_cast< dip::sint >( ii ) * imageNumbers.Step() );
+   }
+   return indices;
+}
+
 DataType FindTIFFDataType( TiffFile& tiff ) {
    uint16 bitsPerSample;
    if( !TIFFGetField( tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample )) {
@@ -232,12 +284,179 @@ GetTIFFInfoData GetTIFFInfo( TiffFile& tiff ) {
    }
    data.fileInformation.pixelSize.Set( 1, ps );
 
-   // Number of images in file
-   data.fileInformation.numberOfImages = TIFFNumberOfDirectories( tiff );
+   // Number of images in file (counting these is expensive for large files, the caller fills this in when needed)
+   data.fileInformation.numberOfImages = 0;
 
    return data;
 }
 
+//
+// Tiles, strips and regions of interest
+//
+
+// Number of threads to use when decoding `nBlocks` tiles or strips, containing a total of `nPixels` pixels.
+// Uncompressed data is limited by I/O, not by the CPU, and is always read by a single thread. When called from
+// within a parallel region (reading many planes in parallel), each plane is decoded by a single thread.
+dip::uint ThreadsForDecoding( TiffFile& tiff, dip::uint nBlocks, dip::uint nPixels ) {
+#ifdef _OPENMP
+   if( omp_in_parallel() ) {
+      return 1;
+   }
+#endif
+   uint16 compression;
+   TIFFGetFieldDefaulted( tiff, TIFFTAG_COMPRESSION, &compression );
+   if(( compression == COMPRESSION_NONE ) || ( nPixels < threadingThreshold )) {
+      return 1;
+   }
+   return std::min( GetNumberOfThreads(), nBlocks );
+}
+
+// Reads the tiles or strips of the current directory that overlap the region of interest `roi`, for sample plane
+// `sample` (always 0 for PLANARCONFIG_CONTIG). `roi` has two fixed ranges with `start <= stop`. For each image row
+// selected by `roi`, calls `copyRow( src, first, count, x, y )`. `src` points at the start of the row within the
+// decoded tile or strip, `first` is the index within that row of the first pixel to copy, `count` is the number of
+// pixels to copy (each `roi[ 0 ].step` pixels apart), and `x` and `y` are the output coordinates of the first pixel.
+// Tiles and strips that do not overlap the ROI are not read.
+//
+// Compressed tiles and strips are decoded in parallel. libtiff handles cannot be shared among threads, so each
+// additional thread opens the file again. `copyRow` is then called concurrently, for disjoint sets of pixels.
+template< typename CopyRow >
+void ReadTIFFBlocks(
+      TiffFile& tiff,
+      UnsignedArray const& imageSizes,
+      RangeArray const& roi,
+      uint16 sample,
+      CopyRow const& copyRow
+) {
+   dip::uint imageWidth = imageSizes[ 0 ];
+   dip::uint imageLength = imageSizes[ 1 ];
+   bool tiled = TIFFIsTiled( tiff );
+   dip::uint blockWidth;
+   dip::uint blockLength;
+   dip::uint blockRowSize;
+   tmsize_t blockSize;
+   if( tiled ) {
+      uint32 tileWidth;
+      uint32 tileLength;
+      DIP_THROW_IF( !TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth ), TIFF_NO_TAG );
+      DIP_THROW_IF( !TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tileLength ), TIFF_NO_TAG );
+      blockWidth = tileWidth;
+      blockLength = tileLength;
+      blockRowSize = static_cast< dip::uint >( TIFFTileRowSize( tiff ));
+      blockSize = TIFFTileSize( tiff );
+   } else {
+      uint32 rowsPerStrip;
+      TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip );
+      blockWidth = imageWidth;
+      blockLength = std::min< dip::uint >( rowsPerStrip, imageLength );
+      blockRowSize = static_cast< dip::uint >( TIFFScanlineSize( tiff ));
+      blockSize = TIFFStripSize( tiff );
+   }
+
+   // Find the blocks that overlap the ROI
+   struct Block {
+      dip::uint x;      // coordinates of the block's top-left pixel
+      dip::uint y;
+      dip::uint xFirst; // first column and row within the block that are part of the ROI
+      dip::uint yFirst;
+      dip::uint yEnd;   // last row within the block to consider
+      dip::uint count;  // number of ROI pixels in each row
+   };
+   std::vector< Block > blocks;
+   dip::uint x0 = roi[ 0 ].Offset();
+   dip::uint xStep = roi[ 0 ].step;
+   dip::uint x1 = x0 + ( roi[ 0 ].Size() - 1 ) * xStep;
+   dip::uint y0 = roi[ 1 ].Offset();
+   dip::uint yStep = roi[ 1 ].step;
+   dip::uint y1 = y0 + ( roi[ 1 ].Size() - 1 ) * yStep;
+   for( dip::uint by = ( y0 / blockLength ) * blockLength; by <= y1; by += blockLength ) {
+      dip::uint yEnd = std::min( std::min( by + blockLength, imageLength ) - 1, y1 ); // last row in block to consider
+      dip::uint yFirst = by <= y0 ? y0 : y0 + div_ceil( by - y0, yStep ) * yStep;  // first row in block in the ROI
+      if( yFirst > yEnd ) {
+         continue;
+      }
+      for( dip::uint bx = ( x0 / blockWidth ) * blockWidth; bx <= x1; bx += blockWidth ) {
+         dip::uint xEnd = std::min( std::min( bx + blockWidth, imageWidth ) - 1, x1 );
+         dip::uint xFirst = bx <= x0 ? x0 : x0 + div_ceil( bx - x0, xStep ) * xStep;
+         if( xFirst > xEnd ) {
+            continue;
+         }
+         blocks.push_back( { bx, by, xFirst, yFirst, yEnd, ( xEnd - xFirst ) / xStep + 1 } );
+      }
+   }
+
+   // Decodes the blocks `first`, `first + step`, `first + 2 * step`, ... using `handle`
+   auto readBlocks = [ & ]( TIFF* handle, dip::uint first, dip::uint step ) {
+      std::vector< uint8 > buf( static_cast< dip::uint >( blockSize ));
+      for( dip::uint ii = first; ii < blocks.size(); ii += step ) {
+         Block const& block = blocks[ ii ];
+         uint32 bx = static_cast< uint32 >( block.x );
+         uint32 by = static_cast< uint32 >( block.y );
+         if( tiled ) {
+            uint32 tile = TIFFComputeTile( handle, bx, by, 0, sample );
+            DIP_THROW_IF( TIFFReadEncodedTile( handle, tile, buf.data(), blockSize ) < 0, "Error reading data" );
+         } else {
+            uint32 strip = TIFFComputeStrip( handle, by, sample );
+            DIP_THROW_IF( TIFFReadEncodedStrip( handle, strip, buf.data(), blockSize ) < 0, "Error reading data" );
+         }
+         for( dip::uint y = block.yFirst; y <= block.yEnd; y += yStep ) {
+            copyRow( buf.data() + ( y - block.y ) * blockRowSize, block.xFirst - block.x, block.count,
+                     ( block.xFirst - x0 ) / xStep, ( y - y0 ) / yStep );
+         }
+      }
+   };
+
+   dip::uint nThreads = ThreadsForDecoding( tiff, blocks.size(), roi[ 0 ].Size() * roi[ 1 ].Size() );
+   if( nThreads <= 1 ) {
+      readBlocks( tiff, 0, 1 );
+      return;
+   }
+   dip::uint directory = TIFFCurrentDirectory( tiff );
+   std::vector< std::exception_ptr > exceptions( nThreads );
+   #ifdef _OPENMP
+   #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( static, 1 )
+   #endif
+   for( dip::sint tt = 0; tt < static_cast< dip::sint >( nThreads ); ++tt ) {
+      dip::uint ii = static_cast< dip::uint >( tt );
+      try {
+         if( ii == 0 ) {
+            readBlocks( tiff, 0, nThreads );
+         } else {
+            TiffFile local( tiff.FileName() );
+            SetTIFFDirectory( local, directory );
+            readBlocks( local, ii, nThreads );
+         }
+      } catch( ... ) {
+         exceptions[ ii ] = std::current_exception();
+      }
+   }
+   for( auto const& e : exceptions ) {
+      if( e ) {
+         std::rethrow_exception( e );
+      }
+   }
+}
+
+// True if the tiles or strips need to be read through `ReadTIFFBlocks`: the file is tiled, we read only an ROI,
+// or the strips will be decoded in parallel.
+bool UseBlockReader( TiffFile& tiff, RangeArray const& roi, UnsignedArray const& imageSizes ) {
+   if( TIFFIsTiled( tiff ) || ( roi[ 0 ].step != 1 ) || ( roi[ 0 ].Size() != imageSizes[ 0 ] ) ||
+       ( roi[ 1 ].step != 1 ) || ( roi[ 1 ].Size() != imageSizes[ 1 ] )) {
+      return true;
+   }
+   return ThreadsForDecoding( tiff, TIFFNumberOfStrips( tiff ), imageSizes[ 0 ] * imageSizes[ 1 ] ) > 1;
+}
+
+// Output image sizes for `roi`
+inline UnsignedArray RoiSizes( RangeArray const& roi ) {
+   return { roi[ 0 ].Size(), roi[ 1 ].Size() };
+}
+
+// Offset in samples of pixel (x,y)
+inline dip::sint PixelOffset( dip::uint x, dip::uint y, IntegerArray const& strides ) {
+   return static_cast< dip::sint >( x ) * strides[ 0 ] + static_cast< dip::sint >( y ) * strides[ 1 ];
+}
+
 //
 // Color Map
 //
@@ -309,7 +528,8 @@ inline void ExpandColourMap8(
 void ReadTIFFColorMap(
       Image& image,
       TiffFile& tiff,
-      GetTIFFInfoData& data
+      GetTIFFInfoData& data,
+      RangeArray const& roi
 ) {
    // Read the tags
    uint16 bitsPerSample;
@@ -324,17 +544,36 @@ void ReadTIFFColorMap(
    DIP_THROW_IF( !TIFFGetField( tiff, TIFFTAG_COLORMAP, &CMRed, &CMGreen, &CMBlue ), TIFF_NO_TAG );
 
    // Forge the image
-   image.ReForge( data.fileInformation.sizes, 3, DT_UINT16 );
+   image.ReForge( RoiSizes( roi ), 3, DT_UINT16 );
    uint16* imagedata = static_cast< uint16* >( image.Origin() );
 
-   // Read the image data stripwise
-   uint32 imageWidth = static_cast< uint32 >( image.Size( 0 ));
-   uint32 imageLength = static_cast< uint32 >( image.Size( 1 ));
+   // Read the image data
+   uint32 imageWidth = static_cast< uint32 >( data.fileInformation.sizes[ 0 ] );
+   uint32 imageLength = static_cast< uint32 >( data.fileInformation.sizes[ 1 ] );
    dip::uint scanline = static_cast< dip::uint >( TIFFScanlineSize( tiff ));
    if( bitsPerSample == 4 ) {
-      DIP_THROW_IF(( scanline != div_ceil( image.Size( 0 ), 2u )), "Wrong scanline size" );
+      DIP_THROW_IF(( scanline != div_ceil( data.fileInformation.sizes[ 0 ], 2u )), "Wrong scanline size" );
    } else {
-      DIP_THROW_IF(( scanline != image.Size( 0 )), "Wrong scanline size" );
+      DIP_THROW_IF(( scanline != imageWidth ), "Wrong scanline size" );
+   }
+   if( UseBlockReader( tiff, roi, data.fileInformation.sizes )) {
+      // Tilewise, in parallel, or only the strips overlapping the ROI
+      dip::uint step = roi[ 0 ].step;
+      dip::sint green = image.TensorStride();
+      dip::sint blue = 2 * image.TensorStride();
+      ReadTIFFBlocks( tiff, data.fileInformation.sizes, roi, 0, [ & ]( uint8 const* src, dip::uint first, dip::uint count, dip::uint x, dip::uint y ) {
+         uint16* dest = imagedata + PixelOffset( x, y, image.Strides() );
+         for( dip::uint ii = 0, jj = first; ii < count; ++ii, jj += step ) {
+            dip::uint index = bitsPerSample == 4
+                              ? ( static_cast< dip::uint >( src[ jj / 2 ] ) >> ( jj % 2 ? 0 : 4 )) & 0x0Fu
+                              : static_cast< dip::uint >( src[ jj ] );
+            *dest = CMRed[ index ];
+            *( dest + green ) = CMGreen[ index ];
+            *( dest + blue ) = CMBlue[ index ];
+            dest += image.Stride( 0 );
+         }
+      } );
+      return;
    }
    std::vector< uint8 > buf( static_cast< dip::uint >( TIFFStripSize( tiff )));
    uint32 rowsPerStrip;
@@ -413,17 +652,31 @@ inline void CopyBufferInv1(
 void ReadTIFFBinary(
       Image& image,
       TiffFile& tiff,
-      GetTIFFInfoData& data
+      GetTIFFInfoData& data,
+      RangeArray const& roi
 ) {
    // Forge the image
-   image.ReForge( data.fileInformation.sizes, data.fileInformation.tensorElements, DT_BIN );
+   image.ReForge( RoiSizes( roi ), data.fileInformation.tensorElements, DT_BIN );
    uint8* imagedata = static_cast< uint8* >( image.Origin() );
 
-   // Read the image data stripwise
-   uint32 imageWidth = static_cast< uint32 >( image.Size( 0 ));
-   uint32 imageLength = static_cast< uint32 >( image.Size( 1 ));
+   // Read the image data
+   uint32 imageWidth = static_cast< uint32 >( data.fileInformation.sizes[ 0 ] );
+   uint32 imageLength = static_cast< uint32 >( data.fileInformation.sizes[ 1 ] );
    dip::uint scanline = static_cast< dip::uint >( TIFFScanlineSize( tiff ));
-   DIP_THROW_IF(( scanline != div_ceil( image.Size( 0 ), 8u )), "Wrong scanline size" );
+   DIP_THROW_IF(( scanline != div_ceil( data.fileInformation.sizes[ 0 ], 8u )), "Wrong scanline size" );
+   if( UseBlockReader( tiff, roi, data.fileInformation.sizes )) {
+      // Tilewise, in parallel, or only the strips overlapping the ROI
+      dip::uint step = roi[ 0 ].step;
+      uint8 foreground = data.photometricInterpretation == PHOTOMETRIC_MINISWHITE ? 0 : 1;
+      ReadTIFFBlocks( tiff, data.fileInformation.sizes, roi, 0, [ & ]( uint8 const* src, dip::uint first, dip::uint count, dip::uint x, dip::uint y ) {
+         uint8* dest = imagedata + PixelOffset( x, y, image.Strides() );
+         for( dip::uint ii = 0, jj = first; ii < count; ++ii, jj += step ) {
+            *dest = ( src[ jj / 8 ] & ( 0x80u >> ( jj % 8 ))) ? foreground : static_cast< uint8 >( 1 - foreground );
+            dest += image.Stride( 0 );
+         }
+      } );
+      return;
+   }
    std::vector< uint8 > buf( static_cast< dip::uint >( TIFFStripSize( tiff )));
    uint32 rowsPerStrip;
    TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip );
@@ -556,12 +809,13 @@ inline bool StridesAreNormal(
 
 void ReadTIFFData(
       uint8* imagedata,
-      UnsignedArray const& sizes,
-      IntegerArray const& strides,
+      UnsignedArray const& sizes,     // sizes of the image in the file
+      IntegerArray const& strides,    // strides of the image to write to, which has the sizes of the ROI
       dip::uint tensorElements,
       dip::sint tensorStride,
       DataType dataType,
-      TiffFile& tiff
+      TiffFile& tiff,
+      RangeArray const& roi
 ) {
    // Planar configuration?
    uint16 planarConfiguration = PLANARCONFIG_SEPARATE;
@@ -571,11 +825,58 @@ void ReadTIFFData(
       }
    }
 
-   // Read the image data stripwise
    dip::uint sizeOf = dataType.SizeOf();
+   dip::uint scanline = static_cast< dip::uint >( TIFFScanlineSize( tiff ));
+
+   // Read the image data tilewise, in parallel, or only the strips overlapping the ROI
+   if( UseBlockReader( tiff, roi, sizes )) {
+      dip::uint step = roi[ 0 ].step;
+      dip::sint destStride = strides[ 0 ] * static_cast< dip::sint >( sizeOf );
+      if( planarConfiguration == PLANARCONFIG_CONTIG ) {
+         DIP_THROW_IF(( scanline != sizes[ 0 ] * tensorElements * sizeOf ), "Wrong scanline size" );
+         dip::uint pixelBytes = tensorElements * sizeOf;
+         ReadTIFFBlocks( tiff, sizes, roi, 0, [ & ]( uint8 const* src, dip::uint first, dip::uint count, dip::uint x, dip::uint y ) {
+            uint8* dest = imagedata + PixelOffset( x, y, strides ) * static_cast< dip::sint >( sizeOf );
+            src += first * pixelBytes;
+            dip::uint width = step == 1 ? count : 1; // with subsampling, copy one pixel at the time
+            for( dip::uint ii = 0; ii < count; ii += width ) {
+               if( sizeOf == 1 ) {
+                  CopyBufferMultiChannel8( dest, src, tensorElements, width, 1, tensorStride, strides );
+               } else {
+                  CopyBufferMultiChannelN( dest, src, tensorElements, width, 1, tensorStride, strides, sizeOf );
+               }
+               src += step * pixelBytes;
+               dest += destStride;
+            }
+         } );
+      } else if( planarConfiguration == PLANARCONFIG_SEPARATE ) {
+         DIP_THROW_IF(( scanline != sizes[ 0 ] * sizeOf ), "Wrong scanline size" );
+         for( uint16 s = 0; s < tensorElements; ++s ) {
+            uint8* imagebase = imagedata + static_cast< dip::sint >( s * sizeOf ) * tensorStride;
+            ReadTIFFBlocks( tiff, sizes, roi, s, [ & ]( uint8 const* src, dip::uint first, dip::uint count, dip::uint x, dip::uint y ) {
+               uint8* dest = imagebase + PixelOffset( x, y, strides ) * static_cast< dip::sint >( sizeOf );
+               src += first * sizeOf;
+               dip::uint width = step == 1 ? count : 1;
+               for( dip::uint ii = 0; ii < count; ii += width ) {
+                  if( sizeOf == 1 ) {
+                     CopyBuffer8( dest, src, width, 1, strides );
+                  } else {
+                     CopyBufferN( dest, src, width, 1, strides, sizeOf );
+                  }
+                  src += step * sizeOf;
+                  dest += destStride;
+               }
+            } );
+         }
+      } else {
+         DIP_THROW( "Unsupported TIFF: unknown PlanarConfiguration value" );
+      }
+      return;
+   }
+
+   // Read the image data stripwise
    uint32 rowsPerStrip;
    TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip );
-   dip::uint scanline = static_cast< dip::uint >( TIFFScanlineSize( tiff ));
    tsize_t stripsize = TIFFStripSize( tiff );
    if( planarConfiguration == PLANARCONFIG_CONTIG ) {
       // 1234123412341234....
@@ -647,82 +948,205 @@ void ReadTIFFData(
 void ReadTIFFGreyValue(
       Image& image,
       TiffFile& tiff,
-      GetTIFFInfoData& data
+      GetTIFFInfoData& data,
+      RangeArray const& roi
 ) {
    // Forge the image
-   image.ReForge( data.fileInformation.sizes, data.fileInformation.tensorElements, data.fileInformation.dataType );
+   image.ReForge( RoiSizes( roi ), data.fileInformation.tensorElements, data.fileInformation.dataType );
    uint8* imagedata = static_cast< uint8* >( image.Origin() );
 
    // Read the image data
    DIP_STACK_TRACE_THIS( ReadTIFFData(
-         imagedata, image.Sizes(), image.Strides(), image.TensorElements(), image.TensorStride(),
-         image.DataType(), tiff ));
+         imagedata, data.fileInformation.sizes, image.Strides(), image.TensorElements(), image.TensorStride(),
+         image.DataType(), tiff, roi ));
 
    if( data.photometricInterpretation == PHOTOMETRIC_MINISWHITE ) {
       Invert( image, image );
    }
 }
 
-void ImageReadTIFFStack(
+// Tests the current directory of `tiff` to make sure it matches the first image plane of a stack
+void CheckTIFFStackPlane(
+      TiffFile& tiff,
+      UnsignedArray const& sizes,
+      DataType dataType,
+      dip::uint tensorElements
+) {
+   uint32 temp32;
+   DIP_THROW_IF( !TIFFGetField( tiff, TIFFTAG_IMAGEWIDTH, &temp32 ), TIFF_NO_TAG );
+   DIP_THROW_IF( temp32 != sizes[ 0 ], "Reading multi-slice TIFF: width of images not consistent" );
+   DIP_THROW_IF( !TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &temp32 ), TIFF_NO_TAG );
+   DIP_THROW_IF( temp32 != sizes[ 1 ], "Reading multi-slice TIFF: length of images not consistent" );
+   uint16 photometricInterpretation;
+   if( !TIFFGetField( tiff, TIFFTAG_PHOTOMETRIC, &photometricInterpretation )) {
+      photometricInterpretation = PHOTOMETRIC_MINISBLACK;
+   }
+   DataType planeDataType;
+   uint16 samplesPerPixel;
+   if( photometricInterpretation == PHOTOMETRIC_PALETTE ) {
+      planeDataType = DT_UINT16;
+      samplesPerPixel = 3;
+   } else {
+      DIP_STACK_TRACE_THIS( planeDataType = FindTIFFDataType( tiff ));
+      if( !TIFFGetField( tiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel )) {
+         samplesPerPixel = 1;
+      }
+   }
+   DIP_THROW_IF( planeDataType != dataType, "Reading multi-slice TIFF: data type not consistent" );
+   DIP_THROW_IF( samplesPerPixel != tensorElements, "Reading multi-slice TIFF: samples per pixel not consistent" );
+}
+
+void ReadTIFFStack(
       Image& image,
       TiffFile& tiff,
       GetTIFFInfoData& data,
-      Range const& imageNumbers
+      Range const& imageNumbers,
+      RangeArray const& roi
 ) {
+   // Find the image planes to read
+   std::vector< dip::uint > directories = TIFFDirectoryIndices( imageNumbers );
+   dip::uint nPlanes = directories.size();
+
    // Forge the image
-   data.fileInformation.sizes.push_back( imageNumbers.Size() );
-   image.ReForge( data.fileInformation.sizes, data.fileInformation.tensorElements, data.fileInformation.dataType );
+   UnsignedArray planeSizes = data.fileInformation.sizes;
+   data.fileInformation.sizes.push_back( nPlanes );
+   UnsignedArray sizes = RoiSizes( roi );
+   sizes.push_back( nPlanes );
+   image.ReForge( sizes, data.fileInformation.tensorElements, data.fileInformation.dataType );
    uint8* imagedata = static_cast< uint8* >( image.Origin() );
    dip::sint z_stride = image.Stride( 2 ) * static_cast< dip::sint >( data.fileInformation.dataType.SizeOf() );
 
-   // Read the image data for first plane
-   DIP_STACK_TRACE_THIS( ReadTIFFData(
-         imagedata, image.Sizes(), image.Strides(), image.TensorElements(), image.TensorStride(),
-         image.DataType(), tiff ));
-
-   // Read the image data for other planes
-   dip::uint directory = imageNumbers.Offset();
-   for( dip::uint ii = 1; ii < image.Size( 2 ); ++ii ) {
-      imagedata += z_stride;
-      if( imageNumbers.start > imageNumbers.stop ) {
-         directory -= imageNumbers.step;
-      } else {
-         directory += imageNumbers.step;
+   // Reads the image planes `first`, `first + step`, `first + 2 * step`, ... using `handle`
+   auto readPlanes = [ & ]( TiffFile& handle, dip::uint first, dip::uint step ) {
+      for( dip::uint ii = first; ii < nPlanes; ii += step ) {
+         SetTIFFDirectory( handle, directories[ ii ] );
+         if( ii > 0 ) {
+            CheckTIFFStackPlane( handle, planeSizes, image.DataType(), image.TensorElements() );
+         }
+         ReadTIFFData( imagedata + static_cast< dip::sint >( ii ) * z_stride, planeSizes, image.Strides(),
+                       image.TensorElements(), image.TensorStride(), image.DataType(), handle, roi );
       }
-      DIP_THROW_IF( TIFFSetDirectory( tiff, static_cast< uint16 >( directory )) == 0, TIFF_DIRECTORY_NOT_FOUND );
+   };
 
-      // Test for tiled TIFF files. These we can't handle
-      uint32 tileWidth;
-      DIP_THROW_IF( TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth ), TIFF_TILES_NOT_SUPPORTED );
-
-      // Test image plane to make sure it matches expectations
-      uint32 temp32;
-      DIP_THROW_IF( !TIFFGetField( tiff, TIFFTAG_IMAGEWIDTH, &temp32 ), TIFF_NO_TAG );
-      DIP_THROW_IF( temp32 != image.Size( 0 ), "Reading multi-slice TIFF: width of images not consistent" );
-      DIP_THROW_IF( !TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &temp32 ), TIFF_NO_TAG );
-      DIP_THROW_IF( temp32 != image.Size( 1 ), "Reading multi-slice TIFF: length of images not consistent" );
-      uint16 photometricInterpretation;
-      if( !TIFFGetField( tiff, TIFFTAG_PHOTOMETRIC, &photometricInterpretation )) {
-         photometricInterpretation = PHOTOMETRIC_MINISBLACK;
-      }
-      DataType dataType;
-      uint16 samplesPerPixel;
-      if( photometricInterpretation == PHOTOMETRIC_PALETTE ) {
-         dataType = DT_UINT16;
-         samplesPerPixel = 3;
-      } else {
-         DIP_STACK_TRACE_THIS( dataType = FindTIFFDataType( tiff ));
-         if( !TIFFGetField( tiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel )) {
-            samplesPerPixel = 1;
+   // With fewer planes than threads, we read one plane at a time, and let the strips or tiles within each
+   // plane be decoded in parallel. Otherwise, each thread reads whole planes through its own handle.
+   dip::uint nThreads = GetNumberOfThreads();
+   if(( nPlanes < nThreads ) || ( nPlanes * roi[ 0 ].Size() * roi[ 1 ].Size() < threadingThreshold )) {
+      nThreads = 1;
+   }
+   if( nThreads <= 1 ) {
+      DIP_STACK_TRACE_THIS( readPlanes( tiff, 0, 1 ));
+      return;
+   }
+   std::vector< std::exception_ptr > exceptions( nThreads );
+   #ifdef _OPENMP
+   #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( static, 1 )
+   #endif
+   for( dip::sint tt = 0; tt < static_cast< dip::sint >( nThreads ); ++tt ) {
+      dip::uint ii = static_cast< dip::uint >( tt );
+      try {
+         if( ii == 0 ) {
+            readPlanes( tiff, 0, nThreads );
+         } else {
+            TiffFile local( tiff.FileName() );
+            readPlanes( local, ii, nThreads );
+         }
+      } catch( ... ) {
+         exceptions[ ii ] = std::current_exception();
+      }
+   }
+   for( auto const& e : exceptions ) {
+      if( e ) {
+         std::rethrow_exception( e );
+      }
+   }
+}
+
+// Reads the current directory of `tiff` as a 2D image
+void ReadTIFFPlane(
+      Image& image,
+      TiffFile& tiff,
+      GetTIFFInfoData& data,
+      RangeArray const& roi
+) {
+   // Hack by Bernd Rieger to recognize Leica 12 bit TIFFs
+   // These are written as color-mapped images, but they are not
+   if( data.photometricInterpretation == PHOTOMETRIC_PALETTE ) {
+      uint16 bitsPerSample;
+      String artist( 128, ' ' );
+      if(( TIFFGetField( tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample )) &&
+         ( TIFFGetField( tiff, TIFFTAG_ARTIST, &( artist[ 0 ] )))) {
+         if(( artist == "Yves Nicodem" ) || ( artist == "TCS User" )) {
+            data.fileInformation.colorSpace = "";
+            data.photometricInterpretation = PHOTOMETRIC_MINISBLACK;
          }
       }
-      DIP_THROW_IF( dataType != image.DataType(), "Reading multi-slice TIFF: data type not consistent" );
-      DIP_THROW_IF( samplesPerPixel != image.TensorElements(), "Reading multi-slice TIFF: samples per pixel not consistent" );
+   }
+   if( data.photometricInterpretation == PHOTOMETRIC_PALETTE ) {
+      DIP_STACK_TRACE_THIS( ReadTIFFColorMap( image, tiff, data, roi ));
+   } else {
+      if( data.fileInformation.dataType.IsBinary() ) {
+         DIP_STACK_TRACE_THIS( ReadTIFFBinary( image, tiff, data, roi ));
+      } else {
+         DIP_STACK_TRACE_THIS( ReadTIFFGreyValue( image, tiff, data, roi ));
+      }
+   }
+}
 
-      // Read the image data for this plane
-      DIP_STACK_TRACE_THIS( ReadTIFFData(
-            imagedata, image.Sizes(), image.Strides(), image.TensorElements(), image.TensorStride(),
-            image.DataType(), tiff ));
+// Fixes `roi` for an image plane of sizes `sizes`. Ranges with `start > stop` are swapped, the output
+// indicates which dimensions must be mirrored after reading.
+BooleanArray FixTIFFRoi( RangeArray& roi, UnsignedArray const& sizes ) {
+   BooleanArray mirror( 2, false );
+   DIP_STACK_TRACE_THIS( ArrayUseParameter( roi, 2, Range{} ));
+   for( dip::uint ii = 0; ii < 2; ++ii ) {
+      DIP_STACK_TRACE_THIS( roi[ ii ].Fix( sizes[ ii ] ));
+      if( roi[ ii ].start > roi[ ii ].stop ) {
+         // The last pixel in the range is not `stop` if `start - stop` is not a multiple of `step`
+         dip::sint last = roi[ ii ].start - static_cast< dip::sint >(( roi[ ii ].Size() - 1 ) * roi[ ii ].step );
+         roi[ ii ].stop = roi[ ii ].start;
+         roi[ ii ].start = last;
+         mirror[ ii ] = true;
+      }
+   }
+   return mirror;
+}
+
+// Reads the current directory of `tiff` into `out`, as `ImageReadTIFF` does for a single page
+void ReadTIFFPage( Image& out, TiffFile& tiff, RangeArray roi ) {
+   GetTIFFInfoData data;
+   DIP_STACK_TRACE_THIS( data = GetTIFFInfo( tiff ));
+   BooleanArray mirror;
+   DIP_STACK_TRACE_THIS( mirror = FixTIFFRoi( roi, data.fileInformation.sizes ));
+   DIP_STACK_TRACE_THIS( ReadTIFFPlane( out, tiff, data, roi ));
+   out.Mirror( mirror );
+   out.SetColorSpace( data.fileInformation.colorSpace );
+   out.SetPixelSize( data.fileInformation.pixelSize );
+}
+
+// Calls `function` for each of the `nPlanes` image planes, in order. `readPlane( ii, plane )` reads image plane `ii`
+// into `plane`. Image plane `ii + 1` is read in a separate thread while `function` processes image plane `ii`.
+// `function` is called from the calling thread, so it can use all threads for its own processing.
+template< typename ReadPlane >
+void ReadTIFFPlanesPrefetched( dip::uint nPlanes, ReadPlane const& readPlane, TIFFPlaneFunction const& function ) {
+   auto read = [ & ]( dip::uint ii ) {
+      Image plane;
+      readPlane( ii, plane );
+      return plane;
+   };
+   if( GetNumberOfThreads() <= 1 ) {
+      for( dip::uint ii = 0; ii < nPlanes; ++ii ) {
+         Image plane = read( ii );
+         function( plane, ii );
+      }
+      return;
+   }
+   std::future< Image > next = std::async( std::launch::async, read, dip::uint( 0 ));
+   for( dip::uint ii = 0; ii < nPlanes; ++ii ) {
+      Image plane = next.get(); // Re-throws any exception thrown while reading
+      if( ii + 1 < nPlanes ) {
+         next = std::async( std::launch::async, read, ii + 1 );
+      }
+      function( plane, ii );
    }
 }
 
@@ -731,96 +1155,172 @@ void ImageReadTIFFStack(
 FileInformation ImageReadTIFF(
       Image& out,
       String const& filename,
-      Range imageNumbers
+      Range imageNumbers,
+      RangeArray roi
 ) {
    // Open TIFF file
    TiffFile tiff( filename );
 
    // Go to the right directory
-   dip::uint numberOfImages = TIFFNumberOfDirectories( tiff );
+   dip::uint numberOfImages;
+   DIP_STACK_TRACE_THIS( numberOfImages = NumberOfTIFFDirectories( tiff ));
    DIP_STACK_TRACE_THIS( imageNumbers.Fix( numberOfImages ));
-   uint16 imageNumber = static_cast< uint16 >( imageNumbers.Offset() );
-   DIP_THROW_IF( TIFFSetDirectory( tiff, imageNumber ) == 0, TIFF_DIRECTORY_NOT_FOUND );
+   DIP_STACK_TRACE_THIS( SetTIFFDirectory( tiff, imageNumbers.Offset() ));
 
    // Get info
    GetTIFFInfoData data;
    DIP_STACK_TRACE_THIS( data = GetTIFFInfo( tiff ));
+   data.fileInformation.numberOfImages = numberOfImages;
 
-   // Test for tiled TIFF files. These we can't handle yet. TODO: implement reading tiled TIFF files.
-   uint32 tileWidth;
-   DIP_THROW_IF( TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth ), TIFF_TILES_NOT_SUPPORTED );
+   // Check the ROI
+   BooleanArray mirror;
+   DIP_STACK_TRACE_THIS( mirror = FixTIFFRoi( roi, data.fileInformation.sizes ));
 
    if( imageNumbers.start != imageNumbers.stop ) {
       // Read in multiple pages as a 3D image
-      DIP_STACK_TRACE_THIS( ImageReadTIFFStack( out, tiff, data, imageNumbers ));
+      DIP_STACK_TRACE_THIS( ReadTIFFStack( out, tiff, data, imageNumbers, roi ));
    } else {
-      // Hack by Bernd Rieger to recognize Leica 12 bit TIFFs
-      // These are written as color-mapped images, but they are not
-      if( data.photometricInterpretation == PHOTOMETRIC_PALETTE ) {
-         uint16 bitsPerSample;
-         String artist( 128, ' ' );
-         if(( TIFFGetField( tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample )) &&
-            ( TIFFGetField( tiff, TIFFTAG_ARTIST, &( artist[ 0 ] )))) {
-            if(( artist == "Yves Nicodem" ) || ( artist == "TCS User" )) {
-               data.fileInformation.colorSpace = "";
-               data.photometricInterpretation = PHOTOMETRIC_MINISBLACK;
-            }
-         }
-      }
-      if( data.photometricInterpretation == PHOTOMETRIC_PALETTE ) {
-         DIP_STACK_TRACE_THIS( ReadTIFFColorMap( out, tiff, data ));
-      } else {
-         if( data.fileInformation.dataType.IsBinary() ) {
-            DIP_STACK_TRACE_THIS( ReadTIFFBinary( out, tiff, data ));
-         } else {
-            DIP_STACK_TRACE_THIS( ReadTIFFGreyValue( out, tiff, data ));
-         }
-      }
+      DIP_STACK_TRACE_THIS( ReadTIFFPlane( out, tiff, data, roi ));
    }
 
+   // Apply the mirroring to the output image
+   mirror.resize( out.Dimensionality(), false );
+   out.Mirror( mirror );
+
    out.SetColorSpace( data.fileInformation.colorSpace );
    out.SetPixelSize( data.fileInformation.pixelSize );
 
    return data.fileInformation;
 }
 
+FileInformation ImageReadTIFF(
+      Image& out,
+      String const& filename,
+      Range const& imageNumbers,
+      UnsignedArray const& origin,
+      UnsignedArray const& sizes,
+      UnsignedArray const& spacing
+) {
+   DIP_THROW_IF( origin.size() > 2, E::ARRAY_ILLEGAL_SIZE );
+   DIP_THROW_IF( sizes.size() > 2, E::ARRAY_ILLEGAL_SIZE );
+   DIP_THROW_IF( spacing.size() > 2, E::ARRAY_ILLEGAL_SIZE );
+   RangeArray roi( 2 );
+   for( dip::uint ii = 0; ii < 2; ++ii ) {
+      if( !origin.empty() ) {
+         roi[ ii ].start = static_cast< dip::sint >( origin.size() == 1 ? origin[ 0 ] : origin[ ii ] );
+      }
+      if( !sizes.empty() ) {
+         roi[ ii ].stop = roi[ ii ].start + static_cast< dip::sint >( sizes.size() == 1 ? sizes[ 0 ] : sizes[ ii ] ) - 1;
+      }
+      if( !spacing.empty() ) {
+         roi[ ii ].step = spacing.size() == 1 ? spacing[ 0 ] : spacing[ ii ];
+      }
+   }
+   return ImageReadTIFF( out, filename, imageNumbers, roi );
+}
+
+void ImageReadTIFFPages(
+      String const& filename,
+      Range imageNumbers,
+      TIFFPlaneFunction const& function,
+      RangeArray const& roi
+) {
+   // Open TIFF file
+   TiffFile tiff( filename );
+
+   // Find the image planes to read
+   DIP_STACK_TRACE_THIS( imageNumbers.Fix( NumberOfTIFFDirectories( tiff )));
+   std::vector< dip::uint > directories = TIFFDirectoryIndices( imageNumbers );
+
+   // Read them one at a time, only one thread uses `tiff` at any given time
+   auto readPlane = [ & ]( dip::uint ii, Image& plane ) {
+      SetTIFFDirectory( tiff, directories[ ii ] );
+      ReadTIFFPage( plane, tiff, roi );
+   };
+   ReadTIFFPlanesPrefetched( directories.size(), readPlane, function );
+}
+
 void ImageReadTIFFSeries(
       Image& out,
       StringArray const& filenames
 ) {
    DIP_THROW_IF( filenames.size() < 1, E::ARRAY_ILLEGAL_SIZE );
+   dip::uint nPlanes = filenames.size();
 
    // Read in first image
    Image tmp;
-   dip::uint ii = 0;
-   DIP_STACK_TRACE_THIS( ImageReadTIFF( tmp, filenames[ ii ] )); // TODO: Read in first image plane or all image planes?
+   FileInformation info;
+   DIP_STACK_TRACE_THIS( info = ImageReadTIFF( tmp, filenames[ 0 ] ));
 
    // Prepare the output image
    UnsignedArray sizes = tmp.Sizes();
-   sizes.push_back( filenames.size() );
+   sizes.push_back( nPlanes );
    out.ReForge( sizes, tmp.TensorElements(), tmp.DataType() );
-
-   // Iterate over the sub-images through the last dimension
-   ImageSliceIterator it( out, out.Dimensionality() - 1 );
+   dip::uint procDim = out.Dimensionality() - 1;
 
    // Write the first image into the output
-   it->Copy( tmp );
+   ImageSliceIterator( out, procDim )->Copy( tmp );
    // Make sure we copy over the color space information also
    if( tmp.IsColor() ) {
       out.SetColorSpace( tmp.ColorSpace() );
    }
 
-   // Read in the rest of the images, and write them into the output
-   while( ++ii, ++it ) {
-      DIP_STACK_TRACE_THIS( ImageReadTIFF( tmp, filenames[ ii ] ));
+   // Reads the images `first`, `first + step`, `first + 2 * step`, ... directly into their slice of the output.
+   // The slices are protected, so they cannot be reallocated.
+   auto readPlanes = [ & ]( dip::uint first, dip::uint step ) {
+      for( dip::uint ii = first; ii < nPlanes; ii += step ) {
+         TiffFile tiff( filenames[ ii ] );
+         GetTIFFInfoData data = GetTIFFInfo( tiff );
+         DIP_THROW_IF(( data.fileInformation.sizes != info.sizes ) ||
+                      ( data.fileInformation.tensorElements != info.tensorElements ) ||
+                      ( data.fileInformation.dataType != info.dataType ),
+                      "Images in series do not have consistent sizes" );
+         RangeArray roi;
+         FixTIFFRoi( roi, data.fileInformation.sizes );
+         ImageSliceIterator it( out, procDim );
+         it += static_cast< dip::sint >( ii );
+         ReadTIFFPlane( *it, tiff, data, roi );
+      }
+   };
+
+   // Read in the rest of the images. Reading many files is limited by I/O latency, so we read them in parallel,
+   // each thread opening its own files.
+   dip::uint nThreads = std::min( GetNumberOfThreads(), nPlanes - 1 );
+   if( nThreads <= 1 ) {
+      DIP_STACK_TRACE_THIS( readPlanes( 1, 1 ));
+      return;
+   }
+   std::vector< std::exception_ptr > exceptions( nThreads );
+   #ifdef _OPENMP
+   #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( static, 1 )
+   #endif
+   for( dip::sint tt = 0; tt < static_cast< dip::sint >( nThreads ); ++tt ) {
+      dip::uint ii = static_cast< dip::uint >( tt );
       try {
-         it->Copy( tmp );
-      } catch( Error const& ) {
-         DIP_THROW( "Images in series do not have consistent sizes" );
+         readPlanes( 1 + ii, nThreads );
+      } catch( ... ) {
+         exceptions[ ii ] = std::current_exception();
+      }
+   }
+   for( auto const& e : exceptions ) {
+      if( e ) {
+         std::rethrow_exception( e );
       }
    }
 }
 
+void ImageReadTIFFSeries(
+      StringArray const& filenames,
+      TIFFPlaneFunction const& function
+) {
+   DIP_THROW_IF( filenames.size() < 1, E::ARRAY_ILLEGAL_SIZE );
+   auto readPlane = [ & ]( dip::uint ii, Image& plane ) {
+      TiffFile tiff( filenames[ ii ] );
+      ReadTIFFPage( plane, tiff, {} );
+   };
+   ReadTIFFPlanesPrefetched( filenames.size(), readPlane, function );
+}
+
 FileInformation ImageReadTIFFInfo(
       String const& filename,
       dip::uint imageNumber
@@ -830,12 +1330,13 @@ FileInformation ImageReadTIFFInfo(
 
    // Go to the right directory
    if( imageNumber > 0 ) {
-      DIP_THROW_IF( TIFFSetDirectory( tiff, static_cast< uint16 >( imageNumber )) == 0, TIFF_DIRECTORY_NOT_FOUND );
+      DIP_STACK_TRACE_THIS( SetTIFFDirectory( tiff, imageNumber ));
    }
 
    // Get info
    GetTIFFInfoData data;
    DIP_STACK_TRACE_THIS( data = GetTIFFInfo( tiff ));
+   DIP_STACK_TRACE_THIS( data.fileInformation.numberOfImages = NumberOfTIFFDirectories( tiff ));
 
    return data.fileInformation;
 }
@@ -860,7 +1361,15 @@ bool ImageIsTIFF(
 
 namespace dip {
 
-FileInformation ImageReadTIFF( Image&, String const&, Range ) {
+FileInformation ImageReadTIFF( Image&, String const&, Range, RangeArray ) {
+   DIP_THROW( E::NOT_IMPLEMENTED );
+}
+
+FileInformation ImageReadTIFF( Image&, String const&, Range const&, UnsignedArray const&, UnsignedArray const&, UnsignedArray const& ) {
+   DIP_THROW( E::NOT_IMPLEMENTED );
+}
+
+void ImageReadTIFFPages( String const&, Range, TIFFPlaneFunction const&, RangeArray const& ) {
    DIP_THROW( E::NOT_IMPLEMENTED );
 }
 
@@ -868,6 +1377,10 @@ void ImageReadTIFFSeries( Image&, StringArray const& ) {
    DIP_THROW( E::NOT_IMPLEMENTED );
 }
 
+void ImageReadTIFFSeries( StringArray const&, TIFFPlaneFunction const& ) {
+   DIP_THROW( E::NOT_IMPLEMENTED );
+}
+
 DIP_EXPORT FileInformation ImageReadTIFFInfo( String const&, dip::uint ) {
    DIP_THROW( E::NOT_IMPLEMENTED );
 }
@@ -20,8 +20,14 @@
 
 #ifdef DIP__HAS_TIFF
 
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+
 #include "diplib.h"
 #include "diplib/file_io.h"
+#include "diplib/multithreading.h"
 
 #include <tiffio.h>
 
@@ -200,6 +206,118 @@ void FillBufferMultiChannelN(
    }
 }
 
+// An in-memory TIFF file with the same layout as `model`. libtiff handles cannot be shared among threads, so to
+// compress strips in parallel, each thread encodes its strips into one of these. The compressed bytes are then
+// written to the output file with `TIFFWriteRawStrip`.
+class MemoryTiff {
+   public:
+      explicit MemoryTiff( TIFF* model ) {
+         tiff_ = TIFFClientOpen( "memory", "w", static_cast< thandle_t >( this ),
+                                 ReadProc, WriteProc, SeekProc, CloseProc, SizeProc, MapProc, UnmapProc );
+         DIP_THROW_IF( tiff_ == nullptr, "Could not create an in-memory TIFF file" );
+         CopyTag< uint32 >( model, TIFFTAG_IMAGEWIDTH );
+         CopyTag< uint32 >( model, TIFFTAG_IMAGELENGTH );
+         CopyTag< uint32 >( model, TIFFTAG_ROWSPERSTRIP );
+         CopyTag< uint16 >( model, TIFFTAG_BITSPERSAMPLE );
+         CopyTag< uint16 >( model, TIFFTAG_SAMPLEFORMAT );
+         CopyTag< uint16 >( model, TIFFTAG_SAMPLESPERPIXEL );
+         CopyTag< uint16 >( model, TIFFTAG_PLANARCONFIG );
+         CopyTag< uint16 >( model, TIFFTAG_PHOTOMETRIC );
+         CopyTag< uint16 >( model, TIFFTAG_COMPRESSION );
+      }
+      MemoryTiff( MemoryTiff const& ) = delete;
+      MemoryTiff( MemoryTiff&& ) = delete;
+      MemoryTiff& operator=( MemoryTiff const& ) = delete;
+      MemoryTiff& operator=( MemoryTiff&& ) = delete;
+      ~MemoryTiff() {
+         if( tiff_ ) {
+            TIFFClose( tiff_ );
+            tiff_ = nullptr;
+         }
+      }
+      // Encodes `size` bytes of `data` as strip number `strip`, and returns the compressed bytes.
+      std::vector< uint8 > EncodeStrip( tstrip_t strip, uint8* data, tmsize_t size ) {
+         DIP_THROW_IF( TIFFWriteEncodedStrip( tiff_, strip, data, size ) < 0, "Error writing data" );
+         toff_t* offsets;
+         toff_t* byteCounts;
+         DIP_THROW_IF( !TIFFGetField( tiff_, TIFFTAG_STRIPOFFSETS, &offsets ), "Error writing data" );
+         DIP_THROW_IF( !TIFFGetField( tiff_, TIFFTAG_STRIPBYTECOUNTS, &byteCounts ), "Error writing data" );
+         dip::uint offset = static_cast< dip::uint >( offsets[ strip ] );
+         dip::uint count = static_cast< dip::uint >( byteCounts[ strip ] );
+         DIP_THROW_IF( offset + count > data_.size(), "Error writing data" );
+         std::vector< uint8 > out( data_.begin() + static_cast< dip::sint >( offset ),
+                                   data_.begin() + static_cast< dip::sint >( offset + count ));
+         // Strips are appended at the end of the file, discarding this one keeps the buffer small.
+         data_.resize( offset );
+         return out;
+      }
+   private:
+      TIFF* tiff_ = nullptr;
+      std::vector< uint8 > data_;
+      dip::uint pos_ = 0;
+
+      template< typename T >
+      void CopyTag( TIFF* model, uint32 tag ) {
+         T value;
+         if( TIFFGetField( model, tag, &value )) {
+            DIP_THROW_IF( !TIFFSetField( tiff_, tag, value ), TIFF_WRITE_TAG );
+         }
+      }
+
+      static tmsize_t ReadProc( thandle_t, void*, tmsize_t ) {
+         return 0;
+      }
+      static tmsize_t WriteProc( thandle_t handle, void* buf, tmsize_t size ) {
+         MemoryTiff* self = static_cast< MemoryTiff* >( handle );
+         dip::uint n = static_cast< dip::uint >( size );
+         if( self->pos_ + n > self->data_.size() ) {
+            self->data_.resize( self->pos_ + n );
+         }
+         std::memcpy( self->data_.data() + self->pos_, buf, n );
+         self->pos_ += n;
+         return size;
+      }
+      static toff_t SeekProc( thandle_t handle, toff_t offset, int whence ) {
+         MemoryTiff* self = static_cast< MemoryTiff* >( handle );
+         switch( whence ) {
+            case SEEK_SET:
+               self->pos_ = static_cast< dip::uint >( offset );
+               break;
+            case SEEK_CUR:
+               self->pos_ += static_cast< dip::uint >( offset );
+               break;
+            case SEEK_END:
+               self->pos_ = self->data_.size() + static_cast< dip::uint >( offset );
+               break;
+            default:
+               break;
+         }
+         return static_cast< toff_t >( self->pos_ );
+      }
+      static int CloseProc( thandle_t ) {
+         return 0;
+      }
+      static toff_t SizeProc( thandle_t handle ) {
+         return static_cast< toff_t >( static_cast< MemoryTiff* >( handle )->data_.size() );
+      }
+      static int MapProc( thandle_t, void**, toff_t* ) {
+         return 0;
+      }
+      static void UnmapProc( thandle_t, void*, toff_t ) {}
+};
+
+// Number of threads to use when encoding `nStrips` strips, containing a total of `nPixels` pixels. Only the lossless
+// codecs are used in parallel; JPEG strips share tables stored in the file's directory.
+dip::uint ThreadsForEncoding( TiffFile& tiff, dip::uint nStrips, dip::uint nPixels ) {
+   uint16 compression;
+   TIFFGetFieldDefaulted( tiff, TIFFTAG_COMPRESSION, &compression );
+   if((( compression != COMPRESSION_DEFLATE ) && ( compression != COMPRESSION_LZW ) && ( compression != COMPRESSION_PACKBITS )) ||
+      ( nPixels < threadingThreshold )) {
+      return 1;
+   }
+   return std::min( GetNumberOfThreads(), nStrips );
+}
+
 void WriteTIFFStrips(
       Image const& image,
       TiffFile& tiff
@@ -223,41 +341,87 @@ void WriteTIFFStrips(
    } else {
       DIP_THROW_IF(( static_cast< dip::uint >( scanline ) != image.Size( 0 ) * tensorElements * sizeOf ), "Wrong scanline size" );
    }
-   if( image.HasNormalStrides() ) {
-      // Simple writing
-      tstrip_t strip = 0;
-      uint8* data = static_cast< uint8* >( image.Origin() );
-      for( uint32 row = 0; row < imageLength; row += rowsPerStrip ) {
-         uint32 nrow = row + rowsPerStrip > imageLength ? imageLength - row : rowsPerStrip;
-         DIP_THROW_IF( TIFFWriteEncodedStrip( tiff, strip, data, nrow * scanline ) < 0, "Error writing data" );
-         data += static_cast< dip::sint >( nrow * sizeOf ) * image.Stride( 1 );
-         ++strip;
+   bool normalStrides = image.HasNormalStrides();
+   dip::uint stripBytes = static_cast< dip::uint >( TIFFStripSize( tiff ));
+
+   // Returns a pointer to the data for strip `strip`. If the image does not have normal strides, this data
+   // is first copied into `buf` using the strides.
+   auto stripData = [ & ]( tstrip_t strip, std::vector< uint8 >& buf ) -> uint8* {
+      uint32 row = strip * rowsPerStrip;
+      uint32 nrow = row + rowsPerStrip > imageLength ? imageLength - row : rowsPerStrip;
+      uint8* data = static_cast< uint8* >( image.Origin() ) + static_cast< dip::sint >( row * sizeOf ) * image.Stride( 1 );
+      if( normalStrides ) {
+         // Simple writing
+         return data;
       }
-   } else {
       // Writing requires an intermediate buffer, filled using strides
-      std::vector< uint8 > buf( static_cast< dip::uint >( TIFFStripSize( tiff )));
-      tstrip_t strip = 0;
-      uint8* data = static_cast< uint8* >( image.Origin() );
-      for( uint32 row = 0; row < imageLength; row += rowsPerStrip ) {
-         uint32 nrow = row + rowsPerStrip > imageLength ? imageLength - row : rowsPerStrip;
-         if( tensorElements == 1 ) {
-            if( binary) {
-               FillBuffer1( buf.data(), data, imageWidth, nrow, strides );
-            } else if( sizeOf == 1 ) {
-               FillBuffer8( buf.data(), data, imageWidth, nrow, strides );
-            } else {
-               FillBufferN( buf.data(), data, imageWidth, nrow, strides, sizeOf );
-            }
+      buf.resize( stripBytes );
+      if( tensorElements == 1 ) {
+         if( binary) {
+            FillBuffer1( buf.data(), data, imageWidth, nrow, strides );
+         } else if( sizeOf == 1 ) {
+            FillBuffer8( buf.data(), data, imageWidth, nrow, strides );
+         } else {
+            FillBufferN( buf.data(), data, imageWidth, nrow, strides, sizeOf );
+         }
+      } else {
+         if( sizeOf == 1 ) {
+            FillBufferMultiChannel8( buf.data(), data, tensorElements, imageWidth, nrow, tensorStride, strides );
          } else {
-            if( sizeOf == 1 ) {
-               FillBufferMultiChannel8( buf.data(), data, tensorElements, imageWidth, nrow, tensorStride, strides );
-            } else {
-               FillBufferMultiChannelN( buf.data(), data, tensorElements, imageWidth, nrow, tensorStride, strides, sizeOf );
+            FillBufferMultiChannelN( buf.data(), data, tensorElements, imageWidth, nrow, tensorStride, strides, sizeOf );
+         }
+      }
+      return buf.data();
+   };
+   auto stripSize = [ & ]( tstrip_t strip ) -> tmsize_t {
+      uint32 row = strip * rowsPerStrip;
+      uint32 nrow = row + rowsPerStrip > imageLength ? imageLength - row : rowsPerStrip;
+      return static_cast< tmsize_t >( nrow ) * scanline;
+   };
+
+   tstrip_t nStrips = TIFFNumberOfStrips( tiff );
+   dip::uint nThreads = ThreadsForEncoding( tiff, nStrips, image.NumberOfPixels() );
+   if( nThreads <= 1 ) {
+      std::vector< uint8 > buf;
+      for( tstrip_t strip = 0; strip < nStrips; ++strip ) {
+         DIP_THROW_IF( TIFFWriteEncodedStrip( tiff, strip, stripData( strip, buf ), stripSize( strip )) < 0, "Error writing data" );
+      }
+      return;
+   }
+
+   // Compress batches of strips in parallel, then write them to the file in order
+   std::vector< std::unique_ptr< MemoryTiff >> encoders( nThreads );
+   for( auto& encoder : encoders ) {
+      encoder.reset( new MemoryTiff( tiff ));
+   }
+   dip::uint batchSize = 4 * nThreads;
+   std::vector< std::vector< uint8 >> compressed( batchSize );
+   std::vector< std::exception_ptr > exceptions( nThreads );
+   for( tstrip_t batch = 0; batch < nStrips; batch += static_cast< tstrip_t >( batchSize )) {
+      dip::uint n = std::min< dip::uint >( batchSize, nStrips - batch );
+      #ifdef _OPENMP
+      #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( static, 1 )
+      #endif
+      for( dip::sint tt = 0; tt < static_cast< dip::sint >( nThreads ); ++tt ) {
+         dip::uint ii = static_cast< dip::uint >( tt );
+         try {
+            std::vector< uint8 > buf;
+            for( dip::uint jj = ii; jj < n; jj += nThreads ) {
+               tstrip_t strip = batch + static_cast< tstrip_t >( jj );
+               compressed[ jj ] = encoders[ ii ]->EncodeStrip( strip, stripData( strip, buf ), stripSize( strip ));
             }
+         } catch( ... ) {
+            exceptions[ ii ] = std::current_exception();
          }
-         DIP_THROW_IF( TIFFWriteEncodedStrip( tiff, strip, buf.data(), nrow * scanline ) < 0, "Error writing data" );
-         data += static_cast< dip::sint >( nrow * sizeOf ) * image.Stride( 1 );
-         ++strip;
+      }
+      for( auto const& e : exceptions ) {
+         if( e ) {
+            std::rethrow_exception( e );
+         }
+      }
+      for( dip::uint jj = 0; jj < n; ++jj ) {
+         DIP_THROW_IF( TIFFWriteRawStrip( tiff, batch + static_cast< tstrip_t >( jj ), compressed[ jj ].data(),
+                                          static_cast< tmsize_t >( compressed[ jj ].size() )) < 0, "Error writing data" );
       }
    }
 }
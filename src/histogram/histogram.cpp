@@ -18,6 +18,10 @@
  * limitations under the License.
  */
 
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
 #include "diplib.h"
 #include "diplib/histogram.h"
 #include "diplib/statistics.h"
@@ -175,6 +179,125 @@ class dip__ScalarImageHistogram : public Framework::ScanLineFilter {
       Histogram::Configuration const& configuration_;
 };
 
+// Number of interleaved sub-histograms used by `dip__ScalarImageHistogram_Direct`. Consecutive pixels are
+// counted in different sub-histograms, so that runs of equal values do not stall on the same counter.
+constexpr dip::uint nHistogramBanks = 4;
+
+// For integer images where the bins have a size that is a power of two, and bin boundaries fall on integer
+// values, the bin index can be computed directly from the pixel value with a subtraction and a shift.
+// Returns false if this is not possible, otherwise sets `lowerBound` and `shift`.
+bool CanIndexDirectly( DataType dataType, Histogram::Configuration const& configuration, dip::sint& lowerBound, dip::uint& shift ) {
+   if( !dataType.IsInteger() || ( configuration.binSize < 1.0 ) || ( configuration.lowerBound != std::floor( configuration.lowerBound ))) {
+      return false;
+   }
+   if( std::abs( configuration.lowerBound ) > 1e15 ) {
+      return false;
+   }
+   int exponent;
+   if( std::frexp( configuration.binSize, &exponent ) != 0.5 ) {
+      return false; // not a power of two
+   }
+   lowerBound = static_cast< dip::sint >( configuration.lowerBound );
+   shift = static_cast< dip::uint >( exponent - 1 );
+   return true;
+}
+
+template< typename TPI >
+class dip__ScalarImageHistogram_Direct : public Framework::ScanLineFilter {
+      // Computes the histogram of an integer image, see `CanIndexDirectly`. Each thread writes into
+      // `nHistogramBanks` columns of `image_`, which are summed at the end.
+   public:
+      virtual void Filter( Framework::ScanLineFilterParameters const& params ) override {
+         TPI const* in = static_cast< TPI const* >( params.inBuffer[ 0 ].buffer );
+         auto bufferLength = params.bufferLength;
+         auto inStride = params.inBuffer[ 0 ].stride;
+         dip::sint bankStride = image_.Stride( 1 );
+         CountType* data = static_cast< CountType* >( image_.Origin() ) + bankStride * static_cast< dip::sint >( params.thread * nHistogramBanks );
+         // Note: `image_` strides are always normal.
+         if( params.inBuffer.size() > 1 ) {
+            // If there's two input buffers, we have a mask image.
+            bin const* mask = static_cast< bin const* >( params.inBuffer[ 1 ].buffer );
+            auto maskStride = params.inBuffer[ 1 ].stride;
+            for( dip::uint ii = 0; ii < bufferLength; ++ii ) {
+               if( *mask ) {
+                  Count( data, *in );
+               }
+               in += inStride;
+               mask += maskStride;
+            }
+         } else if( noClamping_ ) {
+            // All values of TPI fall within the histogram bounds, the inner loop does no tests at all.
+            CountType* data0 = data;
+            CountType* data1 = data0 + bankStride;
+            CountType* data2 = data1 + bankStride;
+            CountType* data3 = data2 + bankStride;
+            dip::uint ii = 0;
+            for( ; ii + nHistogramBanks <= bufferLength; ii += nHistogramBanks ) {
+               ++data0[ Index( in[ 0 ] ) ];
+               ++data1[ Index( in[ inStride ] ) ];
+               ++data2[ Index( in[ 2 * inStride ] ) ];
+               ++data3[ Index( in[ 3 * inStride ] ) ];
+               in += static_cast< dip::sint >( nHistogramBanks ) * inStride;
+            }
+            for( ; ii < bufferLength; ++ii ) {
+               ++data0[ Index( *in ) ];
+               in += inStride;
+            }
+         } else {
+            dip::uint ii = 0;
+            for( ; ii + nHistogramBanks <= bufferLength; ii += nHistogramBanks ) {
+               for( dip::uint bank = 0; bank < nHistogramBanks; ++bank ) {
+                  Count( data + static_cast< dip::sint >( bank ) * bankStride, *in );
+                  in += inStride;
+               }
+            }
+            for( ; ii < bufferLength; ++ii ) {
+               Count( data, *in );
+               in += inStride;
+            }
+         }
+      }
+      virtual void SetNumberOfThreads( dip::uint threads ) override {
+         UnsignedArray sizes = image_.Sizes();
+         sizes.back() = threads * nHistogramBanks;
+         image_.SetSizes( sizes );
+         image_.Forge();
+         image_.Fill( 0 );
+      }
+      dip__ScalarImageHistogram_Direct( Image& image, Histogram::Configuration const& configuration, dip::sint lowerBound, dip::uint shift ) :
+            image_( image ), lowerBound_( lowerBound ), shift_( shift ), nBins_( configuration.nBins ),
+            exclude_( configuration.excludeOutOfBoundValues ) {
+         dip::sint minValue = static_cast< dip::sint >( std::numeric_limits< TPI >::lowest() );
+         dip::sint maxValue = static_cast< dip::sint >( std::numeric_limits< TPI >::max() );
+         noClamping_ = ( minValue >= lowerBound_ ) && ( static_cast< dip::uint >( maxValue - lowerBound_ ) >> shift_ ) < nBins_;
+      }
+   private:
+      Image& image_;
+      dip::sint lowerBound_;
+      dip::uint shift_;
+      dip::uint nBins_;
+      bool exclude_;
+      bool noClamping_;
+
+      // Only valid for values within the histogram bounds.
+      dip::uint Index( TPI value ) const {
+         return static_cast< dip::uint >( static_cast< dip::sint >( value ) - lowerBound_ ) >> shift_;
+      }
+
+      // Counts `value` in `data`, clamping to the histogram bounds or ignoring out-of-bounds values.
+      void Count( CountType* data, TPI value ) const {
+         dip::sint offset = static_cast< dip::sint >( value ) - lowerBound_;
+         dip::uint index = offset < 0 ? nBins_ : static_cast< dip::uint >( offset ) >> shift_;
+         if( index >= nBins_ ) {
+            if( exclude_ ) {
+               return;
+            }
+            index = offset < 0 ? 0 : nBins_ - 1;
+         }
+         ++data[ index ];
+      }
+};
+
 template< typename TPI >
 class dip__JointImageHistogram : public Framework::ScanLineFilter {
    public:
@@ -277,21 +400,48 @@ class dip__JointImageHistogram : public Framework::ScanLineFilter {
 
 } // namespace
 
+void Histogram::EmptyHistogram( Histogram::ConfigurationArray& configuration ) {
+   dip::uint ndims = configuration.size();
+   lowerBounds_.resize( ndims );
+   binSizes_.resize( ndims );
+   excludeOutOfBoundValues_.resize( ndims );
+   UnsignedArray sizes( ndims );
+   for( dip::uint ii = 0; ii < ndims; ++ii ) {
+      DIP_THROW_IF( configuration[ ii ].lowerIsPercentile || configuration[ ii ].upperIsPercentile,
+                    "Cannot compute percentiles for an empty histogram" );
+      CompleteConfiguration( configuration[ ii ], false );
+      lowerBounds_[ ii ] = configuration[ ii ].lowerBound;
+      binSizes_[ ii ] = configuration[ ii ].binSize;
+      excludeOutOfBoundValues_[ ii ] = configuration[ ii ].excludeOutOfBoundValues;
+      sizes[ ii ] = configuration[ ii ].nBins;
+   }
+   data_.ReForge( sizes, 1, DT_COUNT );
+   data_.Fill( 0 );
+}
+
 void Histogram::ScalarImageHistogram( Image const& input, Image const& mask, Histogram::Configuration& configuration ) {
    DIP_START_STACK_TRACE
       CompleteConfiguration( input, mask, configuration );
    DIP_END_STACK_TRACE
    lowerBounds_ = { configuration.lowerBound };
    binSizes_ = { configuration.binSize };
+   excludeOutOfBoundValues_ = { configuration.excludeOutOfBoundValues };
    data_.SetSizes( { configuration.nBins, 1 } );
    data_.SetDataType( DT_COUNT );
    std::unique_ptr< Framework::ScanLineFilter >scanLineFilter;
-   DIP_OVL_NEW_REAL( scanLineFilter, dip__ScalarImageHistogram, ( data_, configuration ), input.DataType() );
+   dip::sint lowerBound;
+   dip::uint shift;
+   if( CanIndexDirectly( input.DataType(), configuration, lowerBound, shift )) {
+      DIP_OVL_NEW_INTEGER( scanLineFilter, dip__ScalarImageHistogram_Direct, ( data_, configuration, lowerBound, shift ), input.DataType() );
+   } else {
+      DIP_OVL_NEW_REAL( scanLineFilter, dip__ScalarImageHistogram, ( data_, configuration ), input.DataType() );
+   }
    DIP_START_STACK_TRACE
       Framework::ScanSingleInput( input, mask, input.DataType(), *scanLineFilter );
    DIP_END_STACK_TRACE
    if( data_.Size( 1 ) > 1 ) {
       data_ = Sum( data_, {}, { false, true } );
+      data_.Convert( DT_COUNT ); // `Sum` yields a floating-point image
    }
    data_.Squeeze( 1 );
 }
@@ -300,6 +450,7 @@ void Histogram::TensorImageHistogram( Image const& input, Image const& mask, His
    dip::uint ndims = input.TensorElements();
    lowerBounds_.resize( ndims );
    binSizes_.resize( ndims );
+   excludeOutOfBoundValues_.resize( ndims );
    UnsignedArray sizes( ndims+1, 1 );
    for( dip::uint ii = 0; ii < ndims; ++ii ) {
       DIP_START_STACK_TRACE
@@ -307,6 +458,7 @@ void Histogram::TensorImageHistogram( Image const& input, Image const& mask, His
       DIP_END_STACK_TRACE
       lowerBounds_[ ii ] = configuration[ ii ].lowerBound;
       binSizes_[ ii ] = configuration[ ii ].binSize;
+      excludeOutOfBoundValues_[ ii ] = configuration[ ii ].excludeOutOfBoundValues;
       sizes[ ii ] = configuration[ ii ].nBins;
    }
    data_.SetSizes( sizes );
@@ -331,6 +483,7 @@ void Histogram::JointImageHistogram( Image const& input1, Image const& input2, I
    DIP_END_STACK_TRACE
    lowerBounds_ = { configuration[ 0 ].lowerBound, configuration[ 1 ].lowerBound };
    binSizes_ = { configuration[ 0 ].binSize, configuration[ 1 ].binSize };
+   excludeOutOfBoundValues_ = { configuration[ 0 ].excludeOutOfBoundValues, configuration[ 1 ].excludeOutOfBoundValues };
    UnsignedArray sizes{ configuration[ 0 ].nBins, configuration[ 1 ].nBins, 1 };
    data_.SetSizes( sizes );
    data_.SetDataType( DT_COUNT );
@@ -366,6 +519,7 @@ void Histogram::MeasurementFeatureHistogram( Measurement::IteratorFeature const&
    dip::uint ndims = featureValues.NumberOfValues();
    lowerBounds_.resize( ndims );
    binSizes_.resize( ndims );
+   excludeOutOfBoundValues_.resize( ndims );
    UnsignedArray sizes( ndims );
    for( dip::uint ii = 0; ii < ndims; ++ii ) {
       DIP_START_STACK_TRACE
@@ -375,6 +529,7 @@ void Histogram::MeasurementFeatureHistogram( Measurement::IteratorFeature const&
       DIP_END_STACK_TRACE
       lowerBounds_[ ii ] = configuration[ ii ].lowerBound;
       binSizes_[ ii ] = configuration[ ii ].binSize;
+      excludeOutOfBoundValues_[ ii ] = configuration[ ii ].excludeOutOfBoundValues;
       sizes[ ii ] = configuration[ ii ].nBins;
    }
    data_.SetSizes( sizes );
@@ -407,6 +562,127 @@ dip::uint Histogram::Count() const {
    return Sum( data_ ).As< dip::uint >();
 }
 
+Histogram::ConfigurationArray Histogram::GetConfiguration() const {
+   dip::uint ndims = Dimensionality();
+   ConfigurationArray configuration( ndims );
+   for( dip::uint ii = 0; ii < ndims; ++ii ) {
+      configuration[ ii ] = Configuration( lowerBounds_[ ii ], static_cast< int >( data_.Size( ii )), binSizes_[ ii ] );
+      configuration[ ii ].upperBound = UpperBound( ii );
+      configuration[ ii ].excludeOutOfBoundValues = excludeOutOfBoundValues_[ ii ];
+   }
+   return configuration;
+}
+
+void Histogram::Add( Image const& input, Image const& mask ) {
+   DIP_THROW_IF( !input.IsForged(), E::IMAGE_NOT_FORGED );
+   DIP_THROW_IF( input.TensorElements() != Dimensionality(), E::NTENSORELEM_DONT_MATCH );
+   DIP_START_STACK_TRACE
+      *this += Histogram( input, mask, GetConfiguration() );
+   DIP_END_STACK_TRACE
+}
+
+void Histogram::Add( Image const& input1, Image const& input2, Image const& mask ) {
+   DIP_THROW_IF( Dimensionality() != 2, E::ILLEGAL_DIMENSIONALITY );
+   DIP_START_STACK_TRACE
+      *this += Histogram( input1, input2, mask, GetConfiguration() );
+   DIP_END_STACK_TRACE
+}
+
+namespace {
+
+// The serialized histogram starts with this signature, followed by the number of dimensions, and for each
+// dimension the number of bins, the lower bound, the bin size and the `excludeOutOfBoundValues` flag.
+// Next come all the bin counts, in linear index order. Integers and floats are written in little-endian
+// byte order, floats as their IEEE 754 bit pattern.
+constexpr char const histogramSignature[ 8 ] = { 'D', 'I', 'P', 'H', 'I', 'S', 'T', '1' };
+
+void WriteUInt( std::ostream& os, std::uint64_t value, dip::uint nBytes ) {
+   char buffer[ 8 ];
+   for( dip::uint ii = 0; ii < nBytes; ++ii ) {
+      buffer[ ii ] = static_cast< char >( value & 0xFFu );
+      value >>= 8;
+   }
+   os.write( buffer, static_cast< std::streamsize >( nBytes ));
+}
+
+std::uint64_t ReadUInt( std::istream& is, dip::uint nBytes ) {
+   unsigned char buffer[ 8 ];
+   is.read( reinterpret_cast< char* >( buffer ), static_cast< std::streamsize >( nBytes ));
+   DIP_THROW_IF( !is, "Error reading histogram from stream" );
+   std::uint64_t value = 0;
+   for( dip::uint ii = nBytes; ii > 0; --ii ) {
+      value = ( value << 8 ) | buffer[ ii - 1 ];
+   }
+   return value;
+}
+
+void WriteFloat( std::ostream& os, dfloat value ) {
+   std::uint64_t bits;
+   static_assert( sizeof( bits ) == sizeof( value ), "dfloat is not 64 bits" );
+   std::memcpy( &bits, &value, sizeof( bits ));
+   WriteUInt( os, bits, 8 );
+}
+
+dfloat ReadFloat( std::istream& is ) {
+   std::uint64_t bits = ReadUInt( is, 8 );
+   dfloat value;
+   std::memcpy( &value, &bits, sizeof( value ));
+   return value;
+}
+
+} // namespace
+
+void Histogram::Serialize( std::ostream& os ) const {
+   os.write( histogramSignature, sizeof( histogramSignature ));
+   dip::uint ndims = Dimensionality();
+   WriteUInt( os, ndims, 4 );
+   for( dip::uint ii = 0; ii < ndims; ++ii ) {
+      WriteUInt( os, data_.Size( ii ), 8 );
+      WriteFloat( os, lowerBounds_[ ii ] );
+      WriteFloat( os, binSizes_[ ii ] );
+      WriteUInt( os, excludeOutOfBoundValues_[ ii ] ? 1 : 0, 1 );
+   }
+   ConstImageIterator< CountType > it( data_ );
+   do {
+      WriteUInt( os, *it, sizeof( CountType ));
+   } while( ++it );
+   DIP_THROW_IF( !os, "Error writing histogram to stream" );
+}
+
+Histogram Histogram::Deserialize( std::istream& is ) {
+   char signature[ sizeof( histogramSignature ) ];
+   is.read( signature, sizeof( signature ));
+   DIP_THROW_IF( !is || !std::equal( signature, signature + sizeof( signature ), histogramSignature ),
+                 "Stream does not contain a serialized histogram" );
+   dip::uint ndims = static_cast< dip::uint >( ReadUInt( is, 4 ));
+   DIP_THROW_IF(( ndims < 1 ) || ( ndims > 100 ), "Stream does not contain a valid histogram" );
+   Histogram out;
+   out.lowerBounds_.resize( ndims );
+   out.binSizes_.resize( ndims );
+   out.excludeOutOfBoundValues_.resize( ndims );
+   UnsignedArray sizes( ndims );
+   // The total number of bytes in the bin counts must be representable, so that a corrupted size cannot
+   // overflow the computation below or cause a huge allocation before the stream runs out.
+   dip::uint maxBins = maxint / sizeof( CountType );
+   dip::uint nBins = 1;
+   for( dip::uint ii = 0; ii < ndims; ++ii ) {
+      std::uint64_t size = ReadUInt( is, 8 );
+      out.lowerBounds_[ ii ] = ReadFloat( is );
+      out.binSizes_[ ii ] = ReadFloat( is );
+      out.excludeOutOfBoundValues_[ ii ] = ReadUInt( is, 1 ) != 0;
+      DIP_THROW_IF(( size < 1 ) || ( size > maxBins / nBins ) || !( out.binSizes_[ ii ] > 0.0 ),
+                   "Stream does not contain a valid histogram" );
+      sizes[ ii ] = static_cast< dip::uint >( size );
+      nBins *= sizes[ ii ];
+   }
+   out.data_.ReForge( sizes, 1, DT_COUNT );
+   ImageIterator< CountType > it( out.data_ );
+   do {
+      *it = static_cast< CountType >( ReadUInt( is, sizeof( CountType )));
+   } while( ++it );
+   return out;
+}
+
 Histogram Histogram::Cumulative() const {
    Histogram out = *this;
    out.data_.Strip();
@@ -428,6 +704,7 @@ Histogram Histogram::Marginal( dip::uint dim ) const {
    out.data_.PermuteDimensions( { dim } );
    out.lowerBounds_ = { lowerBounds_[ dim ] };
    out.binSizes_ = { binSizes_[ dim ] };
+   out.excludeOutOfBoundValues_ = { excludeOutOfBoundValues_[ dim ] };
    return out;
 }
 
@@ -455,8 +732,10 @@ Histogram Histogram::Smooth( FloatArray sigma ) const {
 
 
 #ifdef DIP__ENABLE_DOCTEST
+#include <sstream>
 #include "doctest.h"
 #include "diplib/random.h"
+#include "diplib/generation.h"
 
 DOCTEST_TEST_CASE( "[DIPlib] testing dip::Histogram" ) {
    dip::Image zero( {}, 1, dip::DT_SFLOAT );
@@ -577,4 +856,82 @@ DOCTEST_TEST_CASE( "[DIPlib] testing dip::Histogram" ) {
    DOCTEST_CHECK( tensorCov[ 5 ] == 0.0 ); // covariance 2nd & 3rd
 }
 
+namespace {
+
+bool SameHistogram( dip::Histogram const& h1, dip::Histogram const& h2 ) {
+   if(( h1.Bins() != h2.Bins() ) || ( h1.LowerBound() != h2.LowerBound() ) || ( h1.BinSize() != h2.BinSize() )) {
+      return false;
+   }
+   for( dip::uint ii = 0; ii < h1.Bins(); ++ii ) {
+      if( h1.At( ii ) != h2.At( ii )) {
+         return false;
+      }
+   }
+   return true;
+}
+
+} // namespace
+
+DOCTEST_TEST_CASE( "[DIPlib] testing dip::Histogram for integer images" ) {
+   // Integer images with integer bin boundaries are counted directly; compare to counting the same values as floats
+   dip::Random random( 0 );
+   dip::Image img( { 123, 97 }, 1, dip::DT_SFLOAT );
+   img.Fill( 0 );
+   dip::UniformNoise( img, img, random, -50, 300 );
+   dip::Image mask = img > 100;
+   dip::Image u8 = dip::Convert( img, dip::DT_UINT8 );
+   dip::Image s16 = dip::Convert( img, dip::DT_SINT16 );
+   dip::Image f8 = dip::Convert( u8, dip::DT_SFLOAT );
+   dip::Image f16 = dip::Convert( s16, dip::DT_SFLOAT );
+   dip::Histogram::Configuration conf( dip::DT_UINT8 );
+   DOCTEST_CHECK( SameHistogram( dip::Histogram( u8, {}, conf ), dip::Histogram( f8, {}, conf )));
+   DOCTEST_CHECK( SameHistogram( dip::Histogram( u8, mask, conf ), dip::Histogram( f8, mask, conf )));
+   conf = dip::Histogram::Configuration( -32.0, 64, 4.0 ); // clamps values out of range
+   DOCTEST_CHECK( SameHistogram( dip::Histogram( s16, {}, conf ), dip::Histogram( f16, {}, conf )));
+   DOCTEST_CHECK( SameHistogram( dip::Histogram( s16, mask, conf ), dip::Histogram( f16, mask, conf )));
+   conf.excludeOutOfBoundValues = true;
+   dip::Histogram h16( s16, {}, conf );
+   DOCTEST_CHECK( SameHistogram( h16, dip::Histogram( f16, {}, conf )));
+   DOCTEST_CHECK( h16.Count() < s16.NumberOfPixels() );
+   conf = dip::Histogram::Configuration( 10.0, 20, 1.0 );
+   DOCTEST_CHECK( SameHistogram( dip::Histogram( u8, {}, conf ), dip::Histogram( f8, {}, conf )));
+}
+
+DOCTEST_TEST_CASE( "[DIPlib] testing dip::Histogram accumulation and serialization" ) {
+   dip::Random random( 0 );
+   dip::Image img( { 100, 80 }, 1, dip::DT_SFLOAT );
+   img.Fill( 0 );
+   dip::UniformNoise( img, img, random, -10, 110 );
+   dip::Image mask = img > 20;
+   dip::Histogram::Configuration conf( 0.0, 100.0, 50 );
+   dip::Histogram full( img, mask, conf );
+   dip::Histogram streamed( conf );
+   DOCTEST_CHECK( streamed.Count() == 0 );
+   dip::RangeArray top{ dip::Range{}, dip::Range{ 0, 29 } };
+   dip::RangeArray bottom{ dip::Range{}, dip::Range{ 30, -1 } };
+   streamed.Add( img.At( top ), mask.At( top ));
+   dip::Histogram other( conf );
+   other.Add( img.At( bottom ), mask.At( bottom ));
+   streamed.Merge( other );
+   DOCTEST_CHECK( SameHistogram( full, streamed ));
+   DOCTEST_CHECK( streamed.Count() == dip::Count( mask ));
+
+   std::stringstream stream;
+   streamed.Serialize( stream );
+   dip::Histogram copy = dip::Histogram::Deserialize( stream );
+   DOCTEST_CHECK( SameHistogram( full, copy ));
+   copy.Add( img.At( top ), mask.At( top )); // must still be compatible
+   DOCTEST_CHECK( copy.Count() == full.Count() + dip::Histogram( img.At( top ), mask.At( top ), conf ).Count() );
+   std::stringstream garbage( "not a histogram" );
+   DOCTEST_CHECK_THROWS( dip::Histogram::Deserialize( garbage ));
+   std::string bytes = stream.str();
+   for( dip::uint ii = 0; ii < 8; ++ii ) {
+      bytes[ 12 + ii ] = static_cast< char >( 0xFF ); // size of the first dimension, after signature and ndims
+   }
+   std::stringstream corrupted( bytes );
+   DOCTEST_CHECK_THROWS( dip::Histogram::Deserialize( corrupted ));
+   conf.lowerIsPercentile = true;
+   DOCTEST_CHECK_THROWS( dip::Histogram{ conf } );
+}
+
 #endif // DIP__ENABLE_DOCTEST
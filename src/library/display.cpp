@@ -83,8 +83,16 @@ void ImageDisplay::ComputeLimits( bool set ) {
             }
          }
          if( mappingMode_ == MappingMode::PERCENTILE ) {
-            lims->lower = static_cast< dfloat >( Image::Sample( Percentile( tmp, {}, 5.0 )));
-            lims->upper = static_cast< dfloat >( Image::Sample( Percentile( tmp, {}, 95.0 )));
+            if( tmp.DataType().IsFloat() ) {
+               // Exact percentiles require a copy and partial sort of the data, the approximation is good enough
+               // for display and uses a single pass with little memory.
+               QuantileAccumulator res = SampleQuantiles( tmp );
+               lims->lower = res.Percentile( 5.0 );
+               lims->upper = res.Percentile( 95.0 );
+            } else {
+               lims->lower = static_cast< dfloat >( Image::Sample( Percentile( tmp, {}, 5.0 )));
+               lims->upper = static_cast< dfloat >( Image::Sample( Percentile( tmp, {}, 95.0 )));
+            }
          } else {
             MinMaxAccumulator res = MaximumAndMinimum( tmp );
             lims->lower = res.Minimum();
@@ -0,0 +1,86 @@
+/*
+ * DIPlib 3.0
+ * This file contains definitions for multithreading support.
+ *
+ * (c)2026, DIPlib contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "diplib.h"
+#include "diplib/multithreading.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace dip {
+
+#ifdef _OPENMP
+
+namespace {
+
+// The number of threads OpenMP uses for a parallel region by default. It honors `OMP_NUM_THREADS`.
+dip::uint DefaultNumberOfThreads() {
+   return static_cast< dip::uint >( omp_get_max_threads() );
+}
+
+dip::uint& MaxThreads() {
+   static dip::uint maxThreads = DefaultNumberOfThreads();
+   return maxThreads;
+}
+
+} // namespace
+
+void SetNumberOfThreads( dip::uint nThreads ) {
+   if( nThreads == 0 ) {
+      nThreads = DefaultNumberOfThreads();
+   }
+   MaxThreads() = nThreads;
+}
+
+dip::uint GetNumberOfThreads() {
+   return MaxThreads();
+}
+
+#else // _OPENMP
+
+void SetNumberOfThreads( dip::uint /*nThreads*/ ) {}
+
+dip::uint GetNumberOfThreads() {
+   return 1;
+}
+
+#endif // _OPENMP
+
+} // namespace dip
+
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing dip::SetNumberOfThreads") {
+   dip::uint nThreads = dip::GetNumberOfThreads();
+#ifdef _OPENMP
+   DOCTEST_CHECK( nThreads == static_cast< dip::uint >( omp_get_max_threads() ));
+   dip::SetNumberOfThreads( nThreads + 3 );
+   DOCTEST_CHECK( dip::GetNumberOfThreads() == nThreads + 3 );
+   dip::SetNumberOfThreads( 0 );
+   DOCTEST_CHECK( dip::GetNumberOfThreads() == nThreads );
+#else
+   DOCTEST_CHECK( nThreads == 1 );
+#endif
+   dip::SetNumberOfThreads( nThreads );
+}
+
+#endif // DIP__ENABLE_DOCTEST
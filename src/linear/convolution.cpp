@@ -24,6 +24,7 @@
 #include "diplib/framework.h"
 #include "diplib/pixel_table.h"
 #include "diplib/overload.h"
+#include "diplib/statistics.h"
 
 namespace dip {
 
@@ -74,6 +75,61 @@ struct InternOneDimensionalFilter {
 
 using InternOneDimensionalFilterArray = std::vector< InternOneDimensionalFilter >;
 
+// Number of output samples computed together in the contiguous-line code paths below. The block should
+// fit comfortably in the L1 cache, as each filter tap reads and writes the whole block once.
+constexpr dip::uint convolutionBlockSize = 512;
+
+// Applies a general 1D filter to a line with unit input and output strides. `in` points at the input
+// sample that, together with `filter[ 0 ]`, contributes to the first output sample. Loops over the filter
+// taps are outside loops over the samples, such that the inner loops have no dependencies between
+// iterations, and can be vectorized by the compiler. The order of the additions for each output sample
+// is the same as in the generic code path, so the results are identical.
+template< typename TPI >
+void ConvolveContiguousLineGeneral( TPI const* in, TPI* out, dip::uint length, FloatArray const& filter ) {
+   dip::uint filterSize = filter.size();
+   for( dip::uint start = 0; start < length; start += convolutionBlockSize ) {
+      dip::uint n = std::min( convolutionBlockSize, length - start );
+      TPI const* in_b = in + start;
+      TPI* out_b = out + start;
+      FloatType< TPI > weight = static_cast< FloatType< TPI >>( filter[ 0 ] );
+      for( dip::uint ii = 0; ii < n; ++ii ) {
+         out_b[ ii ] = weight * in_b[ ii ];
+      }
+      for( dip::uint jj = 1; jj < filterSize; ++jj ) {
+         weight = static_cast< FloatType< TPI >>( filter[ jj ] );
+         TPI const* in_t = in_b - jj;
+         for( dip::uint ii = 0; ii < n; ++ii ) {
+            out_b[ ii ] += weight * in_t[ ii ];
+         }
+      }
+   }
+}
+
+// Idem for an even (`Odd == false`) or odd (`Odd == true`) symmetric filter, of which `filter` is the
+// left half including the central tap. `in` points at the input sample under the central tap for the
+// first output sample.
+template< typename TPI, bool Odd >
+void ConvolveContiguousLineSymmetric( TPI const* in, TPI* out, dip::uint length, FloatArray const& filter ) {
+   dip::uint fsh = filter.size() - 1;
+   for( dip::uint start = 0; start < length; start += convolutionBlockSize ) {
+      dip::uint n = std::min( convolutionBlockSize, length - start );
+      TPI const* in_b = in + start;
+      TPI* out_b = out + start;
+      FloatType< TPI > weight = static_cast< FloatType< TPI >>( filter[ fsh ] );
+      for( dip::uint ii = 0; ii < n; ++ii ) {
+         out_b[ ii ] = weight * in_b[ ii ];
+      }
+      for( dip::uint kk = 1; kk <= fsh; ++kk ) {
+         weight = static_cast< FloatType< TPI >>( filter[ fsh - kk ] );
+         TPI const* in_r = in_b + kk;
+         TPI const* in_l = in_b - kk;
+         for( dip::uint ii = 0; ii < n; ++ii ) {
+            out_b[ ii ] += weight * ( Odd ? ( in_r[ ii ] - in_l[ ii ] ) : ( in_r[ ii ] + in_l[ ii ] ));
+         }
+      }
+   }
+}
+
 template< typename TPI >
 class SeparableConvolutionLineFilter : public Framework::SeparableLineFilter {
    public:
@@ -92,9 +148,14 @@ class SeparableConvolutionLineFilter : public Framework::SeparableLineFilter {
          dip::uint origin = filter_[ procDim ].origin;
          dip::uint filterSize = filter_[ procDim ].size;
          dip::uint fsh = filter.size() - 1;
+         bool contiguous = ( inStride == 1 ) && ( outStride == 1 );
          switch( filter_[ procDim ].symmetry ) {
             case FilterSymmetry::GENERAL:
                in += static_cast< dip::sint >( origin ) * inStride;
+               if( contiguous ) {
+                  ConvolveContiguousLineGeneral( in, out, length, filter );
+                  break;
+               }
                for( dip::uint ii = 0; ii < length; ++ii ) {
                   TPI sum = 0;
                   TPI* in_t = in;
@@ -109,6 +170,10 @@ class SeparableConvolutionLineFilter : public Framework::SeparableLineFilter {
                break;
             case FilterSymmetry::EVEN: // Always an odd-sized filter
                in += static_cast< dip::sint >( origin - fsh ) * inStride;
+               if( contiguous ) {
+                  ConvolveContiguousLineSymmetric< TPI, false >( in, out, length, filter );
+                  break;
+               }
                for( dip::uint ii = 0; ii < length; ++ii ) {
                   TPI* in_r = in;
                   TPI sum = static_cast< FloatType< TPI >>( filter[ fsh ] ) * *in_r;
@@ -128,6 +193,10 @@ class SeparableConvolutionLineFilter : public Framework::SeparableLineFilter {
                break;
             case FilterSymmetry::ODD: // Always an odd-sized filter
                in += static_cast< dip::sint >( origin - fsh ) * inStride;
+               if( contiguous ) {
+                  ConvolveContiguousLineSymmetric< TPI, true >( in, out, length, filter );
+                  break;
+               }
                for( dip::uint ii = 0; ii < length; ++ii ) {
                   TPI* in_r = in;
                   TPI sum = static_cast< FloatType< TPI >>( filter[ fsh ] ) * *in_r;
@@ -378,6 +447,101 @@ void GeneralConvolution(
 }
 
 
+namespace {
+
+// Applies the sum of separable filters in `terms`, as produced by `SeparateFilterLowRank`.
+void ConvolveSeparableTerms(
+      Image const& c_in,
+      Image& out,
+      std::vector< OneDimensionalFilterArray > terms, // by copy, we modify it
+      StringArray const& boundaryCondition
+) {
+   DIP_THROW_IF( terms.empty(), "Filter kernel is not separable, use a different method" );
+   Image in = c_in.QuickCopy();
+   if( in.Aliases( out )) {
+      out.Strip();
+   }
+   dip::uint nDims = in.Dimensionality();
+   for( auto& term : terms ) {
+      DIP_THROW_IF( term.size() > nDims, E::DIMENSIONALITIES_DONT_MATCH );
+      term.resize( nDims ); // Filters with zero size are not applied
+   }
+   SeparableConvolution( in, out, terms[ 0 ], boundaryCondition );
+   Image tmp;
+   for( dip::uint ii = 1; ii < terms.size(); ++ii ) {
+      SeparableConvolution( in, tmp, terms[ ii ], boundaryCondition );
+      out += tmp;
+   }
+}
+
+} // namespace
+
+void Convolution(
+      Image const& in,
+      Image const& filter,
+      Image& out,
+      String const& method,
+      StringArray const& boundaryCondition,
+      dfloat tolerance
+) {
+   DIP_THROW_IF( !in.IsForged(), E::IMAGE_NOT_FORGED );
+   DIP_THROW_IF( !filter.IsForged(), E::IMAGE_NOT_FORGED );
+   DIP_THROW_IF( !filter.IsScalar(), E::IMAGE_NOT_SCALAR );
+   DIP_THROW_IF( filter.Dimensionality() > in.Dimensionality(), E::DIMENSIONALITIES_DONT_MATCH );
+   if( filter.DataType().IsBinary() || ( method == "direct" )) {
+      DIP_STACK_TRACE_THIS( GeneralConvolution( in, filter, out, boundaryCondition ));
+      return;
+   }
+   if( method == "fourier" ) {
+      DIP_STACK_TRACE_THIS( ConvolveFT( in, filter, out ));
+      return;
+   }
+   if( method == "separable" ) {
+      DIP_START_STACK_TRACE
+         ConvolveSeparableTerms( in, out, SeparateFilterLowRank( filter, tolerance ), boundaryCondition );
+      DIP_END_STACK_TRACE
+      return;
+   }
+   DIP_THROW_IF( method != "best", E::INVALID_FLAG );
+   // Rough estimates of the number of multiply-adds per output pixel for each method
+   dfloat nPixels = static_cast< dfloat >( in.NumberOfPixels() );
+   dfloat costDirect = static_cast< dfloat >( Count( filter ));
+   dfloat costFourier = std::numeric_limits< dfloat >::max();
+   bool periodic = !boundaryCondition.empty();
+   for( auto const& bc : boundaryCondition ) {
+      periodic &= bc == "periodic";
+   }
+   UnsignedArray filterSizes = filter.Sizes();
+   filterSizes.resize( in.Dimensionality(), 1 );
+   if( periodic && ( filterSizes <= in.Sizes() )) {
+      // Three FFTs (input, filter, inverse), each of which costs about 5 log2(N) operations per pixel
+      costFourier = 15.0 * std::log2( nPixels );
+   }
+   constexpr dip::uint maxSeparableTerms = 8;
+   std::vector< OneDimensionalFilterArray > terms;
+   dfloat costSeparable = std::numeric_limits< dfloat >::max();
+   DIP_STACK_TRACE_THIS( terms = SeparateFilterLowRank( filter, tolerance, maxSeparableTerms ));
+   if( !terms.empty() ) {
+      costSeparable = 0.0;
+      for( auto const& term : terms ) {
+         for( auto const& f : term ) {
+            costSeparable += static_cast< dfloat >( f.filter.size() );
+         }
+         costSeparable += 1.0; // the addition of the term's result to the output
+      }
+   }
+   DIP_START_STACK_TRACE
+      if(( costSeparable <= costDirect ) && ( costSeparable <= costFourier )) {
+         ConvolveSeparableTerms( in, out, std::move( terms ), boundaryCondition );
+      } else if( costFourier < costDirect ) {
+         ConvolveFT( in, filter, out );
+      } else {
+         GeneralConvolution( in, filter, out, boundaryCondition );
+      }
+   DIP_END_STACK_TRACE
+}
+
+
 } // namespace dip
 
 
@@ -386,6 +550,7 @@ void GeneralConvolution(
 #include "diplib/statistics.h"
 #include "diplib/generation.h"
 #include "diplib/iterators.h"
+#include "diplib/testing.h"
 
 DOCTEST_TEST_CASE("[DIPlib] testing the separable convolution") {
    dip::dfloat meanval = 9563.0;
@@ -473,4 +638,35 @@ DOCTEST_TEST_CASE("[DIPlib] testing the separable convolution") {
    DOCTEST_CHECK( dip::Mean( out1 - out2 ).As< dip::dfloat >() / meanval == doctest::Approx( 0.0 ));
 }
 
+DOCTEST_TEST_CASE("[DIPlib] testing the convolution method selection") {
+   dip::Image img{ dip::UnsignedArray{ 64, 50 }, 1, dip::DT_SFLOAT };
+   img.Fill( 100.0 );
+   dip::Random random( 0 );
+   dip::GaussianNoise( img, img, random, 25.0 );
+   // A non-separable filter of rank 2
+   dip::Image delta{ dip::UnsignedArray{ 15, 11 }, 1, dip::DT_DFLOAT };
+   delta.Fill( 0 );
+   delta.At( 7, 5 ) = 1;
+   dip::Image filter = dip::GaussFIR( delta, { 2.0, 1.5 } ) + dip::GaussFIR( delta, { 1.0, 2.0 }, { 1, 0 } );
+   dip::Image direct = dip::Convolution( img, filter, "direct", { "periodic" } );
+   dip::Image separable = dip::Convolution( img, filter, "separable", { "periodic" } );
+   DOCTEST_CHECK( dip::testing::CompareImages( direct, separable, 1e-3 ));
+   dip::Image fourier = dip::Convolution( img, filter, "fourier" );
+   DOCTEST_CHECK( dip::testing::CompareImages( direct, fourier, 1e-3 ));
+   dip::Image best = dip::Convolution( img, filter, "best", { "periodic" } );
+   DOCTEST_CHECK( dip::testing::CompareImages( direct, best, 1e-3 ));
+   best = dip::Convolution( img, filter );
+   direct = dip::Convolution( img, filter, "direct" );
+   DOCTEST_CHECK( dip::testing::CompareImages( direct, best, 1e-3 ));
+   // A 3D filter is only decomposed if it is exactly separable
+   dip::Image img3{ dip::UnsignedArray{ 20, 15, 10 }, 1, dip::DT_SFLOAT };
+   img3.Fill( 1.0 );
+   dip::Image filter3{ dip::UnsignedArray{ 3, 3, 3 }, 1, dip::DT_SFLOAT };
+   filter3.Fill( 0 );
+   filter3.At( 0, 0, 0 ) = 1;
+   filter3.At( 1, 1, 1 ) = 1;
+   DOCTEST_CHECK_THROWS( dip::Convolution( img3, filter3, "separable" ));
+   DOCTEST_CHECK_NOTHROW( dip::Convolution( img3, filter3, "best" ));
+}
+
 #endif // DIP__ENABLE_DOCTEST
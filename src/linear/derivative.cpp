@@ -23,40 +23,62 @@
 #include <diplib/math.h>
 #include <diplib/generic_iterators.h>
 
+#include <numeric>
+
 namespace dip {
 
 namespace {
 
-void GaussDispatch(
-      Image const& in,
-      Image& out,
+enum class GaussMethod {
+      FIR,
+      FT,
+      IIR
+};
+
+GaussMethod ChooseGaussMethod(
       FloatArray const& sigmas,
-      UnsignedArray const& derivativeOrder,
-      StringArray const& boundaryCondition,
-      dfloat truncation
+      UnsignedArray const& derivativeOrder
 ) {
    // If any( sigmas < 0.8 ) || any( derivativeOrder > 3 )  ==>  FT
    // Else if any( sigmas > 10 )  ==>  IIR
    // Else ==>  FIR
    for( dip::uint ii = 0; ii < derivativeOrder.size(); ++ii ) { // We can't fold this loop in with the next one, the two arrays might be of different size
       if( derivativeOrder[ ii ] > 3 ) {
-         GaussFT( in, out, sigmas, derivativeOrder, truncation ); // ignores boundaryCondition
-         return;
+         return GaussMethod::FT;
       }
    }
    for( dip::uint ii = 0; ii < sigmas.size(); ++ii ) {
       if(( sigmas[ ii ] < 0.8 ) && ( sigmas[ ii ] > 0.0 )) {
-         GaussFT( in, out, sigmas, derivativeOrder, truncation ); // ignores boundaryCondition
-         return;
+         return GaussMethod::FT;
       }
    }
    for( dip::uint ii = 0; ii < sigmas.size(); ++ii ) {
       if( sigmas[ ii ] > 10 ) {
-         GaussIIR( in, out, sigmas, derivativeOrder, boundaryCondition, {}, "", truncation );
-         return;
+         return GaussMethod::IIR;
       }
    }
-   GaussFIR( in, out, sigmas, derivativeOrder, boundaryCondition, truncation );
+   return GaussMethod::FIR;
+}
+
+void GaussDispatch(
+      Image const& in,
+      Image& out,
+      FloatArray const& sigmas,
+      UnsignedArray const& derivativeOrder,
+      StringArray const& boundaryCondition,
+      dfloat truncation
+) {
+   switch( ChooseGaussMethod( sigmas, derivativeOrder )) {
+      case GaussMethod::FT:
+         GaussFT( in, out, sigmas, derivativeOrder, truncation ); // ignores boundaryCondition
+         break;
+      case GaussMethod::IIR:
+         GaussIIR( in, out, sigmas, derivativeOrder, boundaryCondition, {}, "", truncation );
+         break;
+      case GaussMethod::FIR:
+         GaussFIR( in, out, sigmas, derivativeOrder, boundaryCondition, truncation );
+         break;
+   }
 }
 
 } // namespace
@@ -158,6 +180,209 @@ UnsignedArray FindGradientDimensions(
    return dims;
 }
 
+// The separable methods that `Derivative` can use. For these we can compute a set of derivatives
+// by sharing the 1D passes they have in common.
+enum class SeparableDerivativeMethod {
+      NONE,       // not separable (or not recognized), compute each derivative independently
+      FINITEDIFF,
+      GAUSS_FIR,
+      GAUSS_IIR
+};
+
+SeparableDerivativeMethod ChooseSeparableDerivativeMethod(
+      String const& method,
+      FloatArray const& sigmas,
+      std::vector< UnsignedArray > const& orders
+) {
+   if( method == "finitediff" ) {
+      return SeparableDerivativeMethod::FINITEDIFF;
+   }
+   if(( method == "gaussFIR" ) || ( method == "gaussfir" )) {
+      return SeparableDerivativeMethod::GAUSS_FIR;
+   }
+   if(( method == "gaussIIR" ) || ( method == "gaussiir" )) {
+      return SeparableDerivativeMethod::GAUSS_IIR;
+   }
+   if(( method == "best" ) || ( method == "gauss" )) {
+      // We need to pick the same method for all derivatives, otherwise the results are not comparable
+      GaussMethod choice = GaussMethod::FIR;
+      for( auto const& order : orders ) {
+         GaussMethod m = ChooseGaussMethod( sigmas, order );
+         if( m == GaussMethod::FT ) {
+            return SeparableDerivativeMethod::NONE;
+         }
+         if( m == GaussMethod::IIR ) {
+            choice = GaussMethod::IIR;
+         }
+      }
+      return choice == GaussMethod::IIR ? SeparableDerivativeMethod::GAUSS_IIR : SeparableDerivativeMethod::GAUSS_FIR;
+   }
+   return SeparableDerivativeMethod::NONE;
+}
+
+struct FusedDerivativeParameters {
+   SeparableDerivativeMethod method;
+   FloatArray const& sigmas;
+   StringArray const& boundaryCondition;
+   dfloat truncation;
+};
+
+// Applies the derivative filter given by `order` to `in`, but only along the dimensions in `dims`.
+void PartialDerivative(
+      Image const& in,
+      Image& out,
+      UnsignedArray const& dims,
+      UnsignedArray const& order,
+      FusedDerivativeParameters const& params
+) {
+   dip::uint nDims = in.Dimensionality();
+   FloatArray sigmas( nDims, 0.0 );
+   UnsignedArray partialOrder( nDims, 0 );
+   BooleanArray process( nDims, false );
+   for( auto dim : dims ) {
+      sigmas[ dim ] = params.sigmas[ dim ];
+      partialOrder[ dim ] = order[ dim ];
+      process[ dim ] = true;
+   }
+   switch( params.method ) {
+      case SeparableDerivativeMethod::FINITEDIFF:
+         FiniteDifference( in, out, partialOrder, "smooth", params.boundaryCondition, process );
+         break;
+      case SeparableDerivativeMethod::GAUSS_FIR:
+         GaussFIR( in, out, sigmas, partialOrder, params.boundaryCondition, params.truncation );
+         break;
+      case SeparableDerivativeMethod::GAUSS_IIR:
+         GaussIIR( in, out, sigmas, partialOrder, params.boundaryCondition, {}, "", params.truncation );
+         break;
+      default:
+         DIP_THROW( E::NOT_IMPLEMENTED ); // Should not happen
+   }
+}
+
+// One level of the fused derivative computation. The derivatives in `subset` (indices into `orders` and
+// `out`) all share the 1D passes along `levels[ 0 ]` to `levels[ level - 1 ]`, the result of which is `in`.
+// Here we split `subset` into groups with equal derivative order along `levels[ level ]`, filter `in` once
+// for each group, and recurse.
+void FusedDerivativesLevel(
+      Image const& in,
+      std::vector< Image >& out,
+      std::vector< UnsignedArray > const& orders,
+      std::vector< dip::uint > const& subset,
+      std::vector< UnsignedArray > const& levels,
+      dip::uint level,
+      ImageArray& intermediates,
+      FusedDerivativeParameters const& params
+) {
+   UnsignedArray const& dims = levels[ level ];
+   std::vector< bool > done( subset.size(), false );
+   for( dip::uint ii = 0; ii < subset.size(); ++ii ) {
+      if( done[ ii ] ) {
+         continue;
+      }
+      UnsignedArray const& order = orders[ subset[ ii ]];
+      std::vector< dip::uint > group;
+      for( dip::uint jj = ii; jj < subset.size(); ++jj ) {
+         if( !done[ jj ] ) {
+            UnsignedArray const& other = orders[ subset[ jj ]];
+            bool equal = true;
+            for( auto dim : dims ) {
+               equal &= other[ dim ] == order[ dim ];
+            }
+            if( equal ) {
+               group.push_back( subset[ jj ] );
+               done[ jj ] = true;
+            }
+         }
+      }
+      if( group.size() == 1 ) {
+         // Nothing more to share in this branch: apply all remaining 1D passes in one go
+         UnsignedArray remaining;
+         for( dip::uint jj = level; jj < levels.size(); ++jj ) {
+            for( auto dim : levels[ jj ] ) {
+               remaining.push_back( dim );
+            }
+         }
+         PartialDerivative( in, out[ group[ 0 ]], remaining, order, params );
+      } else if( level + 1 == levels.size() ) {
+         // The derivatives in this group are identical
+         PartialDerivative( in, out[ group[ 0 ]], dims, order, params );
+         for( dip::uint jj = 1; jj < group.size(); ++jj ) {
+            out[ group[ jj ]].Copy( out[ group[ 0 ]] );
+         }
+      } else {
+         PartialDerivative( in, intermediates[ level ], dims, order, params );
+         FusedDerivativesLevel( intermediates[ level ], out, orders, group, levels, level + 1, intermediates, params );
+      }
+   }
+}
+
+// Computes the derivatives given by `orders` into the images in `out` (which can be tensor element views
+// into a larger image, or unforged images). For separable methods, the 1D passes along each dimension are
+// shared among all derivatives that have the same derivative orders along the dimensions processed earlier:
+// e.g. for the 3D Hessian, the smoothing along x is done only once for dyy, dzz and dyz. Dimensions along
+// which no derivative is computed, but that are smoothed, are processed first, once for all derivatives.
+void ComputeDerivatives(
+      Image const& in,
+      std::vector< Image >& out,
+      std::vector< UnsignedArray > const& orders,
+      FloatArray const& sigmas, // expanded to nDims
+      String const& method,
+      StringArray const& boundaryCondition,
+      dfloat truncation
+) {
+   DIP_ASSERT( out.size() == orders.size() );
+   SeparableDerivativeMethod separableMethod = ChooseSeparableDerivativeMethod( method, sigmas, orders );
+   if(( separableMethod == SeparableDerivativeMethod::NONE ) || ( orders.size() < 2 )) {
+      for( dip::uint ii = 0; ii < orders.size(); ++ii ) {
+         Derivative( in, out[ ii ], orders[ ii ], sigmas, method, boundaryCondition, truncation );
+      }
+      return;
+   }
+   // Find the dimensions that are filtered, and sort them into levels
+   dip::uint nDims = in.Dimensionality();
+   UnsignedArray smoothDims;
+   std::vector< UnsignedArray > levels;
+   for( dip::uint ii = 0; ii < nDims; ++ii ) {
+      if(( sigmas[ ii ] > 0.0 ) && ( in.Size( ii ) > 1 )) {
+         bool isDerivative = false;
+         for( auto const& order : orders ) {
+            isDerivative |= order[ ii ] != 0;
+         }
+         if( isDerivative ) {
+            levels.push_back( { ii } );
+         } else {
+            smoothDims.push_back( ii );
+         }
+      }
+   }
+   if( !smoothDims.empty() ) {
+      levels.insert( levels.begin(), smoothDims );
+   }
+   if( levels.empty() ) {
+      // No filtering to be done at all
+      for( dip::uint ii = 0; ii < orders.size(); ++ii ) {
+         Derivative( in, out[ ii ], orders[ ii ], sigmas, method, boundaryCondition, truncation );
+      }
+      return;
+   }
+   FusedDerivativeParameters params{ separableMethod, sigmas, boundaryCondition, truncation };
+   std::vector< dip::uint > all( orders.size() );
+   std::iota( all.begin(), all.end(), dip::uint( 0 ));
+   ImageArray intermediates( levels.size() );
+   FusedDerivativesLevel( in, out, orders, all, levels, 0, intermediates, params );
+}
+
+// Returns the tensor elements of `img` as a series of scalar images, in storage order.
+std::vector< Image > TensorElementViews( Image const& img ) {
+   std::vector< Image > views;
+   views.reserve( img.TensorElements() );
+   auto it = ImageTensorIterator( img );
+   do {
+      views.push_back( *it );
+   } while( ++it );
+   return views;
+}
+
 } // namespace
 
 void Gradient(
@@ -183,16 +408,14 @@ void Gradient(
       out.Strip();
    }
    out.ReForge( in.Sizes(), nDims, DataType::SuggestFlex( in.DataType() ));
-   UnsignedArray order( in.Dimensionality(), 0 );
-   auto it = ImageTensorIterator( out );
+   std::vector< UnsignedArray > orders( nDims, UnsignedArray( in.Dimensionality(), 0 ));
    for( dip::uint ii = 0; ii < nDims; ++ii ) {
-      order[ dims[ ii ]] = 1;
-      DIP_START_STACK_TRACE
-         Derivative( in, *it, order, sigmas, method, boundaryCondition, truncation );
-      DIP_END_STACK_TRACE
-      order[ dims[ ii ]] = 0;
-      ++it;
+      orders[ ii ][ dims[ ii ]] = 1;
    }
+   std::vector< Image > components = TensorElementViews( out );
+   DIP_START_STACK_TRACE
+      ComputeDerivatives( in, components, orders, sigmas, method, boundaryCondition, truncation );
+   DIP_END_STACK_TRACE
    out.SetPixelSize( pxsz );
 }
 
@@ -391,28 +614,23 @@ void Hessian (
    Tensor tensor( Tensor::Shape::SYMMETRIC_MATRIX, nDims, nDims );
    out.ReForge( in.Sizes(), tensor.Elements(), DataType::SuggestFlex( in.DataType() ));
    out.ReshapeTensor( tensor );
-   UnsignedArray order( in.Dimensionality(), 0 );
-   auto it = ImageTensorIterator( out );
+   std::vector< UnsignedArray > orders;
+   orders.reserve( tensor.Elements() );
    for( dip::uint ii = 0; ii < nDims; ++ii ) { // Symmetric matrix stores diagonal elements first
-      order[ dims[ ii ]] = 2;
-      DIP_START_STACK_TRACE
-         Derivative( in, *it, order, sigmas, method, boundaryCondition, truncation );
-      DIP_END_STACK_TRACE
-      order[ dims[ ii ]] = 0;
-      ++it;
+      orders.emplace_back( in.Dimensionality(), 0 );
+      orders.back()[ dims[ ii ]] = 2;
    }
    for( dip::uint jj = 1; jj < nDims; ++jj ) { // Elements above diagonal stored column-wise
       for( dip::uint ii = 0; ii < jj; ++ii ) {
-         order[ dims[ ii ]] = 1;
-         order[ dims[ jj ]] = 1;
-         DIP_START_STACK_TRACE
-            Derivative( in, *it, order, sigmas, method, boundaryCondition, truncation );
-         DIP_END_STACK_TRACE
-         order[ dims[ ii ]] = 0;
-         order[ dims[ jj ]] = 0;
-         ++it;
+         orders.emplace_back( in.Dimensionality(), 0 );
+         orders.back()[ dims[ ii ]] = 1;
+         orders.back()[ dims[ jj ]] = 1;
       }
    }
+   std::vector< Image > components = TensorElementViews( out );
+   DIP_START_STACK_TRACE
+      ComputeDerivatives( in, components, orders, sigmas, method, boundaryCondition, truncation );
+   DIP_END_STACK_TRACE
    out.SetPixelSize( pxsz );
 }
 
@@ -454,22 +672,53 @@ void Laplace (
       if( in.Aliases( out ) ) {
          out.Strip();
       }
-      UnsignedArray order( in.Dimensionality(), 0 );
-      order[ dims[ 0 ]] = 2;
+      out.ReForge( in.Sizes(), 1, DataType::SuggestFlex( in.DataType() ));
+      std::vector< UnsignedArray > orders( nDims, UnsignedArray( in.Dimensionality(), 0 ));
+      for( dip::uint ii = 0; ii < nDims; ++ii ) {
+         orders[ ii ][ dims[ ii ]] = 2;
+      }
+      std::vector< Image > terms( nDims );
+      terms[ 0 ] = out; // shares the data with `out`, the other terms are temporary images
+      terms[ 0 ].Protect();
       DIP_START_STACK_TRACE
-         Derivative( in, out, order, sigmas, method, boundaryCondition, truncation );
+         ComputeDerivatives( in, terms, orders, sigmas, method, boundaryCondition, truncation );
       DIP_END_STACK_TRACE
-      Image tmp;
       for( dip::uint ii = 1; ii < nDims; ++ii ) {
-         order[ dims[ ii - 1 ]] = 0;
-         order[ dims[ ii ]] = 2;
-         DIP_START_STACK_TRACE
-            Derivative( in, tmp, order, sigmas, method, boundaryCondition, truncation );
-         DIP_END_STACK_TRACE
-         out += tmp;
+         out += terms[ ii ];
       }
       out.SetPixelSize( pxsz );
    }
 }
 
 } // namespace dip
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+#include "diplib/generation.h"
+#include "diplib/testing.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the fused computation of derivatives") {
+   dip::Image img{ dip::UnsignedArray{ 40, 30, 20 }, 1, dip::DT_SFLOAT };
+   img.Fill( 100.0 );
+   dip::Random random( 0 );
+   dip::GaussianNoise( img, img, random, 20.0 );
+   for( auto const& method : dip::StringArray{ "gaussfir", "gaussiir", "finitediff" } ) {
+      dip::Image hessian = dip::Hessian( img, { 2.0 }, method );
+      DOCTEST_REQUIRE( hessian.TensorElements() == 6 );
+      dip::Image dxx = dip::Derivative( img, { 2, 0, 0 }, { 2.0 }, method );
+      DOCTEST_CHECK( dip::testing::CompareImages( hessian[ dip::UnsignedArray{ 0, 0 } ], dxx, 1e-3 ));
+      dip::Image dyz = dip::Derivative( img, { 0, 1, 1 }, { 2.0 }, method );
+      DOCTEST_CHECK( dip::testing::CompareImages( hessian[ dip::UnsignedArray{ 1, 2 } ], dyz, 1e-3 ));
+      dip::Image gradient = dip::Gradient( img, { 2.0 }, method, {}, { true, false, true } );
+      DOCTEST_REQUIRE( gradient.TensorElements() == 2 );
+      dip::Image dz = dip::Derivative( img, { 0, 0, 1 }, { 2.0 }, method );
+      DOCTEST_CHECK( dip::testing::CompareImages( gradient[ 1 ], dz, 1e-3 ));
+   }
+   dip::Image laplace = dip::Laplace( img, { 2.0 } );
+   dip::Image trace = dip::Derivative( img, { 2, 0, 0 }, { 2.0 } );
+   trace += dip::Derivative( img, { 0, 2, 0 }, { 2.0 } );
+   trace += dip::Derivative( img, { 0, 0, 2 }, { 2.0 } );
+   DOCTEST_CHECK( dip::testing::CompareImages( laplace, trace, 1e-3 ));
+}
+
+#endif // DIP__ENABLE_DOCTEST
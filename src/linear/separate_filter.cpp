@@ -84,6 +84,68 @@ OneDimensionalFilterArray SeparateFilter( Image const& c_in ) {
    return out;
 }
 
+std::vector< OneDimensionalFilterArray > SeparateFilterLowRank( Image const& c_in, dfloat tolerance, dip::uint maxRank ) {
+   DIP_THROW_IF( !c_in.IsForged(), E::IMAGE_NOT_FORGED );
+   DIP_THROW_IF( !c_in.DataType().IsReal(), E::DATA_TYPE_NOT_SUPPORTED );
+   DIP_THROW_IF( !c_in.IsScalar(), E::IMAGE_NOT_SCALAR );
+   DIP_THROW_IF( tolerance < 0.0, E::INVALID_PARAMETER );
+   dip::uint ndims = c_in.Dimensionality();
+   DIP_THROW_IF( ndims < 1, E::DIMENSIONALITY_NOT_SUPPORTED );
+   UnsignedArray sizes = c_in.Sizes();
+   UnsignedArray dims; // The dimensions along which the filter has more than one pixel
+   for( dip::uint ii = 0; ii < ndims; ++ii ) {
+      if( sizes[ ii ] > 1 ) {
+         dims.push_back( ii );
+      }
+   }
+   if( dims.size() != 2 ) {
+      // A 1D filter is always separable; for more than two dimensions we only handle the separable case.
+      OneDimensionalFilterArray out = SeparateFilter( c_in );
+      if( out.empty() ) {
+         return {};
+      }
+      return { out };
+   }
+   Image filter = Convert( c_in, DT_DFLOAT ); // Filter is DFLOAT and has normal strides
+   DIP_ASSERT( filter.HasNormalStrides() );
+   dfloat* data = static_cast< dfloat* >( filter.Origin() );
+   // With normal strides and all other dimensions singleton, the filter is a column-major matrix with
+   // `sizes[ dims[ 0 ]]` rows and `sizes[ dims[ 1 ]]` columns
+   dip::uint rows = sizes[ dims[ 0 ]];
+   dip::uint cols = sizes[ dims[ 1 ]];
+   Eigen::Map< Eigen::MatrixXd > matrix( data, static_cast< Eigen::Index >( rows ), static_cast< Eigen::Index >( cols ));
+   Eigen::JacobiSVD< Eigen::MatrixXd > svd( matrix, Eigen::ComputeThinU | Eigen::ComputeThinV );
+   auto S = svd.singularValues();
+   dip::uint nValues = static_cast< dip::uint >( S.size() );
+   // The Frobenius norm of the error made by dropping singular values k, k+1, ..., is given by
+   // sqrt( S(k)^2 + S(k+1)^2 + ... ). We pick the smallest rank for which this error is within tolerance.
+   dfloat maxError = tolerance * tolerance * S.squaredNorm();
+   dip::uint rank = nValues;
+   dfloat error = 0.0;
+   while( rank > 1 ) {
+      dfloat s = S( static_cast< Eigen::Index >( rank - 1 ));
+      error += s * s;
+      if( error > maxError ) {
+         break;
+      }
+      --rank;
+   }
+   if(( maxRank > 0 ) && ( rank > maxRank )) {
+      return {};
+   }
+   std::vector< OneDimensionalFilterArray > out( rank, OneDimensionalFilterArray( ndims ));
+   for( dip::uint kk = 0; kk < rank; ++kk ) {
+      Eigen::Index k = static_cast< Eigen::Index >( kk );
+      out[ kk ][ dims[ 0 ]].filter.resize( rows );
+      Eigen::Map< Eigen::VectorXd > column( out[ kk ][ dims[ 0 ]].filter.data(), static_cast< Eigen::Index >( rows ));
+      column = svd.matrixU().col( k ) * S( k );
+      out[ kk ][ dims[ 1 ]].filter.resize( cols );
+      Eigen::Map< Eigen::VectorXd > row( out[ kk ][ dims[ 1 ]].filter.data(), static_cast< Eigen::Index >( cols ));
+      row = svd.matrixV().col( k );
+   }
+   return out;
+}
+
 
 } // namespace dip
 
@@ -161,4 +223,31 @@ DOCTEST_TEST_CASE("[DIPlib] testing the filter separation") {
    DOCTEST_CHECK( m.Maximum() < 1e-5 );
 }
 
+DOCTEST_TEST_CASE("[DIPlib] testing the low-rank filter separation") {
+   dip::Image delta( { 40, 30 }, 1, dip::DT_SFLOAT );
+   delta.Fill( 0 );
+   delta.At( 20, 15 ) = 1;
+
+   // The sum of two Gaussians with different sigmas has rank 2
+   dip::Image filter = dip::GaussFIR( delta, { 2, 3 }, { 0, 0 } ) + dip::GaussFIR( delta, { 4, 1 }, { 0, 1 } );
+   filter = filter.Crop( { 25, 19 } );
+   DOCTEST_CHECK( dip::SeparateFilter( filter ).empty() );
+   auto terms = dip::SeparateFilterLowRank( filter );
+   DOCTEST_REQUIRE( terms.size() == 2 );
+   DOCTEST_REQUIRE( terms[ 0 ].size() == 2 );
+   DOCTEST_CHECK( terms[ 0 ][ 0 ].filter.size() == 25 );
+   DOCTEST_CHECK( terms[ 0 ][ 1 ].filter.size() == 19 );
+   DOCTEST_CHECK( dip::SeparateFilterLowRank( filter, 1e-7, 1 ).empty() );
+   dip::Image sum = dip::SeparableConvolution( delta, terms[ 0 ] ) + dip::SeparableConvolution( delta, terms[ 1 ] );
+   dip::Image direct = dip::GeneralConvolution( delta, filter );
+   sum -= direct;
+   auto m = dip::MaximumAndMinimum( sum );
+   DOCTEST_CHECK( m.Minimum() > -1e-6 );
+   DOCTEST_CHECK( m.Maximum() < 1e-6 );
+
+   // A separable filter yields a single term
+   terms = dip::SeparateFilterLowRank( dip::GaussFIR( delta, { 2, 3 }, { 1, 0 } ).Crop( { 25, 19 } ));
+   DOCTEST_CHECK( terms.size() == 1 );
+}
+
 #endif // DIP__ENABLE_DOCTEST
@@ -0,0 +1,422 @@
+/*
+ * DIPlib 3.0
+ * This file contains the definition for the IntegralImage class.
+ *
+ * (c)2026, DIPlib contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "diplib.h"
+#include "diplib/statistics.h"
+#include "diplib/iterators.h"
+
+namespace dip {
+
+namespace {
+
+// Copies the pixel values of `in` (already converted to `TPI`) into the table, at an offset of one pixel along
+// each dimension, optionally squaring them. The first element along each dimension stays 0.
+template< typename TT, typename TPI >
+void FillTable( Image const& in, IntegerArray const& strides, TT shift, bool square, std::vector< TT >& table ) {
+   dip::uint nDims = in.Dimensionality();
+   dip::sint tableOffset = 0;
+   for( dip::uint ii = 0; ii < nDims; ++ii ) {
+      tableOffset += strides[ ii ];
+   }
+   ImageIterator< TPI const > it( in, 0 );
+   do {
+      UnsignedArray const& coords = it.Coordinates();
+      dip::sint offset = tableOffset;
+      for( dip::uint ii = 1; ii < nDims; ++ii ) {
+         offset += static_cast< dip::sint >( coords[ ii ] ) * strides[ ii ];
+      }
+      TT* dest = table.data() + offset;
+      auto lit = it.GetLineIterator();
+      if( square ) {
+         do {
+            TT v = static_cast< TT >( *lit ) - shift;
+            *dest = v * v;
+            ++dest;
+         } while( ++lit );
+      } else {
+         do {
+            *dest = static_cast< TT >( *lit ) - shift;
+            ++dest;
+         } while( ++lit );
+      }
+   } while( ++it );
+}
+
+// Turns the table into its cumulative sum along each dimension. For dimensions other than the first, the
+// inner loop adds one contiguous hyperplane to the next, which the compiler can vectorize.
+template< typename TT >
+void CumulateTable( UnsignedArray const& tableSizes, std::vector< TT >& table ) {
+   dip::uint plane = 1;
+   for( dip::uint dim = 0; dim < tableSizes.size(); ++dim ) {
+      dip::uint length = tableSizes[ dim ];
+      dip::uint block = plane * length;
+      for( TT* base = table.data(); base < table.data() + table.size(); base += block ) {
+         for( dip::uint ii = 1; ii < length; ++ii ) {
+            TT const* prev = base + ( ii - 1 ) * plane;
+            TT* cur = base + ii * plane;
+            for( dip::uint jj = 0; jj < plane; ++jj ) {
+               cur[ jj ] += prev[ jj ];
+            }
+         }
+      }
+      plane = block;
+   }
+}
+
+// Sum over the box [lower,upper) using the 2^nDims corners of the table.
+template< typename TT >
+dfloat TableSum( TT const* table, IntegerArray const& strides, UnsignedArray const& lower, UnsignedArray const& upper ) {
+   dip::uint nDims = strides.size();
+   TT sum = 0;
+   for( dip::uint corner = 0; corner < ( dip::uint( 1 ) << nDims ); ++corner ) {
+      dip::sint offset = 0;
+      bool negative = false;
+      for( dip::uint ii = 0; ii < nDims; ++ii ) {
+         if( corner & ( dip::uint( 1 ) << ii )) {
+            offset += static_cast< dip::sint >( upper[ ii ] ) * strides[ ii ];
+         } else {
+            offset += static_cast< dip::sint >( lower[ ii ] ) * strides[ ii ];
+            negative = !negative;
+         }
+      }
+      if( negative ) {
+         sum -= table[ offset ];
+      } else {
+         sum += table[ offset ];
+      }
+   }
+   return static_cast< dfloat >( sum );
+}
+
+// Clips the box with corner `origin` and sizes `boxSizes` to the image domain, yielding table coordinates.
+dip::uint ClipBox(
+      IntegerArray const& origin,
+      UnsignedArray const& boxSizes,
+      UnsignedArray const& sizes,
+      UnsignedArray& lower,
+      UnsignedArray& upper
+) {
+   dip::uint nDims = sizes.size();
+   DIP_THROW_IF( origin.size() != nDims, E::ARRAY_ILLEGAL_SIZE );
+   DIP_THROW_IF( boxSizes.size() != nDims, E::ARRAY_ILLEGAL_SIZE );
+   lower.resize( nDims );
+   upper.resize( nDims );
+   dip::uint count = 1;
+   for( dip::uint ii = 0; ii < nDims; ++ii ) {
+      dip::sint size = static_cast< dip::sint >( sizes[ ii ] );
+      lower[ ii ] = static_cast< dip::uint >( clamp( origin[ ii ], dip::sint( 0 ), size ));
+      upper[ ii ] = static_cast< dip::uint >( clamp( origin[ ii ] + static_cast< dip::sint >( boxSizes[ ii ] ), dip::sint( 0 ), size ));
+      count *= upper[ ii ] - lower[ ii ];
+   }
+   return count;
+}
+
+// Computes the box statistic for each pixel of `out`, processing image lines along dimension 0. The corners
+// along the other dimensions are computed once per line.
+template< typename TT, typename F >
+void BoxFilterLoop(
+      Image& out,
+      UnsignedArray const& sizes,
+      IntegerArray const& strides,
+      TT const* sums,
+      TT const* squares,
+      UnsignedArray const& boxSizes,
+      IntegerArray const& boxOrigin,
+      F const& statistic
+) {
+   dip::uint nDims = sizes.size();
+   dip::uint nCorners = dip::uint( 1 ) << ( nDims - 1 );
+   std::vector< dip::sint > cornerOffsets( nCorners );
+   std::vector< bool > cornerNegative( nCorners );
+   dip::sint length = static_cast< dip::sint >( sizes[ 0 ] );
+   std::vector< dip::uint > lower0( sizes[ 0 ] );
+   std::vector< dip::uint > upper0( sizes[ 0 ] );
+   for( dip::sint ii = 0; ii < length; ++ii ) {
+      lower0[ static_cast< dip::uint >( ii ) ] = static_cast< dip::uint >( clamp( ii + boxOrigin[ 0 ], dip::sint( 0 ), length ));
+      upper0[ static_cast< dip::uint >( ii ) ] = static_cast< dip::uint >( clamp( ii + boxOrigin[ 0 ] + static_cast< dip::sint >( boxSizes[ 0 ] ), dip::sint( 0 ), length ));
+   }
+   UnsignedArray lower( nDims );
+   UnsignedArray upper( nDims );
+   ImageIterator< dfloat > it( out, 0 );
+   do {
+      UnsignedArray const& coords = it.Coordinates();
+      dip::uint count = 1;
+      for( dip::uint ii = 1; ii < nDims; ++ii ) {
+         dip::sint size = static_cast< dip::sint >( sizes[ ii ] );
+         dip::sint pos = static_cast< dip::sint >( coords[ ii ] ) + boxOrigin[ ii ];
+         lower[ ii ] = static_cast< dip::uint >( clamp( pos, dip::sint( 0 ), size ));
+         upper[ ii ] = static_cast< dip::uint >( clamp( pos + static_cast< dip::sint >( boxSizes[ ii ] ), dip::sint( 0 ), size ));
+         count *= upper[ ii ] - lower[ ii ];
+      }
+      for( dip::uint corner = 0; corner < nCorners; ++corner ) {
+         dip::sint offset = 0;
+         bool negative = false;
+         for( dip::uint ii = 1; ii < nDims; ++ii ) {
+            if( corner & ( dip::uint( 1 ) << ( ii - 1 ))) {
+               offset += static_cast< dip::sint >( upper[ ii ] ) * strides[ ii ];
+            } else {
+               offset += static_cast< dip::sint >( lower[ ii ] ) * strides[ ii ];
+               negative = !negative;
+            }
+         }
+         cornerOffsets[ corner ] = offset;
+         cornerNegative[ corner ] = negative;
+      }
+      auto lit = it.GetLineIterator();
+      dip::uint ii = 0;
+      do {
+         dip::uint lo = lower0[ ii ];
+         dip::uint hi = upper0[ ii ];
+         dip::uint n = count * ( hi - lo );
+         TT sum = 0;
+         TT sumSq = 0;
+         for( dip::uint corner = 0; corner < nCorners; ++corner ) {
+            TT const* ptr = sums + cornerOffsets[ corner ];
+            TT v = ptr[ hi ] - ptr[ lo ];
+            sum += cornerNegative[ corner ] ? -v : v;
+            if( squares ) {
+               ptr = squares + cornerOffsets[ corner ];
+               v = ptr[ hi ] - ptr[ lo ];
+               sumSq += cornerNegative[ corner ] ? -v : v;
+            }
+         }
+         *lit = statistic( static_cast< dfloat >( sum ), static_cast< dfloat >( sumSq ), n );
+         ++ii;
+      } while( ++lit );
+   } while( ++it );
+}
+
+} // namespace
+
+void IntegralImage::Compute( Image const& in, bool withSquares ) {
+   DIP_THROW_IF( !in.IsForged(), E::IMAGE_NOT_FORGED );
+   DIP_THROW_IF( !in.IsScalar(), E::IMAGE_NOT_SCALAR );
+   DIP_THROW_IF( !in.DataType().IsReal(), E::DATA_TYPE_NOT_SUPPORTED );
+   DIP_THROW_IF( in.Dimensionality() < 1, E::DIMENSIONALITY_NOT_SUPPORTED );
+   sizes_ = in.Sizes();
+   dip::uint nDims = sizes_.size();
+   UnsignedArray tableSizes = sizes_;
+   strides_.resize( nDims );
+   dip::uint nElements = 1;
+   for( dip::uint ii = 0; ii < nDims; ++ii ) {
+      ++tableSizes[ ii ];
+      strides_[ ii ] = static_cast< dip::sint >( nElements );
+      nElements *= tableSizes[ ii ];
+   }
+   withSquares_ = withSquares;
+   DataType dt = in.DataType();
+   exact_ = dt.IsBinary() || ( dt.IsInteger() && ( dt.SizeOf() <= 2 ));
+   if( withSquares_ && ( in.NumberOfPixels() > ( dip::uint( 1 ) << 31 ))) {
+      // The squares of 16-bit values are below 2^32, their sum over more than 2^31 pixels could overflow 64 bits
+      exact_ = false;
+   }
+   Image tmp = in.QuickCopy();
+   if( exact_ ) {
+      tmp.Convert( DT_SINT32 );
+      intSums_.assign( nElements, 0 );
+      FillTable< std::int64_t, sint32 >( tmp, strides_, 0, false, intSums_ );
+      CumulateTable( tableSizes, intSums_ );
+      if( withSquares_ ) {
+         intSquares_.assign( nElements, 0 );
+         FillTable< std::int64_t, sint32 >( tmp, strides_, 0, true, intSquares_ );
+         CumulateTable( tableSizes, intSquares_ );
+      }
+   } else {
+      tmp.Convert( DT_DFLOAT );
+      shift_ = 0.0;
+      if( withSquares_ ) {
+         // Subtracting the mean avoids catastrophic cancellation in the variance computation
+         VarianceAccumulator acc;
+         ImageIterator< dfloat const > it( tmp );
+         do {
+            acc.Push( *it );
+         } while( ++it );
+         shift_ = acc.Mean();
+      }
+      sums_.assign( nElements, 0.0 );
+      FillTable< dfloat, dfloat >( tmp, strides_, shift_, false, sums_ );
+      CumulateTable( tableSizes, sums_ );
+      if( withSquares_ ) {
+         squares_.assign( nElements, 0.0 );
+         FillTable< dfloat, dfloat >( tmp, strides_, shift_, true, squares_ );
+         CumulateTable( tableSizes, squares_ );
+      }
+   }
+}
+
+dfloat IntegralImage::Sum( IntegerArray const& origin, UnsignedArray const& boxSizes ) const {
+   UnsignedArray lower;
+   UnsignedArray upper;
+   dip::uint count;
+   DIP_STACK_TRACE_THIS( count = ClipBox( origin, boxSizes, sizes_, lower, upper ));
+   if( count == 0 ) {
+      return 0.0;
+   }
+   if( exact_ ) {
+      return TableSum( intSums_.data(), strides_, lower, upper );
+   }
+   return TableSum( sums_.data(), strides_, lower, upper ) + static_cast< dfloat >( count ) * shift_;
+}
+
+dfloat IntegralImage::SumOfSquares( IntegerArray const& origin, UnsignedArray const& boxSizes ) const {
+   DIP_THROW_IF( !withSquares_, "Integral image was computed without squares" );
+   UnsignedArray lower;
+   UnsignedArray upper;
+   dip::uint count;
+   DIP_STACK_TRACE_THIS( count = ClipBox( origin, boxSizes, sizes_, lower, upper ));
+   if( count == 0 ) {
+      return 0.0;
+   }
+   if( exact_ ) {
+      return TableSum( intSquares_.data(), strides_, lower, upper );
+   }
+   // sum((x-s)^2) = sum(x^2) - 2 s sum(x) + n s^2  =>  sum(x^2) = sum((x-s)^2) + 2 s sum(x-s) + n s^2
+   dfloat sum = TableSum( sums_.data(), strides_, lower, upper );
+   dfloat sumSq = TableSum( squares_.data(), strides_, lower, upper );
+   return sumSq + 2.0 * shift_ * sum + static_cast< dfloat >( count ) * shift_ * shift_;
+}
+
+void IntegralImage::BoxSum( Image& out, UnsignedArray boxSizes, IntegerArray boxOrigin ) const {
+   DIP_STACK_TRACE_THIS( BoxFilter( out, boxSizes, boxOrigin, BoxStatistic::SUM ));
+}
+
+void IntegralImage::BoxMean( Image& out, UnsignedArray boxSizes, IntegerArray boxOrigin ) const {
+   DIP_STACK_TRACE_THIS( BoxFilter( out, boxSizes, boxOrigin, BoxStatistic::MEAN ));
+}
+
+void IntegralImage::BoxVariance( Image& out, UnsignedArray boxSizes, IntegerArray boxOrigin ) const {
+   DIP_THROW_IF( !withSquares_, "Integral image was computed without squares" );
+   DIP_STACK_TRACE_THIS( BoxFilter( out, boxSizes, boxOrigin, BoxStatistic::VARIANCE ));
+}
+
+void IntegralImage::BoxFilter( Image& out, UnsignedArray& boxSizes, IntegerArray& boxOrigin, BoxStatistic statistic ) const {
+   dip::uint nDims = sizes_.size();
+   ArrayUseParameter( boxSizes, nDims, dip::uint( 1 ));
+   if( boxOrigin.empty() ) {
+      boxOrigin.resize( nDims );
+      for( dip::uint ii = 0; ii < nDims; ++ii ) {
+         boxOrigin[ ii ] = -static_cast< dip::sint >( boxSizes[ ii ] ) / 2;
+      }
+   } else {
+      ArrayUseParameter( boxOrigin, nDims, dip::sint( 0 ));
+   }
+   out.ReForge( sizes_, 1, DT_DFLOAT );
+   dfloat shift = shift_;
+   // The statistic is computed from the sum of (x-shift) and the sum of (x-shift)^2 over n pixels.
+   switch( statistic ) {
+      case BoxStatistic::SUM: {
+         auto op = [ shift ]( dfloat sum, dfloat, dip::uint n ) {
+            return sum + static_cast< dfloat >( n ) * shift;
+         };
+         if( exact_ ) {
+            BoxFilterLoop( out, sizes_, strides_, intSums_.data(), static_cast< std::int64_t const* >( nullptr ), boxSizes, boxOrigin, op );
+         } else {
+            BoxFilterLoop( out, sizes_, strides_, sums_.data(), static_cast< dfloat const* >( nullptr ), boxSizes, boxOrigin, op );
+         }
+         break;
+      }
+      case BoxStatistic::MEAN: {
+         auto op = [ shift ]( dfloat sum, dfloat, dip::uint n ) {
+            return n > 0 ? sum / static_cast< dfloat >( n ) + shift : 0.0;
+         };
+         if( exact_ ) {
+            BoxFilterLoop( out, sizes_, strides_, intSums_.data(), static_cast< std::int64_t const* >( nullptr ), boxSizes, boxOrigin, op );
+         } else {
+            BoxFilterLoop( out, sizes_, strides_, sums_.data(), static_cast< dfloat const* >( nullptr ), boxSizes, boxOrigin, op );
+         }
+         break;
+      }
+      case BoxStatistic::VARIANCE: {
+         // Variance is invariant to the shift
+         auto op = []( dfloat sum, dfloat sumSq, dip::uint n ) {
+            if( n < 2 ) {
+               return 0.0;
+            }
+            dfloat m2 = sumSq - sum * sum / static_cast< dfloat >( n );
+            return m2 > 0.0 ? m2 / static_cast< dfloat >( n - 1 ) : 0.0;
+         };
+         if( exact_ ) {
+            BoxFilterLoop( out, sizes_, strides_, intSums_.data(), intSquares_.data(), boxSizes, boxOrigin, op );
+         } else {
+            BoxFilterLoop( out, sizes_, strides_, sums_.data(), squares_.data(), boxSizes, boxOrigin, op );
+         }
+         break;
+      }
+   }
+}
+
+} // namespace dip
+
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+#include "diplib/generation.h"
+#include "diplib/random.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the IntegralImage class") {
+   dip::Image img{ dip::UnsignedArray{ 23, 17, 5 }, 1, dip::DT_UINT16 };
+   img.Fill( 1000 );
+   dip::Random random( 0 );
+   dip::UniformNoise( img, img, random, 0.0, 2000.0 );
+   dip::IntegralImage exact( img, true );
+   DOCTEST_CHECK( exact.IsExact() );
+   dip::Image fimg = dip::Convert( img, dip::DT_DFLOAT );
+   dip::IntegralImage approx( fimg, true );
+   DOCTEST_CHECK( !approx.IsExact() );
+
+   // Compare a box sum against a direct sum
+   dip::IntegerArray origin{ 3, -2, 1 };
+   dip::UnsignedArray boxSizes{ 7, 9, 3 };
+   dip::VarianceAccumulator acc;
+   dip::ImageIterator< dip::uint16 > it( img );
+   do {
+      auto const& coords = it.Coordinates();
+      bool inside = true;
+      for( dip::uint ii = 0; ii < 3; ++ii ) {
+         dip::sint c = static_cast< dip::sint >( coords[ ii ] );
+         if(( c < origin[ ii ] ) || ( c >= origin[ ii ] + static_cast< dip::sint >( boxSizes[ ii ] ))) {
+            inside = false;
+         }
+      }
+      if( inside ) {
+         acc.Push( *it );
+      }
+   } while( ++it );
+   dip::dfloat n = static_cast< dip::dfloat >( acc.Number() );
+   DOCTEST_CHECK( acc.Number() == 7 * 7 * 3 ); // clipped along dimension 1
+   DOCTEST_CHECK( exact.Sum( origin, boxSizes ) == doctest::Approx( acc.Mean() * n ));
+   DOCTEST_CHECK( approx.Sum( origin, boxSizes ) == doctest::Approx( acc.Mean() * n ));
+   dip::dfloat sumSq = acc.Variance() * ( n - 1 ) + acc.Mean() * acc.Mean() * n;
+   DOCTEST_CHECK( exact.SumOfSquares( origin, boxSizes ) == doctest::Approx( sumSq ));
+   DOCTEST_CHECK( approx.SumOfSquares( origin, boxSizes ) == doctest::Approx( sumSq ));
+
+   // Box statistics at a pixel equal those of the clipped box
+   dip::Image mean;
+   exact.BoxMean( mean, boxSizes );
+   dip::Image var;
+   approx.BoxVariance( var, boxSizes );
+   dip::dfloat expectMean = exact.Sum( { 1 - 3, 0 - 4, 4 - 1 }, boxSizes ) / ( 5.0 * 5.0 * 2.0 );
+   DOCTEST_CHECK( mean.At( 1, 0, 4 ).As< dip::dfloat >() == doctest::Approx( expectMean ));
+   DOCTEST_CHECK( var.At( 1, 0, 4 ).As< dip::dfloat >() >= 0.0 );
+   dip::Image sum;
+   exact.BoxSum( sum, { 1 } );
+   DOCTEST_CHECK( sum.At( 5, 6, 2 ).As< dip::dfloat >() == img.At( 5, 6, 2 ).As< dip::dfloat >() );
+}
+
+#endif // DIP__ENABLE_DOCTEST
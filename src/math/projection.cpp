@@ -18,6 +18,7 @@
  * limitations under the License.
  */
 
+#include <array>
 #include <cmath>
 
 #include "diplib.h"
@@ -257,31 +258,64 @@ void ProjectionScan(
 
 namespace {
 
+// Sums are accumulated in double precision using compensated summation, independently of the output type, such
+// that the sum over a very large image does not lose precision. Complex values use one accumulator per component.
+// `Result( divisor )` returns the sum divided by `divisor`, which is 1 for the sum and the number of samples for the
+// mean. The division is also done in double precision.
+template< typename TPI >
+class CompensatedSum {
+   public:
+      using ValueType = dfloat;
+      void Push( dfloat v ) {
+         acc_.Push( v );
+      }
+      FlexType< TPI > Result( dfloat divisor ) const {
+         return static_cast< FlexType< TPI >>( acc_.Sum() / divisor );
+      }
+   private:
+      KahanAccumulator acc_;
+};
+
+template< typename T >
+class CompensatedSum< std::complex< T >> {
+   public:
+      using ValueType = dcomplex;
+      void Push( dcomplex v ) {
+         real_.Push( v.real() );
+         imag_.Push( v.imag() );
+      }
+      std::complex< T > Result( dfloat divisor ) const {
+         return { static_cast< T >( real_.Sum() / divisor ), static_cast< T >( imag_.Sum() / divisor ) };
+      }
+   private:
+      KahanAccumulator real_;
+      KahanAccumulator imag_;
+};
+
 template< typename TPI >
 class ProjectionMean : public ProjectionScanFunction {
    public:
       ProjectionMean( bool computeMean ) : computeMean_( computeMean ) {}
       virtual void Project( Image const& in, Image const& mask, void* out, dip::uint ) override {
+         using ValueType = typename CompensatedSum< TPI >::ValueType;
          dip::uint n = 0;
-         FlexType< TPI > sum = 0;
+         CompensatedSum< TPI > sum;
          if( mask.IsForged() ) {
             JointImageIterator< TPI, bin > it( { in, mask } );
             do {
                if( it.template Sample< 1 >() ) {
-                  sum += static_cast< FlexType< TPI >>( it.template Sample< 0 >() );
+                  sum.Push( static_cast< ValueType >( it.template Sample< 0 >() ));
                   ++n;
                }
             } while( ++it );
          } else {
             ImageIterator< TPI > it( in );
             do {
-               sum += static_cast< FlexType< TPI >>( *it );
+               sum.Push( static_cast< ValueType >( *it ));
             } while( ++it );
             n = in.NumberOfPixels();
          }
-         *static_cast< FlexType< TPI >* >( out ) = ( computeMean_ && ( n > 0 ))
-                                                   ? ( sum / static_cast< FloatType< TPI >>( n ))
-                                                   : ( sum );
+         *static_cast< FlexType< TPI >* >( out ) = sum.Result(( computeMean_ && ( n > 0 )) ? static_cast< dfloat >( n ) : 1.0 );
       }
    private:
       bool computeMean_ = true;
@@ -385,26 +419,26 @@ class ProjectionMeanAbs : public ProjectionScanFunction {
    public:
       ProjectionMeanAbs( bool computeMean ) : computeMean_( computeMean ) {}
       virtual void Project( Image const& in, Image const& mask, void* out, dip::uint ) override {
+         using ValueType = typename CompensatedSum< TPI >::ValueType;
          dip::uint n = 0;
-         FloatType< TPI > sum = 0;
+         KahanAccumulator sum;
          if( mask.IsForged() ) {
             JointImageIterator< TPI, bin > it( { in, mask } );
             do {
                if( it.template Sample< 1 >() ) {
-                  sum += std::abs( static_cast< FlexType< TPI >>( it.template Sample< 0 >() ));
+                  sum.Push( std::abs( static_cast< ValueType >( it.template Sample< 0 >() )));
                   ++n;
                }
             } while( ++it );
          } else {
             ImageIterator< TPI > it( in );
             do {
-               sum += std::abs( static_cast< FlexType< TPI >>( *it ));
+               sum.Push( std::abs( static_cast< ValueType >( *it )));
             } while( ++it );
             n = in.NumberOfPixels();
          }
-         *static_cast< FloatType< TPI >* >( out ) = ( computeMean_ && ( n > 0 ))
-                                                    ? ( sum / static_cast< FloatType< TPI >>( n ))
-                                                    : ( sum );
+         dfloat divisor = ( computeMean_ && ( n > 0 )) ? static_cast< dfloat >( n ) : 1.0;
+         *static_cast< FloatType< TPI >* >( out ) = static_cast< FloatType< TPI >>( sum.Sum() / divisor );
       }
    private:
       bool computeMean_ = true;
@@ -449,28 +483,27 @@ class ProjectionMeanSquare : public ProjectionScanFunction {
    public:
       ProjectionMeanSquare( bool computeMean ) : computeMean_( computeMean ) {}
       virtual void Project( Image const& in, Image const& mask, void* out, dip::uint ) override {
+         using ValueType = typename CompensatedSum< TPI >::ValueType;
          dip::uint n = 0;
-         FlexType< TPI > sum = 0;
+         CompensatedSum< TPI > sum;
          if( mask.IsForged() ) {
             JointImageIterator< TPI, bin > it( { in, mask } );
             do {
                if( it.template Sample< 1 >() ) {
-                  FlexType< TPI > v = static_cast< FlexType< TPI >>( it.template Sample< 0 >() );
-                  sum += v * v;
+                  ValueType v = static_cast< ValueType >( it.template Sample< 0 >() );
+                  sum.Push( v * v );
                   ++n;
                }
             } while( ++it );
          } else {
             ImageIterator< TPI > it( in );
             do {
-               FlexType< TPI > v = static_cast< FlexType< TPI >>( *it );
-               sum += v * v;
+               ValueType v = static_cast< ValueType >( *it );
+               sum.Push( v * v );
             } while( ++it );
             n = in.NumberOfPixels();
          }
-         *static_cast< FlexType< TPI >* >( out ) = ( computeMean_ && ( n > 0 ))
-                                                   ? ( sum / static_cast< FloatType< TPI >>( n ))
-                                                   : ( sum );
+         *static_cast< FlexType< TPI >* >( out ) = sum.Result(( computeMean_ && ( n > 0 )) ? static_cast< dfloat >( n ) : 1.0 );
       }
    private:
       bool computeMean_ = true;
@@ -857,7 +890,79 @@ class ProjectionPercentile : public ProjectionScanFunction {
       dfloat percentile_;
 };
 
-}
+// For 8-bit and 16-bit integer images, the percentile is found by counting instead of copying and partitioning:
+// one pass through the data counts the values of the most significant byte, and a scan of the cumulative
+// counts gives the byte of the value with the requested rank. For 16-bit images, a second pass counts the
+// least significant byte among the values that share that most significant byte. No copy of the data is made.
+template< typename TPI >
+class ProjectionPercentileCounting : public ProjectionScanFunction {
+      static_assert( sizeof( TPI ) <= 2, "ProjectionPercentileCounting is for 8-bit and 16-bit integer images only" );
+   public:
+      ProjectionPercentileCounting( dfloat percentile ) : percentile_( percentile ) {}
+      virtual void Project( Image const& in, Image const& mask, void* out, dip::uint ) override {
+         constexpr dip::uint shift = ( sizeof( TPI ) - 1 ) * 8; // shift to get the most significant byte
+         std::array< dip::uint, 256 > counts;
+         counts.fill( 0 );
+         ForEachSample( in, mask, [ & ]( dip::uint key ) { ++counts[ key >> shift ]; } );
+         dip::uint N = 0;
+         for( auto c : counts ) {
+            N += c;
+         }
+         if( N == 0 ) {
+            *static_cast< TPI* >( out ) = TPI{};
+            return;
+         }
+         dip::uint rank = static_cast< dip::uint >( std::floor( static_cast< dfloat >( N ) * percentile_ / 100.0 )); // rank < N, because percentile_ < 100
+         dip::uint key = FindRank( counts, rank ) << shift; // `rank` is updated to be the rank within the bucket found
+         if( shift > 0 ) {
+            counts.fill( 0 );
+            dip::uint high = key;
+            ForEachSample( in, mask, [ & ]( dip::uint k ) {
+               if(( k & 0xFF00u ) == high ) {
+                  ++counts[ k & 0xFFu ];
+               }
+            } );
+            key |= FindRank( counts, rank );
+         }
+         *static_cast< TPI* >( out ) = static_cast< TPI >( static_cast< dip::sint >( key ) + offset_ );
+      }
+   private:
+      dfloat percentile_;
+      static constexpr dip::sint offset_ = static_cast< dip::sint >( std::numeric_limits< TPI >::lowest() );
+
+      // Calls `function` with the key (the sample value shifted to be non-negative) for each sample selected by `mask`.
+      template< typename F >
+      static void ForEachSample( Image const& in, Image const& mask, F function ) {
+         if( mask.IsForged() ) {
+            JointImageIterator< TPI, bin > it( { in, mask } );
+            do {
+               if( it.template Sample< 1 >() ) {
+                  function( static_cast< dip::uint >( static_cast< dip::sint >( it.template Sample< 0 >() ) - offset_ ));
+               }
+            } while( ++it );
+         } else {
+            ImageIterator< TPI > it( in );
+            do {
+               function( static_cast< dip::uint >( static_cast< dip::sint >( *it ) - offset_ ));
+            } while( ++it );
+         }
+      }
+
+      // Finds the bin containing the sample with rank `rank`, and updates `rank` to be the rank within that bin.
+      static dip::uint FindRank( std::array< dip::uint, 256 > const& counts, dip::uint& rank ) {
+         dip::uint bin = 0;
+         while( rank >= counts[ bin ] ) {
+            rank -= counts[ bin ];
+            ++bin;
+         }
+         return bin;
+      }
+};
+
+template< typename TPI >
+constexpr dip::sint ProjectionPercentileCounting< TPI >::offset_;
+
+} // namespace
 
 void Percentile(
       Image const& in,
@@ -873,7 +978,23 @@ void Percentile(
       Maximum( in, mask, out, process );
    } else {
       std::unique_ptr< ProjectionScanFunction > lineFilter;
-      DIP_OVL_NEW_NONCOMPLEX( lineFilter, ProjectionPercentile, ( percentile ), in.DataType() );
+      switch( in.DataType() ) {
+         case dip::DT_UINT8:
+            lineFilter.reset( new ProjectionPercentileCounting< uint8 >( percentile ));
+            break;
+         case dip::DT_SINT8:
+            lineFilter.reset( new ProjectionPercentileCounting< sint8 >( percentile ));
+            break;
+         case dip::DT_UINT16:
+            lineFilter.reset( new ProjectionPercentileCounting< uint16 >( percentile ));
+            break;
+         case dip::DT_SINT16:
+            lineFilter.reset( new ProjectionPercentileCounting< sint16 >( percentile ));
+            break;
+         default:
+            DIP_OVL_NEW_NONCOMPLEX( lineFilter, ProjectionPercentile, ( percentile ), in.DataType() );
+            break;
+      }
       ProjectionScan( in, mask, out, in.DataType(), process, *lineFilter );
    }
 }
@@ -965,6 +1086,8 @@ void Any(
 
 
 #ifdef DIP__ENABLE_DOCTEST
+#include "diplib/random.h"
+#include "diplib/generation.h"
 
 DOCTEST_TEST_CASE("[DIPlib] testing the projection functions") {
    // We mostly test that the ProjectionScan framework works appropriately.
@@ -1025,4 +1148,37 @@ DOCTEST_TEST_CASE("[DIPlib] testing the projection functions") {
          std::atan2( std::sin( 1 ), std::cos( 1 ) + ( 3 * 4 * 2 - 1 ))));
 }
 
+DOCTEST_TEST_CASE("[DIPlib] testing the precision of the sum projections") {
+   // One large value followed by many ones: adding 1 to 1e8 in single precision does nothing
+   dip::Image img{ dip::UnsignedArray{ 100001 }, 1, dip::DT_SFLOAT };
+   img.Fill( 1 );
+   img.At( 0 ) = 1e8;
+   DOCTEST_CHECK( dip::Sum( img ).As< dip::dfloat >() == 1e8 + 1e5 );
+   DOCTEST_CHECK( dip::SumAbs( img ).As< dip::dfloat >() == 1e8 + 1e5 );
+   DOCTEST_CHECK( dip::Mean( img ).As< dip::dfloat >() == doctest::Approx(( 1e8 + 1e5 ) / 100001.0 ));
+   img.At( 0 ) = 1e4;
+   DOCTEST_CHECK( dip::SumSquare( img ).As< dip::dfloat >() == 1e8 + 1e5 );
+}
+
+DOCTEST_TEST_CASE("[DIPlib] testing the counting percentile projection") {
+   // 8-bit and 16-bit images use a counting algorithm, compare to the result of partitioning 32-bit data
+   dip::Random random( 0 );
+   dip::Image img{ dip::UnsignedArray{ 20, 15, 30 }, 1, dip::DT_SFLOAT };
+   img.Fill( 0 );
+   dip::UniformNoise( img, img, random, -2000, 2000 );
+   dip::Image mask = img > -500;
+   dip::BooleanArray ps{ false, false, true };
+   for( dip::DataType dt : { dip::DT_UINT8, dip::DT_SINT8, dip::DT_UINT16, dip::DT_SINT16 } ) {
+      dip::Image tmp = dip::Convert( img, dt );
+      dip::Image ref = dip::Convert( tmp, dip::DT_SINT32 );
+      for( dip::dfloat percentile : { 10.0, 50.0, 99.0 } ) {
+         DOCTEST_CHECK( dip::Percentile( tmp, {}, percentile ).As< dip::sint >() == dip::Percentile( ref, {}, percentile ).As< dip::sint >() );
+         DOCTEST_CHECK( dip::Percentile( tmp, mask, percentile ).As< dip::sint >() == dip::Percentile( ref, mask, percentile ).As< dip::sint >() );
+         dip::Image out = dip::Percentile( tmp, mask, percentile, ps );
+         DOCTEST_CHECK( out.DataType() == dt );
+         DOCTEST_CHECK( dip::Count( dip::Convert( out, dip::DT_SINT32 ) != dip::Percentile( ref, mask, percentile, ps )) == 0 );
+      }
+   }
+}
+
 #endif // DIP__ENABLE_DOCTEST
@@ -18,16 +18,99 @@
  * limitations under the License.
  */
 
+#include <exception>
+
 #include "diplib.h"
 #include "diplib/statistics.h"
 #include "diplib/math.h"
 #include "diplib/framework.h"
 #include "diplib/overload.h"
+#include "diplib/multithreading.h"
 
 namespace dip {
 
 namespace {
 
+// Global reductions over large images are computed by splitting the image into slabs along the dimension with the
+// largest stride, computing a partial result for each slab in parallel, and merging the partial results pairwise,
+// in a fixed order. The slabs depend only on the image sizes, not on the number of threads, so that the result is
+// the same no matter how many threads are used. Pairwise merging also keeps rounding errors small.
+constexpr dip::uint reductionSlabPixels = 65536; // slabs have at least this many pixels
+constexpr dip::uint maxReductionSlabs = 256;
+
+// `newFilter( origin )` returns a `std::unique_ptr` to a scan line filter with a `GetResult` method that returns
+// a `Result`. `origin` is the position of the first pixel of the slab within `in`, for filters that use
+// `Framework::Scan_NeedCoordinates`. `Result` must have an `operator+=`.
+template< typename Result, typename NewFilter >
+Result ParallelReduction(
+      Image const& in,
+      Image const& c_mask,
+      DataType bufferType,
+      NewFilter const& newFilter,
+      Framework::ScanOptions opts = {}
+) {
+   dip::uint nDims = in.Dimensionality();
+   dip::uint splitDim = 0;
+   for( dip::uint ii = 1; ii < nDims; ++ii ) {
+      if( std::abs( in.Stride( ii )) > std::abs( in.Stride( splitDim ))) {
+         splitDim = ii;
+      }
+   }
+   dip::uint nSlabs = nDims > 0 ? std::min( std::min( in.NumberOfPixels() / reductionSlabPixels, maxReductionSlabs ),
+                                            in.Size( splitDim )) : 1;
+   if( nSlabs <= 1 ) {
+      auto filter = newFilter( UnsignedArray( nDims, 0 ));
+      Framework::ScanSingleInput( in, c_mask, bufferType, *filter, opts );
+      return filter->GetResult();
+   }
+   Image mask;
+   if( c_mask.IsForged() ) {
+      mask = c_mask.QuickCopy();
+      DIP_START_STACK_TRACE
+         mask.CheckIsMask( in.Sizes(), Option::AllowSingletonExpansion::DO_ALLOW, Option::ThrowException::DO_THROW );
+         mask.ExpandSingletonDimensions( in.Sizes() );
+      DIP_END_STACK_TRACE
+   }
+   std::vector< decltype( newFilter( UnsignedArray{} )) > filters( nSlabs );
+   std::vector< std::exception_ptr > exceptions( nSlabs );
+   dip::uint nThreads = std::min( GetNumberOfThreads(), nSlabs );
+   #ifdef _OPENMP
+   #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( dynamic, 1 )
+   #endif
+   for( dip::sint tt = 0; tt < static_cast< dip::sint >( nSlabs ); ++tt ) {
+      dip::uint ii = static_cast< dip::uint >( tt );
+      try {
+         dip::uint start = in.Size( splitDim ) * ii / nSlabs;
+         dip::uint stop = in.Size( splitDim ) * ( ii + 1 ) / nSlabs;
+         RangeArray ranges( nDims );
+         ranges[ splitDim ] = Range( static_cast< dip::sint >( start ), static_cast< dip::sint >( stop ) - 1 );
+         UnsignedArray origin( nDims, 0 );
+         origin[ splitDim ] = start;
+         filters[ ii ] = newFilter( origin );
+         Framework::ScanSingleInput( in.At( ranges ), mask.IsForged() ? Image( mask.At( ranges )) : Image(),
+                                     bufferType, *filters[ ii ], opts );
+      } catch( ... ) {
+         exceptions[ ii ] = std::current_exception();
+      }
+   }
+   for( auto const& e : exceptions ) {
+      if( e ) {
+         std::rethrow_exception( e );
+      }
+   }
+   std::vector< Result > results;
+   results.reserve( nSlabs );
+   for( auto const& filter : filters ) {
+      results.push_back( filter->GetResult() );
+   }
+   for( dip::uint step = 1; step < nSlabs; step *= 2 ) {
+      for( dip::uint ii = 0; ii + step < nSlabs; ii += 2 * step ) {
+         results[ ii ] += results[ ii + step ];
+      }
+   }
+   return results[ 0 ];
+}
+
 class dip__Count : public Framework::ScanLineFilter {
    public:
       virtual void Filter( Framework::ScanLineFilterParameters const& params ) override {
@@ -78,9 +161,9 @@ dip::uint Count(
 ) {
    DIP_THROW_IF( !in.IsForged(), E::IMAGE_NOT_FORGED );
    DIP_THROW_IF( !in.IsScalar(), E::IMAGE_NOT_SCALAR );
-   dip__Count scanLineFilter;
-   Framework::ScanSingleInput( in, mask, DT_BIN, scanLineFilter );
-   return scanLineFilter.GetResult();
+   return ParallelReduction< dip::uint >( in, mask, DT_BIN, []( UnsignedArray const& ) {
+      return std::unique_ptr< dip__Count >( new dip__Count );
+   } );
 }
 
 namespace {
@@ -388,10 +471,11 @@ MinMaxAccumulator MaximumAndMinimum(
       c_in.SplitComplex();
       // Note that mask will be singleton-expanded, which allows adding dimensions at the end.
    }
-   std::unique_ptr< dip__MaximumAndMinimumBase >scanLineFilter;
-   DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__MaximumAndMinimum, (), c_in.DataType() );
-   Framework::ScanSingleInput( c_in, mask, c_in.DataType(), *scanLineFilter, Framework::Scan_TensorAsSpatialDim );
-   return scanLineFilter->GetResult();
+   return ParallelReduction< MinMaxAccumulator >( c_in, mask, c_in.DataType(), [ & ]( UnsignedArray const& ) {
+      std::unique_ptr< dip__MaximumAndMinimumBase > scanLineFilter;
+      DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__MaximumAndMinimum, (), c_in.DataType() );
+      return scanLineFilter;
+   }, Framework::Scan_TensorAsSpatialDim );
 }
 
 namespace {
@@ -449,8 +533,75 @@ StatisticsAccumulator SampleStatistics(
       Image const& mask
 ) {
    DIP_THROW_IF( !in.IsForged(), E::IMAGE_NOT_FORGED );
-   std::unique_ptr< dip__SampleStatisticsBase >scanLineFilter;
-   DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__SampleStatistics, (), in.DataType() );
+   return ParallelReduction< StatisticsAccumulator >( in, mask, in.DataType(), [ & ]( UnsignedArray const& ) {
+      std::unique_ptr< dip__SampleStatisticsBase > scanLineFilter;
+      DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__SampleStatistics, (), in.DataType() );
+      return scanLineFilter;
+   }, Framework::Scan_TensorAsSpatialDim );
+}
+
+namespace {
+
+class dip__SampleQuantilesBase : public Framework::ScanLineFilter {
+   public:
+      virtual QuantileAccumulator GetResult() = 0;
+};
+
+template< typename TPI >
+class dip__SampleQuantiles : public dip__SampleQuantilesBase {
+   public:
+      dip__SampleQuantiles( dip::uint k ) : k_( k ) {}
+      virtual void Filter( Framework::ScanLineFilterParameters const& params ) override {
+         TPI const* in = static_cast< TPI const* >( params.inBuffer[ 0 ].buffer );
+         QuantileAccumulator& vars = accArray_[ params.thread ];
+         auto bufferLength = params.bufferLength;
+         auto inStride = params.inBuffer[ 0 ].stride;
+         if( params.inBuffer.size() > 1 ) {
+            // If there's two input buffers, we have a mask image.
+            auto maskStride = params.inBuffer[ 1 ].stride;
+            bin const* mask = static_cast< bin const* >( params.inBuffer[ 1 ].buffer );
+            for( dip::uint ii = 0; ii < bufferLength; ++ii ) {
+               if( *mask && std::isfinite( static_cast< dfloat >( *in ))) {
+                  vars.Push( static_cast< dfloat >( *in ));
+               }
+               in += inStride;
+               mask += maskStride;
+            }
+         } else {
+            // Otherwise we don't.
+            for( dip::uint ii = 0; ii < bufferLength; ++ii ) {
+               if( std::isfinite( static_cast< dfloat >( *in ))) {
+                  vars.Push( static_cast< dfloat >( *in ));
+               }
+               in += inStride;
+            }
+         }
+      }
+      virtual void SetNumberOfThreads( dip::uint threads ) override {
+         accArray_.resize( threads, QuantileAccumulator( k_ ));
+      }
+      virtual QuantileAccumulator GetResult() override {
+         QuantileAccumulator out = accArray_[ 0 ];
+         for( dip::uint ii = 1; ii < accArray_.size(); ++ii ) {
+            out += accArray_[ ii ];
+         }
+         return out;
+      }
+   private:
+      dip::uint k_;
+      std::vector< QuantileAccumulator > accArray_;
+};
+
+} // namespace
+
+QuantileAccumulator SampleQuantiles(
+      Image const& in,
+      Image const& mask,
+      dip::uint k
+) {
+   DIP_THROW_IF( !in.IsForged(), E::IMAGE_NOT_FORGED );
+   std::unique_ptr< dip__SampleQuantilesBase >scanLineFilter;
+   DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__SampleQuantiles, ( k ), in.DataType() );
    Framework::ScanSingleInput( in, mask, in.DataType(), *scanLineFilter, Framework::Scan_TensorAsSpatialDim );
    return scanLineFilter->GetResult();
 }
@@ -471,6 +622,7 @@ class dip__CenterOfMass : public dip__CenterOfMassBase {
          auto bufferLength = params.bufferLength;
          auto inStride = params.inBuffer[ 0 ].stride;
          UnsignedArray pos = params.position;
+         pos += origin_;
          dip::uint procDim = params.dimension;
          if( params.inBuffer.size() > 1 ) {
             // If there's two input buffers, we have a mask image.
@@ -499,33 +651,25 @@ class dip__CenterOfMass : public dip__CenterOfMassBase {
             }
          }
       }
-      dip__CenterOfMass( dip::uint nD ) : nD_( nD ) {}
+      dip__CenterOfMass( dip::uint nD, UnsignedArray const& origin ) : nD_( nD ), origin_( origin ) {}
       virtual void SetNumberOfThreads( dip::uint threads ) override {
          accArray_.resize( threads );
          for( dip::uint ii = 0; ii < threads; ++ii ) {
             accArray_[ ii ].resize( nD_ + 1, 0.0 );
          }
       }
+      // Returns the sums, not normalized, so that results for different slabs can be added together.
       virtual FloatArray GetResult() override {
          FloatArray out = accArray_[ 0 ];
          for( dip::uint ii = 1; ii < accArray_.size(); ++ii ) {
             out += accArray_[ ii ];
          }
-         if( out[ nD_ ] != 0 ) {
-            for( dip::uint jj = 0; jj < nD_; ++jj ) {
-               out[ jj ] /= out[ nD_ ];
-            }
-         } else {
-            for( dip::uint jj = 0; jj < nD_; ++jj ) {
-               out[ jj ] = 0.0;
-            }
-         }
-         out.resize( nD_ );
          return out;
       }
    private:
       std::vector< FloatArray > accArray_; // one per thread, each one contains: sum(I*x),sum(I*y),...,sum(I)
       dip::uint nD_;
+      UnsignedArray origin_; // position of the first pixel of the image processed, within the full image
 };
 
 } // namespace
@@ -536,10 +680,23 @@ FloatArray CenterOfMass(
 ) {
    DIP_THROW_IF( !in.IsForged(), E::IMAGE_NOT_FORGED );
    DIP_THROW_IF( !in.IsScalar(), E::IMAGE_NOT_SCALAR );
-   std::unique_ptr< dip__CenterOfMassBase >scanLineFilter;
-   DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__CenterOfMass, ( in.Dimensionality() ), in.DataType() );
-   Framework::ScanSingleInput( in, mask, in.DataType(), *scanLineFilter, Framework::Scan_NeedCoordinates );
-   return scanLineFilter->GetResult();
+   dip::uint nD = in.Dimensionality();
+   FloatArray out = ParallelReduction< FloatArray >( in, mask, in.DataType(), [ & ]( UnsignedArray const& origin ) {
+      std::unique_ptr< dip__CenterOfMassBase > scanLineFilter;
+      DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__CenterOfMass, ( nD, origin ), in.DataType() );
+      return scanLineFilter;
+   }, Framework::Scan_NeedCoordinates );
+   if( out[ nD ] != 0 ) {
+      for( dip::uint jj = 0; jj < nD; ++jj ) {
+         out[ jj ] /= out[ nD ];
+      }
+   } else {
+      for( dip::uint jj = 0; jj < nD; ++jj ) {
+         out[ jj ] = 0.0;
+      }
+   }
+   out.resize( nD );
+   return out;
 }
 
 namespace {
@@ -558,6 +715,7 @@ class dip__Moments : public dip__MomentsBase {
          auto bufferLength = params.bufferLength;
          auto inStride = params.inBuffer[ 0 ].stride;
          FloatArray pos{ params.position };
+         pos += FloatArray{ origin_ };
          dip::uint procDim = params.dimension;
          if( params.inBuffer.size() > 1 ) {
             // If there's two input buffers, we have a mask image.
@@ -580,7 +738,7 @@ class dip__Moments : public dip__MomentsBase {
             }
          }
       }
-      dip__Moments( dip::uint nD ) : nD_( nD ) {}
+      dip__Moments( dip::uint nD, UnsignedArray const& origin ) : nD_( nD ), origin_( origin ) {}
       virtual void SetNumberOfThreads( dip::uint threads ) override {
          accArray_.resize( threads, MomentAccumulator( nD_ ));
       }
@@ -594,6 +752,7 @@ class dip__Moments : public dip__MomentsBase {
    private:
       std::vector< MomentAccumulator > accArray_;
       dip::uint nD_;
+      UnsignedArray origin_; // position of the first pixel of the image processed, within the full image
 };
 
 } // namespace
@@ -604,10 +763,90 @@ MomentAccumulator Moments(
 ) {
    DIP_THROW_IF( !in.IsForged(), E::IMAGE_NOT_FORGED );
    DIP_THROW_IF( !in.IsScalar(), E::IMAGE_NOT_SCALAR );
-   std::unique_ptr< dip__MomentsBase >scanLineFilter;
-   DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__Moments, ( in.Dimensionality() ), in.DataType() );
-   Framework::ScanSingleInput( in, mask, in.DataType(), *scanLineFilter, Framework::Scan_NeedCoordinates );
-   return scanLineFilter->GetResult();
+   return ParallelReduction< MomentAccumulator >( in, mask, in.DataType(), [ & ]( UnsignedArray const& origin ) {
+      std::unique_ptr< dip__MomentsBase > scanLineFilter;
+      DIP_OVL_NEW_NONCOMPLEX( scanLineFilter, dip__Moments, ( in.Dimensionality(), origin ), in.DataType() );
+      return scanLineFilter;
+   }, Framework::Scan_NeedCoordinates );
 }
 
 } // namespace dip
+
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+#include "diplib/random.h"
+#include "diplib/generation.h"
+#include "diplib/multithreading.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the parallel image statistics") {
+   // Large enough to be split into slabs
+   dip::Random random( 0 );
+   dip::Image img{ dip::UnsignedArray{ 300, 500 }, 1, dip::DT_SFLOAT };
+   img.Fill( 0 );
+   dip::UniformNoise( img, img, random, 0.0, 1000.0 );
+   dip::Image mask = img > 100;
+   dip::uint nThreads = dip::GetNumberOfThreads();
+   dip::SetNumberOfThreads( 1 );
+   dip::StatisticsAccumulator serial = dip::SampleStatistics( img, mask );
+   dip::FloatArray serialCoM = dip::CenterOfMass( img );
+   dip::SetNumberOfThreads( 4 );
+   dip::StatisticsAccumulator parallel = dip::SampleStatistics( img, mask );
+   dip::FloatArray parallelCoM = dip::CenterOfMass( img );
+   dip::SetNumberOfThreads( nThreads );
+   // The result doesn't depend on the number of threads
+   DOCTEST_CHECK( serial.Number() == parallel.Number() );
+   DOCTEST_CHECK( serial.Mean() == parallel.Mean() );
+   DOCTEST_CHECK( serial.Variance() == parallel.Variance() );
+   DOCTEST_CHECK( serialCoM == parallelCoM );
+   DOCTEST_CHECK( serial.Number() == dip::Count( mask ));
+   DOCTEST_CHECK( serial.Mean() == doctest::Approx( dip::Mean( img, mask ).As< dip::dfloat >() ));
+   // Slabs know where they are in the image
+   img.Fill( 0 );
+   img.At( 123, 456 ) = 1;
+   DOCTEST_CHECK( dip::CenterOfMass( img ) == dip::FloatArray{ 123, 456 } );
+   dip::MomentAccumulator moments = dip::Moments( img );
+   DOCTEST_CHECK( moments.Sum() == 1 );
+   DOCTEST_CHECK( moments.FirstOrder() == dip::FloatArray{ 123, 456 } );
+   dip::MinMaxAccumulator minmax = dip::MaximumAndMinimum( img );
+   DOCTEST_CHECK( minmax.Maximum() == 1 );
+   DOCTEST_CHECK( minmax.Minimum() == 0 );
+}
+
+DOCTEST_TEST_CASE("[DIPlib] testing the parallel image statistics with sparse and empty masks") {
+   // Most slabs have no pixels within the mask, their partial results are empty
+   dip::Random random( 0 );
+   dip::Image img{ dip::UnsignedArray{ 1000, 1000 }, 1, dip::DT_SFLOAT };
+   img.Fill( 0 );
+   dip::UniformNoise( img, img, random, 0.0, 1000.0 );
+   dip::Image mask{ img.Sizes(), 1, dip::DT_BIN };
+   mask.Fill( false );
+   mask.At( dip::Range{}, dip::Range{ 950, 999 } ).Fill( true );
+   dip::StatisticsAccumulator acc = dip::SampleStatistics( img, mask );
+   DOCTEST_CHECK( acc.Number() == 50 * 1000 );
+   DOCTEST_CHECK( acc.Mean() == doctest::Approx( dip::Mean( img, mask ).As< dip::dfloat >() ));
+   DOCTEST_CHECK( acc.Variance() == doctest::Approx( 1000.0 * 1000.0 / 12.0 ).epsilon( 0.02 ));
+   // No pixels at all within the mask
+   mask.Fill( false );
+   acc = dip::SampleStatistics( img, mask );
+   DOCTEST_CHECK( acc.Number() == 0 );
+   DOCTEST_CHECK( acc.Mean() == 0.0 );
+   DOCTEST_CHECK( acc.Variance() == 0.0 );
+}
+
+DOCTEST_TEST_CASE("[DIPlib] testing dip::SampleQuantiles with non-finite pixels") {
+   dip::Image img{ dip::UnsignedArray{ 100, 10 }, 1, dip::DT_SFLOAT };
+   for( dip::uint ii = 0; ii < 1000; ++ii ) {
+      img.At( ii % 100, ii / 100 ) = static_cast< dip::dfloat >( ii );
+   }
+   img.At( 3, 0 ) = std::nan( "" );
+   img.At( 4, 0 ) = std::numeric_limits< dip::dfloat >::infinity();
+   img.At( 5, 0 ) = -std::numeric_limits< dip::dfloat >::infinity();
+   dip::QuantileAccumulator acc = dip::SampleQuantiles( img, {}, 64 );
+   DOCTEST_CHECK( acc.Number() == 997 );
+   DOCTEST_CHECK( std::isfinite( acc.Quantile( 0.0 )));
+   DOCTEST_CHECK( std::isfinite( acc.Quantile( 1.0 )));
+   DOCTEST_CHECK( std::abs( acc.Percentile( 50.0 ) - 500.0 ) <= 100.0 );
+}
+
+#endif // DIP__ENABLE_DOCTEST
@@ -45,6 +45,8 @@ class FeatureBendingEnergy : public ChainCodeBased {
          *output = chainCode.BendingEnergy() * scale_;
       }
 
+      virtual bool IsThreadSafe() const override { return true; }
+
    private:
       dfloat scale_;
 };
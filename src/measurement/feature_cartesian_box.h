@@ -94,6 +94,18 @@ class FeatureCartesianBox : public LineBased {
          }
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureCartesianBox( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureCartesianBox const& o = static_cast< FeatureCartesianBox const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ].min = std::min( data_[ ii ].min, o.data_[ ii ].min );
+            data_[ ii ].max = std::max( data_[ ii ].max, o.data_[ ii ].max );
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -92,6 +92,17 @@ class FeatureCenter : public LineBased {
          }
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureCenter( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureCenter const& o = static_cast< FeatureCenter const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -45,6 +45,8 @@ class FeatureConvexArea : public ConvexHullBased {
          output[ 0 ] = ( convexHull.Area() + 0.5 ) * scale_;
       }
 
+      virtual bool IsThreadSafe() const override { return true; }
+
    private:
       dfloat scale_;
 };
@@ -45,6 +45,8 @@ class FeatureConvexPerimeter : public ConvexHullBased {
          output[ 0 ] = convexHull.Perimeter() * scale_;
       }
 
+      virtual bool IsThreadSafe() const override { return true; }
+
    private:
       dfloat scale_;
 };
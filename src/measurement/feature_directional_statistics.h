@@ -74,6 +74,17 @@ class FeatureDirectionalStatistics : public LineBased {
          output[ 1 ] = data.StandardDeviation();
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureDirectionalStatistics( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureDirectionalStatistics const& o = static_cast< FeatureDirectionalStatistics const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -35,6 +35,8 @@ class FeatureEllipseVariance : public PolygonBased {
       virtual void Measure( Polygon const& polygon, Measurement::ValueIterator output ) override {
          *output = polygon.EllipseVariance();
       }
+
+      virtual bool IsThreadSafe() const override { return true; }
 };
 
 
@@ -60,6 +60,8 @@ class FeatureFeret : public ConvexHullBased {
          output[ 4 ] = feret.minAngle;
       }
 
+      virtual bool IsThreadSafe() const override { return true; }
+
    private:
       dfloat scale_;
 };
@@ -94,6 +94,17 @@ class FeatureGravity : public LineBased {
          }
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureGravity( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureGravity const& o = static_cast< FeatureGravity const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -104,6 +104,17 @@ class FeatureGreyMu : public LineBased {
          }
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureGreyMu( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureGreyMu const& o = static_cast< FeatureGreyMu const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
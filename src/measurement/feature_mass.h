@@ -70,6 +70,17 @@ class FeatureMass : public LineBased {
          *output = data_[ objectIndex ];
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureMass( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureMass const& o = static_cast< FeatureMass const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -55,11 +55,11 @@ class FeatureMaxVal : public LineBased {
                   if( it == objectIndices.end() ) {
                      data = nullptr;
                   } else {
-                     *data = std::max( *data, *grey );
+                     data = &( data_[ it->second ] );
                   }
                }
                if( data ) {
-                  *data += *grey;
+                  *data = std::max( *data, *grey );
                }
             }
             ++grey;
@@ -70,6 +70,17 @@ class FeatureMaxVal : public LineBased {
          *output = data_[ objectIndex ];
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureMaxVal( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureMaxVal const& o = static_cast< FeatureMaxVal const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] = std::max( data_[ ii ], o.data_[ ii ] );
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -87,6 +87,17 @@ class FeatureMaximum : public LineBased {
          }
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureMaximum( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureMaximum const& o = static_cast< FeatureMaximum const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] = std::max( data_[ ii ], o.data_[ ii ] );
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
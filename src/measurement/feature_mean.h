@@ -72,6 +72,18 @@ class FeatureMean : public LineBased {
          *output = ( data.number != 0 ) ? ( data.sum / static_cast< dfloat >( data.number )) : ( 0.0 );
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureMean( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureMean const& o = static_cast< FeatureMean const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ].sum += o.data_[ ii ].sum;
+            data_[ ii ].number += o.data_[ ii ].number;
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -70,6 +70,17 @@ class FeatureMinVal : public LineBased {
          *output = data_[ objectIndex ];
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureMinVal( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureMinVal const& o = static_cast< FeatureMinVal const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] = std::min( data_[ ii ], o.data_[ ii ] );
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -83,6 +83,17 @@ class FeatureMinimum : public LineBased {
          }
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureMinimum( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureMinimum const& o = static_cast< FeatureMinimum const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] = std::min( data_[ ii ], o.data_[ ii ] );
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
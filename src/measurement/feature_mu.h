@@ -102,6 +102,17 @@ class FeatureMu : public LineBased {
          }
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureMu( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureMu const& o = static_cast< FeatureMu const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
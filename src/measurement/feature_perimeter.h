@@ -45,6 +45,8 @@ class FeaturePerimeter : public ChainCodeBased {
          *output = ( chainCode.Length() + pi ) * scale_;
       }
 
+      virtual bool IsThreadSafe() const override { return true; }
+
    private:
       dfloat scale_;
 };
@@ -58,6 +58,8 @@ class FeatureRadius : public PolygonBased {
          output[ 3 ] = std::sqrt( radius.var ) * scale_;
       }
 
+      virtual bool IsThreadSafe() const override { return true; }
+
    private:
       dfloat scale_;
 };
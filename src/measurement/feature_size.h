@@ -90,6 +90,17 @@ class FeatureSize : public LineBased {
          *output = static_cast< dfloat >( data_[ objectIndex ] ) * scale_;
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureSize( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureSize const& o = static_cast< FeatureSize const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
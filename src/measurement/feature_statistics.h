@@ -78,6 +78,17 @@ class FeatureStatistics : public LineBased {
          output[ 3 ] = data.ExcessKurtosis();
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureStatistics( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureStatistics const& o = static_cast< FeatureStatistics const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
@@ -71,6 +71,17 @@ class FeatureStandardDeviation : public LineBased {
          *output = data.StandardDeviation();
       }
 
+      virtual std::unique_ptr< LineBased > CloneForThread() const override {
+         return std::unique_ptr< LineBased >( new FeatureStandardDeviation( *this ));
+      }
+
+      virtual void Merge( LineBased& other ) override {
+         FeatureStandardDeviation const& o = static_cast< FeatureStandardDeviation const& >( other );
+         for( dip::uint ii = 0; ii < data_.size(); ++ii ) {
+            data_[ ii ] += o.data_[ ii ];
+         }
+      }
+
       virtual void Cleanup() override {
          data_.clear();
          data_.shrink_to_fit();
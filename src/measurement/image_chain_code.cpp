@@ -19,10 +19,12 @@
  */
 
 #include <array>
-#include <map>
+#include <exception>
 
 #include "diplib.h"
 #include "diplib/chain_code.h"
+#include "diplib/measurement.h"
+#include "diplib/multithreading.h"
 #include "diplib/regions.h"
 #include "diplib/overload.h"
 
@@ -34,9 +36,6 @@ constexpr VertexInteger ChainCode::deltas8[8];
 
 namespace {
 
-struct ObjectData { dip::uint index; bool done; };
-using ObjectIdList = std::map< dip::uint, ObjectData >; // key is the objectID (label)
-
 template< typename TPI >
 static ChainCode dip__OneChainCode(
       void const* data_ptr,
@@ -44,7 +43,9 @@ static ChainCode dip__OneChainCode(
       VertexInteger const& dims,  // largest coordinates in image
       dip::uint connectivity,
       ChainCode::CodeTable const& codeTable,
-      bool startDir0 = false
+      bool startDir0 = false,
+      bool isHole = false, // if true, `startDir` points at the hole whose boundary we trace
+      unsigned startDir = 0
 ) {
    TPI const* data = static_cast< TPI const* >( data_ptr );
    dip::uint label = *data;
@@ -54,10 +55,11 @@ static ChainCode dip__OneChainCode(
    out.start = coord;
    out.objectID = label;
    out.is8connected = connectivity != 1; // 0 means 8-connected also
+   out.isHole = isHole;
    // Follow contour always as left as possible (i.e. ii = ii+2)
    dip::sint offset = 0;
-   unsigned dir = 0; // start direction given by how we determine the start position!
-   if( !startDir0 ) {
+   unsigned dir = startDir; // start direction given by how we determine the start position!
+   if( !startDir0 && !isHole ) {
       // In this case, we cannot be sure of the start direction. Let's look for a background pixel first.
       while( true ) {
          VertexInteger nc = coord + codeTable.pos[ dir ];
@@ -74,6 +76,10 @@ static ChainCode dip__OneChainCode(
       VertexInteger nc = coord + codeTable.pos[ dir ];
       dip::sint no = offset + codeTable.offset[ dir ];
       if(( nc.x >= 0 ) && ( nc.x <= dims.x ) && ( nc.y >= 0 ) && ( nc.y <= dims.y ) && (( data[ no ] ) == label ) ) {
+         if( isHole && ( coord == out.start ) && !out.codes.empty() && ( dir == out.codes.front() )) {
+            // We're back at the start, and would repeat the first step
+            break;
+         }
          // Add new chain
          bool border = ( nc.x == 0 ) || ( nc.x == dims.x ) || ( nc.y == 0 ) || ( nc.y == dims.y );
          out.Push( { dir, border } );
@@ -90,49 +96,172 @@ static ChainCode dip__OneChainCode(
             dir--;
          }
       }
-   } while( !(( coord == out.start ) && ( dir == startdir )));
+   } while( isHole || !(( coord == out.start ) && ( dir == startdir )));
+   return out;
+}
+
+// Traces the boundaries of the holes in the object with label `label`, which is contained in the bounding box
+// given by `topLeft` and `bottomRight`. A hole is a connected component of pixels not in the object, using the
+// complementary connectivity, that is not connected to the outside of the bounding box.
+template< typename TPI >
+static ChainCodeArray dip__HoleChainCodes(
+      TPI const* data,
+      IntegerArray const& strides,
+      dip::uint label,
+      VertexInteger topLeft,
+      VertexInteger bottomRight,
+      VertexInteger const& dims,  // largest coordinates in image
+      dip::uint connectivity,
+      ChainCode::CodeTable const& codeTable
+) {
+   // Local map of the bounding box, with a 1-pixel border: 1 = object, 2 = visited, 0 = other
+   dip::sint width = bottomRight.x - topLeft.x + 3;
+   dip::sint height = bottomRight.y - topLeft.y + 3;
+   std::vector< uint8 > map( static_cast< dip::uint >( width * height ), 0 );
+   for( dip::sint y = topLeft.y; y <= bottomRight.y; ++y ) {
+      for( dip::sint x = topLeft.x; x <= bottomRight.x; ++x ) {
+         if( data[ x * strides[ 0 ] + y * strides[ 1 ]] == label ) {
+            map[ static_cast< dip::uint >(( y - topLeft.y + 1 ) * width + x - topLeft.x + 1 ) ] = 1;
+         }
+      }
+   }
+   // The background is 4-connected if the object is 8-connected, and vice versa
+   bool background8 = connectivity == 1;
+   std::vector< dip::sint > stack;
+   auto floodFill = [ & ]( dip::sint index ) {
+      map[ static_cast< dip::uint >( index ) ] = 2;
+      stack.push_back( index );
+      while( !stack.empty() ) {
+         dip::sint ii = stack.back();
+         stack.pop_back();
+         dip::sint x = ii % width;
+         dip::sint y = ii / width;
+         for( dip::sint dy = -1; dy <= 1; ++dy ) {
+            for( dip::sint dx = -1; dx <= 1; ++dx ) {
+               if((( dx == 0 ) && ( dy == 0 )) || ( !background8 && ( dx != 0 ) && ( dy != 0 ))) {
+                  continue;
+               }
+               if(( x + dx < 0 ) || ( x + dx >= width ) || ( y + dy < 0 ) || ( y + dy >= height )) {
+                  continue;
+               }
+               dip::sint jj = ii + dx + dy * width;
+               if( map[ static_cast< dip::uint >( jj ) ] == 0 ) {
+                  map[ static_cast< dip::uint >( jj ) ] = 2;
+                  stack.push_back( jj );
+               }
+            }
+         }
+      }
+   };
+   floodFill( 0 ); // the outside of the object
+   // Any pixels not yet visited are in holes. The first one we find for each hole has an object pixel above it.
+   ChainCodeArray out;
+   unsigned southDir = connectivity == 1 ? 3 : 6;
+   for( dip::sint y = 1; y < height - 1; ++y ) {
+      for( dip::sint x = 1; x < width - 1; ++x ) {
+         dip::sint index = y * width + x;
+         if( map[ static_cast< dip::uint >( index ) ] == 0 ) {
+            VertexInteger coord{ x + topLeft.x - 1, y + topLeft.y - 2 };
+            out.push_back( dip__OneChainCode< TPI >( data + coord.x * strides[ 0 ] + coord.y * strides[ 1 ],
+                                                     coord, dims, connectivity, codeTable, false, true, southDir ));
+            floodFill( index );
+         }
+      }
+   }
    return out;
 }
 
 template< typename TPI >
 static ChainCodeArray dip__ChainCodes(
       Image const& labels,
-      ObjectIdList& objectIDs,
+      ObjectIdToIndexMap const& objectIDs,
       dip::uint nObjects, // potentially different from the number of entries in objectIDs, if there were repeated elements in the original list.
       dip::uint connectivity,
-      ChainCode::CodeTable const& codeTable
+      ChainCode::CodeTable const& codeTable,
+      bool holes
 ) {
    DIP_ASSERT( labels.DataType() == DataType( TPI( 0 ) ) );
-   TPI* data = static_cast< TPI* >( labels.Origin() );
-   ChainCodeArray ccArray( nObjects );  // output array
+   TPI const* data = static_cast< TPI const* >( labels.Origin() );
    VertexInteger dims = { static_cast< dip::sint >( labels.Size( 0 ) - 1 ), static_cast< dip::sint >( labels.Size( 1 ) - 1 ) }; // our local copy of `dims` now contains the largest coordinates
    IntegerArray const& strides = labels.Strides();
 
-   // Find first pixel of requested label
+   // Find first pixel of each requested label, and its bounding box if we need to look for holes
+   struct ObjectData {
+      bool found = false;
+      VertexInteger start;
+      VertexInteger topLeft;
+      VertexInteger bottomRight;
+   };
+   std::vector< ObjectData > objects( nObjects );
    dip::uint label = 0;
+   ObjectData* object = nullptr;
    VertexInteger coord;
    for( coord.y = 0; coord.y <= dims.y; ++coord.y ) {
       dip::sint pos = coord.y * strides[ 1 ];
       for( coord.x = 0; coord.x <= dims.x; ++coord.x ) {
-         bool process = false;
-         dip::uint index = 0;
          dip::uint newlabel = data[ pos ];
-         if( ( newlabel != 0 ) && ( newlabel != label ) ) {
-            // Check whether newlabel is start of not processed object
-            auto it = objectIDs.find( newlabel );
-            if( ( it != objectIDs.end() ) && !it->second.done ) {
-               it->second.done = true;
-               index = it->second.index;
-               label = newlabel;
-               process = true;
+         if( newlabel != label ) {
+            label = newlabel;
+            object = nullptr;
+            if( label != 0 ) {
+               auto it = objectIDs.find( label );
+               if( it != objectIDs.end() ) {
+                  object = &objects[ it->second ];
+                  if( !object->found ) {
+                     object->found = true;
+                     object->start = coord;
+                     object->topLeft = coord;
+                     object->bottomRight = coord;
+                  }
+               }
             }
          }
-         if( process ) {
-            ccArray[ index ] = dip__OneChainCode< TPI >( data + pos, coord, dims, connectivity, codeTable, true );
+         if( holes && object ) {
+            object->topLeft.x = std::min( object->topLeft.x, coord.x );
+            object->bottomRight.x = std::max( object->bottomRight.x, coord.x );
+            object->bottomRight.y = coord.y;
          }
          pos += strides[ 0 ];
       }
    }
+
+   // Trace each object, objects are independent so we can do this in parallel
+   ChainCodeArray ccArray( nObjects );  // output array
+   std::vector< ChainCodeArray > holeArrays( holes ? nObjects : 0 );
+   dip::uint nThreads = nObjects < 100 ? 1 : GetNumberOfThreads();
+   std::exception_ptr exception;
+   #ifdef _OPENMP
+   #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( dynamic, 16 )
+   #endif
+   for( dip::sint tt = 0; tt < static_cast< dip::sint >( nObjects ); ++tt ) {
+      dip::uint ii = static_cast< dip::uint >( tt );
+      ObjectData const& obj = objects[ ii ];
+      if( !obj.found ) {
+         continue;
+      }
+      try {
+         TPI const* ptr = data + obj.start.x * strides[ 0 ] + obj.start.y * strides[ 1 ];
+         ccArray[ ii ] = dip__OneChainCode< TPI >( ptr, obj.start, dims, connectivity, codeTable, true );
+         if( holes ) {
+            holeArrays[ ii ] = dip__HoleChainCodes< TPI >( data, strides, *ptr, obj.topLeft, obj.bottomRight, dims, connectivity, codeTable );
+         }
+      } catch( ... ) {
+         #ifdef _OPENMP
+         #pragma omp critical( dip__ChainCodesException )
+         #endif
+         if( !exception ) {
+            exception = std::current_exception();
+         }
+      }
+   }
+   if( exception ) {
+      std::rethrow_exception( exception );
+   }
+   for( auto& holeArray : holeArrays ) {
+      for( auto& cc : holeArray ) {
+         ccArray.push_back( std::move( cc ));
+      }
+   }
    return ccArray;
 }
 
@@ -141,7 +270,8 @@ static ChainCodeArray dip__ChainCodes(
 ChainCodeArray GetImageChainCodes(
       Image const& labels,
       UnsignedArray const& objectIDs,
-      dip::uint connectivity
+      dip::uint connectivity,
+      String const& holes
 ) {
    // Check input image
    DIP_THROW_IF( !labels.IsForged(), E::IMAGE_NOT_FORGED );
@@ -149,22 +279,24 @@ ChainCodeArray GetImageChainCodes(
       labels.CheckProperties( 2, 1, DataType::Class_UInt );
    DIP_END_STACK_TRACE
    DIP_THROW_IF( connectivity > 2, E::CONNECTIVITY_NOT_SUPPORTED );
+   bool traceHoles;
+   DIP_STACK_TRACE_THIS( traceHoles = BooleanFromString( holes, "include", "exclude" ));
 
    // Initialize freeman codes
    ChainCode::CodeTable codeTable = ChainCode::PrepareCodeTable( connectivity, labels.Strides() );
 
    // Create a map for the object IDs
-   ObjectIdList objectIdList;
+   ObjectIdToIndexMap objectIdList;
    dip::uint nObjects;
    if (objectIDs.empty()) {
       UnsignedArray allObjectIDs = GetObjectLabels( labels, Image(), "exclude" );
       for( dip::uint ii = 0; ii < allObjectIDs.size(); ++ii ) {
-         objectIdList.emplace( allObjectIDs[ ii ], ObjectData{ ii, false } );
+         objectIdList.emplace( allObjectIDs[ ii ], ii );
       }
       nObjects = allObjectIDs.size();
    } else {
       for( dip::uint ii = 0; ii < objectIDs.size(); ++ii ) {
-         objectIdList.emplace( objectIDs[ ii ], ObjectData{ ii, false } );
+         objectIdList.emplace( objectIDs[ ii ], ii );
       }
       nObjects = objectIDs.size();
    }
@@ -172,7 +304,7 @@ ChainCodeArray GetImageChainCodes(
    // Get the chain code for each label
    ChainCodeArray ccArray;
    DIP_OVL_CALL_ASSIGN_UINT( ccArray,
-                             dip__ChainCodes, ( labels, objectIdList, nObjects, connectivity, codeTable ),
+                             dip__ChainCodes, ( labels, objectIdList, nObjects, connectivity, codeTable, traceHoles ),
                              labels.DataType() );
    return ccArray;
 }
@@ -294,6 +426,94 @@ DOCTEST_TEST_CASE("[DIPlib] testing chain code conversion to image and back") {
    }
 }
 
+DOCTEST_TEST_CASE("[DIPlib] testing GetImageChainCodes with holes") {
+   dip::Image img{ dip::UnsignedArray{ 30, 20 }, 1, dip::DT_UINT8 };
+   img.Fill( 0 );
+   img.At( dip::Range{ 2, 11 }, dip::Range{ 2, 11 } ).Fill( 1 );   // 10x10 square
+   img.At( dip::Range{ 5, 8 }, dip::Range{ 5, 8 } ).Fill( 0 );     // with a 4x4 hole
+   img.At( dip::Range{ 15, 25 }, dip::Range{ 3, 15 } ).Fill( 2 );  // 11x13 rectangle
+   img.At( dip::Range{ 17, 19 }, dip::Range{ 5, 7 } ).Fill( 0 );   // with a 3x3 hole
+   img.At( dip::Range{ 17, 23 }, dip::Range{ 10, 13 } ).Fill( 3 ); // and another hole filled with an object
+   img.At( 5, 15 ) = 4; // a single pixel
+   dip::ChainCodeArray outer = dip::GetImageChainCodes( img, { 1, 2, 3, 4 }, 2 );
+   DOCTEST_REQUIRE( outer.size() == 4 );
+   dip::ChainCodeArray all = dip::GetImageChainCodes( img, { 1, 2, 3, 4 }, 2, "include" );
+   DOCTEST_REQUIRE( all.size() == 7 );
+   for( dip::uint ii = 0; ii < 4; ++ii ) {
+      DOCTEST_CHECK( !all[ ii ].isHole );
+      DOCTEST_CHECK( all[ ii ].objectID == ii + 1 );
+      DOCTEST_CHECK( all[ ii ].codes.size() == outer[ ii ].codes.size() );
+   }
+   DOCTEST_CHECK( all[ 4 ].isHole );
+   DOCTEST_CHECK( all[ 4 ].objectID == 1 );
+   DOCTEST_CHECK( all[ 4 ].codes.size() == 16 ); // the pixels around the 4x4 hole, cutting corners
+   DOCTEST_CHECK( all[ 5 ].isHole );
+   DOCTEST_CHECK( all[ 5 ].objectID == 2 );
+   DOCTEST_CHECK( all[ 5 ].codes.size() == 12 ); // the pixels around the 3x3 hole, cutting corners
+   DOCTEST_CHECK( all[ 6 ].isHole );
+   DOCTEST_CHECK( all[ 6 ].objectID == 2 );
+   DOCTEST_CHECK( all[ 6 ].codes.size() == 22 ); // the pixels around the 7x4 hole, cutting corners
+   // 4-connected objects have 8-connected holes
+   all = dip::GetImageChainCodes( img, { 1 }, 1, "include" );
+   DOCTEST_REQUIRE( all.size() == 2 );
+   DOCTEST_CHECK( all[ 1 ].isHole );
+   DOCTEST_CHECK( all[ 1 ].codes.size() == 20 ); // the 6x6 ring of pixels around the 4x4 hole
+}
+
+DOCTEST_TEST_CASE("[DIPlib] testing GetImageChainCodes with a hole next to a thin wall") {
+   dip::Image img{ dip::UnsignedArray{ 12, 12 }, 1, dip::DT_UINT8 };
+   img.Fill( 0 );
+   img.At( dip::Range{ 2, 9 }, dip::Range{ 2, 9 } ).Fill( 1 );  // 8x8 square
+   img.At( dip::Range{ 3, 8 }, dip::Range{ 3, 8 } ).Fill( 0 );  // with a 6x6 hole, leaving a 1-pixel wall all around
+   dip::ChainCodeArray all = dip::GetImageChainCodes( img, { 1 }, 2, "include" );
+   DOCTEST_REQUIRE( all.size() == 2 );
+   DOCTEST_CHECK( !all[ 0 ].isHole );
+   DOCTEST_CHECK( all[ 0 ].codes.size() == 28 ); // the outer 8x8 square
+   DOCTEST_CHECK( all[ 1 ].isHole );
+   DOCTEST_CHECK( all[ 1 ].objectID == 1 );
+   DOCTEST_CHECK( all[ 1 ].codes.size() == 24 ); // the same pixels, cutting corners
+   all = dip::GetImageChainCodes( img, { 1 }, 1, "include" );
+   DOCTEST_REQUIRE( all.size() == 2 );
+   DOCTEST_CHECK( all[ 1 ].isHole );
+   DOCTEST_CHECK( all[ 1 ].codes.size() == 28 );
+   // The hole touches the image edge on one side, so it is no longer a hole
+   img.At( dip::Range{ 0, 2 }, dip::Range{ 5 } ).Fill( 0 );
+   all = dip::GetImageChainCodes( img, { 1 }, 2, "include" );
+   DOCTEST_CHECK( all.size() == 1 );
+}
+
+#include "diplib/random.h"
+#include "diplib/generation.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the multithreaded GetImageChainCodes") {
+   dip::Random random( 0 );
+   dip::Image grey{ dip::UnsignedArray{ 400, 300 }, 1, dip::DT_SFLOAT };
+   grey.Fill( 0 );
+   dip::UniformNoise( grey, grey, random );
+   dip::Image label = dip::Label( grey > 0.6, 2 );
+   dip::uint nThreads = dip::GetNumberOfThreads();
+   dip::SetNumberOfThreads( 1 );
+   dip::ChainCodeArray serial = dip::GetImageChainCodes( label, {}, 2, "include" );
+   dip::SetNumberOfThreads( 4 );
+   dip::ChainCodeArray parallel = dip::GetImageChainCodes( label, {}, 2, "include" );
+   dip::SetNumberOfThreads( nThreads );
+   dip::uint nObjects = dip::GetObjectLabels( label, {}, "exclude" ).size();
+   DOCTEST_REQUIRE( nObjects >= 100 );
+   DOCTEST_REQUIRE( serial.size() > nObjects ); // there are holes too
+   DOCTEST_REQUIRE( serial.size() == parallel.size() );
+   dip::uint nDifferent = 0;
+   for( dip::uint ii = 0; ii < serial.size(); ++ii ) {
+      if(( serial[ ii ].objectID != parallel[ ii ].objectID ) ||
+         ( serial[ ii ].isHole != parallel[ ii ].isHole ) ||
+         !( serial[ ii ].start == parallel[ ii ].start ) ||
+         ( serial[ ii ].codes.size() != parallel[ ii ].codes.size() ) ||
+         !std::equal( serial[ ii ].codes.begin(), serial[ ii ].codes.end(), parallel[ ii ].codes.begin() )) {
+         ++nDifferent;
+      }
+   }
+   DOCTEST_CHECK( nDifferent == 0 );
+}
+
 #include "diplib/pixel_table.h"
 #include "diplib/morphology.h"
 
@@ -25,16 +25,6 @@
 
 namespace dip {
 
-// An operator that increments the iterator but treating the container as a circular one
-template< typename Iterator, typename Container >
-static inline Iterator Next( Iterator it, Container const& con ) {
-   ++it;
-   if( it == con.end() ) {
-      it = con.begin();
-   }
-   return it;
-}
-
 FeretValues ConvexHull::Feret() const {
 
    FeretValues feret;
@@ -55,78 +45,44 @@ FeretValues ConvexHull::Feret() const {
       return feret;
    }
 
-   /* Algorithm by Preparata and Shamos (1985) to obtain list of anti-podal pairs
-    *    (from http://cgm.cs.mcgill.ca/~orm/rotcal.html)
-    *
-    * begin
-    *   p0:=pn;
-    *   q:=NEXT[p];
-    *   while (Area(p,NEXT[p],NEXT[q]) > Area(p,NEXT[p],q)) do
-    *     q:=NEXT[q];
-    *     q0:=q;                                                <= WRONG INDENTING!!!
-    *     while (q != p0) do                                    <= TYPO! (p != p0)
-    *       begin
-    *         p:=NEXT[p];
-    *         Print(p,q);
-    *         while (Area(p,NEXT[p],NEXT[q]) > Area(p,NEXT[p],q) do
-    *           begin
-    *             q:=NEXT[q];
-    *             if ((p,q) != (q0,p0)) then Print(p,q)
-    *             else return                                   <= NEVER SEEMS TO HAPPEN?
-    *           end;
-    *         if (Area(p,NEXT[p],NEXT[q]) = Area(p,NEXT[p],q)) then
-    *           if ((p,q) != (q0,p0)) then Print(p,NEXT[q])
-    *           else Print(NEXT[p],q)                           <= NEVER SEEMS TO HAPPEN?
-    *       end
-    * end.
-    */
-   auto first = vertices.begin();
-   auto p = first;
-   auto q = p + 1;
-   while( ParallelogramSignedArea( *p, *Next( p, vertices ), *Next( q, vertices )) >
-          ParallelogramSignedArea( *p, *Next( p, vertices ), *q ) ) {
-      q = Next( q, vertices );
-   }
-
-   //auto q0 = q;
-   auto p0 = vertices.end() - 1;
+   // Rotating calipers: for each edge (i,i+1) of the hull, `j` is the vertex furthest away from it. As `i`
+   // goes around the hull once, `j` also goes around the hull once, making this an O(n) algorithm.
+   // The width of the hull in the direction perpendicular to the edge is the distance of `j` to the edge;
+   // the minimum Feret diameter is the smallest of these widths (it is always measured perpendicular to an
+   // edge). The pairs (i,j) and (i+1,j) are antipodal pairs, one of them gives the maximum Feret diameter.
+   // If edge (j,j+1) is parallel to edge (i,i+1), then j+1 forms antipodal pairs also.
+   //
+   // See e.g. G.T. Toussaint, "Solving geometric problems with the rotating calipers", Proc. IEEE MELECON'83, 1983.
+   dip::uint n = vertices.size();
+   dip::uint j = 1;
    feret.minDiameter = std::numeric_limits< dfloat >::max();
-   while( p != p0 ) {
-      ++p;
-      // (p,q) is an antipodal pair
-      dfloat d = Distance( *p, *q );
+   auto updateMax = [ & ]( VertexFloat const& v1, VertexFloat const& v2 ) {
+      dfloat d = Distance( v1, v2 );
       if( d > feret.maxDiameter ) {
          feret.maxDiameter = d;
-         feret.maxAngle = Angle( *p, *q );
+         feret.maxAngle = Angle( v1, v2 );
       }
-      while( ParallelogramSignedArea( *p, *Next( p, vertices ), *Next( q, vertices )) >
-             ParallelogramSignedArea( *p, *Next( p, vertices ), *q ) ) {
-         // (p,q+1) is an antipodal pair
-         d = TriangleHeight( *q, *Next( q, vertices ), *p );
-         if( d < feret.minDiameter ) {
-            feret.minDiameter = d;
-            feret.minAngle = Angle( *q, *Next( q, vertices ) );
-         }
-         q = Next( q, vertices );
-         d = Distance( *p, *q );
-         if( d > feret.maxDiameter ) {
-            feret.maxDiameter = d;
-            feret.maxAngle = Angle( *p, *q );
-         }
+   };
+   for( dip::uint i = 0; i < n; ++i ) {
+      VertexFloat const& v1 = vertices[ i ];
+      VertexFloat const& v2 = vertices[ ( i + 1 ) % n ];
+      dfloat area = std::abs( ParallelogramSignedArea( v1, v2, vertices[ j ] ));
+      dfloat nextArea = std::abs( ParallelogramSignedArea( v1, v2, vertices[ ( j + 1 ) % n ] ));
+      while( nextArea > area ) {
+         j = ( j + 1 ) % n;
+         area = nextArea;
+         nextArea = std::abs( ParallelogramSignedArea( v1, v2, vertices[ ( j + 1 ) % n ] ));
       }
-      if( ParallelogramSignedArea( *p, *Next( p, vertices ), *Next( q, vertices ) ) ==
-          ParallelogramSignedArea( *p, *Next( p, vertices ), *q ) ) {
-         // (p,q+1) is an antipodal pair also, but we don't advance q
-         d = TriangleHeight( *q, *Next( q, vertices ), *p );
-         if( d < feret.minDiameter ) {
-            feret.minDiameter = d;
-            feret.minAngle = Angle( *q, *Next( q, vertices ) );
-         }
-         d = Distance( *p, *Next( q, vertices ) );
-         if( d > feret.maxDiameter ) {
-            feret.maxDiameter = d;
-            feret.maxAngle = Angle( *p, *Next( q, vertices ) );
-         }
+      dfloat width = area / Distance( v1, v2 );
+      if( width < feret.minDiameter ) {
+         feret.minDiameter = width;
+         feret.minAngle = Angle( v1, v2 );
+      }
+      updateMax( v1, vertices[ j ] );
+      updateMax( v2, vertices[ j ] );
+      if( nextArea == area ) {
+         updateMax( v1, vertices[ ( j + 1 ) % n ] );
+         updateMax( v2, vertices[ ( j + 1 ) % n ] );
       }
    }
 
@@ -139,7 +95,6 @@ FeretValues ConvexHull::Feret() const {
       dfloat d = v.x * cos + v.y * sin;
       pmin = std::min( pmin, d );
       pmax = std::max( pmax, d );
-      ++p;
    }
    feret.maxPerpendicular = pmax - pmin;
 
@@ -220,4 +175,38 @@ DOCTEST_TEST_CASE("[DIPlib] testing chain code polygons") {
    DOCTEST_CHECK( f.minDiameter == doctest::Approx( 2 ));
 }
 
+#include "diplib/random.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing ConvexHull::Feret against brute force") {
+   dip::Random random( 0 );
+   dip::uint nWrong = 0;
+   for( dip::uint tt = 0; tt < 500; ++tt ) {
+      dip::Polygon p;
+      dip::uint n = 3 + random() % 12;
+      for( dip::uint ii = 0; ii < n; ++ii ) {
+         p.vertices.push_back( { static_cast< dip::dfloat >( random() % 50 ), static_cast< dip::dfloat >( random() % 50 ) } );
+      }
+      dip::ConvexHull h = p.ConvexHull();
+      auto const& v = h.Vertices();
+      if( v.size() < 3 ) {
+         continue;
+      }
+      dip::FeretValues f = h.Feret();
+      dip::dfloat maxDiameter = 0;
+      dip::dfloat minDiameter = std::numeric_limits< dip::dfloat >::max();
+      for( dip::uint ii = 0; ii < v.size(); ++ii ) {
+         dip::dfloat width = 0;
+         for( dip::uint jj = 0; jj < v.size(); ++jj ) {
+            maxDiameter = std::max( maxDiameter, dip::Distance( v[ ii ], v[ jj ] ));
+            width = std::max( width, dip::TriangleHeight( v[ ii ], v[ ( ii + 1 ) % v.size() ], v[ jj ] ));
+         }
+         minDiameter = std::min( minDiameter, width );
+      }
+      if(( std::abs( f.maxDiameter - maxDiameter ) > 1e-9 ) || ( std::abs( f.minDiameter - minDiameter ) > 1e-9 )) {
+         ++nWrong;
+      }
+   }
+   DOCTEST_CHECK( nWrong == 0 );
+}
+
 #endif // DIP__ENABLE_DOCTEST
@@ -21,6 +21,7 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <exception>
 
 #include "diplib.h"
 #include "diplib/measurement.h"
@@ -28,6 +29,7 @@
 #include "diplib/chain_code.h"
 #include "diplib/framework.h"
 #include "diplib/regions.h"
+#include "diplib/multithreading.h"
 
 // FEATURES:
 // Size
@@ -142,19 +144,90 @@ class MeasureLineFilter : public Framework::ScanLineFilter {
             );
          }
 
+         UnsignedArray position = params.position;
+         position[ offsetDim ] += offset;
          for( auto const& feature : features ) {
             // NOTE! params.dimension here works as long as params.tensorToSpatial is false.
             // As is now, MeasurementTool::Measure only works with scalar images, so we don't need to test here.
-            feature->ScanLine( label, grey, params.position, params.dimension, objectIndices );
+            feature->ScanLine( label, grey, position, params.dimension, objectIndices );
          }
       }
-      MeasureLineFilter( LineBasedFeatureArray const& features, ObjectIdToIndexMap const& objectIndices ) :
-            features( features ), objectIndices( objectIndices ) {}
+      // `offset` is added to the coordinates along `offsetDim`, if the images are a view into a larger image
+      MeasureLineFilter( LineBasedFeatureArray const& features, ObjectIdToIndexMap const& objectIndices, dip::uint offsetDim, dip::uint offset ) :
+            features( features ), objectIndices( objectIndices ), offsetDim( offsetDim ), offset( offset ) {}
    private:
       LineBasedFeatureArray const& features;
       ObjectIdToIndexMap const& objectIndices;
+      dip::uint offsetDim;
+      dip::uint offset;
 };
 
+// Calls dip::Feature::LineBased::ScanLine() for all lines in the image
+void ScanLineBasedFeatures(
+      Image const& label,
+      Image const& grey,
+      LineBasedFeatureArray const& features,
+      ObjectIdToIndexMap const& objectIndices,
+      dip::uint offsetDim = 0,
+      dip::uint offset = 0
+) {
+   // Create arrays for Scan framework
+   ImageConstRefArray inar{ label };
+   DataTypeArray inBufT{ DT_UINT32 };
+   if( grey.IsForged() ) {
+      inar.emplace_back( grey );
+      inBufT.emplace_back( DT_DFLOAT );
+   }
+   ImageRefArray outar{};
+   // Do the scan
+   MeasureLineFilter functor{ features, objectIndices, offsetDim, offset };
+   Framework::Scan( inar, outar, inBufT, {}, {}, {}, functor,
+         Framework::Scan_NoMultiThreading + Framework::Scan_NeedCoordinates );
+}
+
+// Calls dip::Feature::LineBased::ScanLine() for all lines in the image, splitting the image into `nThreads`
+// slabs that are processed in parallel. `features` are used by the first thread, each of the other threads
+// uses the features in one of the `clones` arrays. The results are not merged.
+void ScanLineBasedFeaturesParallel(
+      Image const& label,
+      Image const& grey,
+      LineBasedFeatureArray const& features,
+      std::vector< LineBasedFeatureArray > const& clones,
+      ObjectIdToIndexMap const& objectIndices
+) {
+   dip::uint nThreads = clones.size() + 1;
+   dip::uint splitDim = 0;
+   for( dip::uint ii = 1; ii < label.Dimensionality(); ++ii ) {
+      if( std::abs( label.Stride( ii )) > std::abs( label.Stride( splitDim ))) {
+         splitDim = ii;
+      }
+   }
+   std::vector< std::exception_ptr > exceptions( nThreads );
+   #ifdef _OPENMP
+   #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( static, 1 )
+   #endif
+   for( dip::sint tt = 0; tt < static_cast< dip::sint >( nThreads ); ++tt ) {
+      dip::uint ii = static_cast< dip::uint >( tt );
+      try {
+         dip::uint start = label.Size( splitDim ) * ii / nThreads;
+         dip::uint stop = label.Size( splitDim ) * ( ii + 1 ) / nThreads;
+         if( start < stop ) {
+            RangeArray ranges( label.Dimensionality() );
+            ranges[ splitDim ] = Range( static_cast< dip::sint >( start ), static_cast< dip::sint >( stop ) - 1 );
+            ScanLineBasedFeatures( label.At( ranges ), grey.IsForged() ? Image( grey.At( ranges )) : Image(),
+                                   ii == 0 ? features : clones[ ii - 1 ], objectIndices, splitDim, start );
+         }
+      } catch( ... ) {
+         exceptions[ ii ] = std::current_exception();
+      }
+   }
+   for( auto const& e : exceptions ) {
+      if( e ) {
+         std::rethrow_exception( e );
+      }
+   }
+}
+
 } // namespace
 
 Measurement MeasurementTool::Measure(
@@ -254,19 +327,43 @@ Measurement MeasurementTool::Measure(
    // Let the line based functions do their work
    if( doLineBased ) {
 
-      // Create arrays for Scan framework
-      ImageConstRefArray inar{ label };
-      DataTypeArray inBufT{ DT_UINT32 };
-      if( grey.IsForged() ) {
-         inar.emplace_back( grey );
-         inBufT.emplace_back( DT_DFLOAT );
+      // Features that support it accumulate in multiple threads, each processing a slab of the image
+      dip::uint nThreads = label.NumberOfPixels() < threadingThreshold ? 1 : GetNumberOfThreads();
+      LineBasedFeatureArray serialFeatures;
+      LineBasedFeatureArray parallelFeatures;
+      std::vector< std::vector< std::unique_ptr< Feature::LineBased >>> clones( nThreads > 1 ? nThreads - 1 : 0 );
+      for( auto const& feature : lineBasedFeatures ) {
+         std::unique_ptr< Feature::LineBased > clone;
+         if( nThreads > 1 ) {
+            clone = feature->CloneForThread();
+         }
+         if( clone ) {
+            parallelFeatures.push_back( feature );
+            clones[ 0 ].push_back( std::move( clone ));
+            for( dip::uint ii = 1; ii < clones.size(); ++ii ) {
+               clones[ ii ].push_back( feature->CloneForThread() );
+            }
+         } else {
+            serialFeatures.push_back( feature );
+         }
+      }
+      if( !parallelFeatures.empty() ) {
+         std::vector< LineBasedFeatureArray > cloneArrays( clones.size() );
+         for( dip::uint ii = 0; ii < clones.size(); ++ii ) {
+            for( auto const& clone : clones[ ii ] ) {
+               cloneArrays[ ii ].push_back( clone.get() );
+            }
+         }
+         ScanLineBasedFeaturesParallel( label, grey, parallelFeatures, cloneArrays, measurement.ObjectIndices() );
+         for( auto const& threadClones : clones ) {
+            for( dip::uint ii = 0; ii < parallelFeatures.size(); ++ii ) {
+               parallelFeatures[ ii ]->Merge( *( threadClones[ ii ] ));
+            }
+         }
+      }
+      if( !serialFeatures.empty() ) {
+         ScanLineBasedFeatures( label, grey, serialFeatures, measurement.ObjectIndices() );
       }
-      ImageRefArray outar{};
-
-      // Do the scan, which calls dip::Feature::LineBased::ScanLine()
-      MeasureLineFilter functor{ lineBasedFeatures, measurement.ObjectIndices() };
-      Framework::Scan( inar, outar, inBufT, {}, {}, {}, functor,
-            Framework::Scan_NoMultiThreading + Framework::Scan_NeedCoordinates );
 
       // Call dip::Feature::LineBased::Finish()
       for( auto const& feature : lineBasedFeatures ) {
@@ -290,31 +387,88 @@ Measurement MeasurementTool::Measure(
 
    // Let the chaincode based functions do their work
    if( doChaincodeBased || doPolygonBased || doConvHullBased ) {
-      ChainCodeArray chainCodeArray = GetImageChainCodes( label, measurement.Objects(), connectivity );
-      auto itCC = chainCodeArray.begin();
-      auto itObj = measurement.FirstObject(); // these two arrays are ordered the same way
-      do {
-         Polygon polygon;
-         ConvexHull convexHull;
-         if( doPolygonBased || doConvHullBased ) {
-            polygon = itCC->Polygon();
+      ChainCodeArray chainCodeArray = GetImageChainCodes( label, measurement.Objects(), connectivity ); // ordered as the objects in `measurement`
+      std::vector< dip::sint > columns( featureArray.size(), 0 );
+      std::vector< bool > threadSafe( featureArray.size(), false );
+      bool doParallel = false;
+      bool doSequential = false;
+      for( dip::uint jj = 0; jj < featureArray.size(); ++jj ) {
+         Feature::Base* feature = featureArray[ jj ];
+         bool isThreadSafe;
+         if( feature->type == Feature::Type::CHAINCODE_BASED ) {
+            isThreadSafe = dynamic_cast< Feature::ChainCodeBased* >( feature )->IsThreadSafe();
+         } else if( feature->type == Feature::Type::POLYGON_BASED ) {
+            isThreadSafe = dynamic_cast< Feature::PolygonBased* >( feature )->IsThreadSafe();
+         } else if( feature->type == Feature::Type::CONVEXHULL_BASED ) {
+            isThreadSafe = dynamic_cast< Feature::ConvexHullBased* >( feature )->IsThreadSafe();
+         } else {
+            continue;
          }
-         if( doConvHullBased ) {
-            convexHull = polygon.ConvexHull();
+         threadSafe[ jj ] = isThreadSafe;
+         doParallel |= isThreadSafe;
+         doSequential |= !isThreadSafe;
+         dip::uint index = measurement.FeatureIndex( feature->information.name );
+         columns[ jj ] = static_cast< dip::sint >( measurement.Features()[ index ].startColumn );
+      }
+      // Objects are independent, we distribute them over threads for the features that allow it.
+      // The other features are measured in a second, single-threaded pass.
+      dip::uint nObjects = chainCodeArray.size();
+      for( bool parallelPass : { true, false } ) {
+         if( parallelPass ? !doParallel : !doSequential ) {
+            continue;
          }
-         for( auto const& feature : featureArray ) {
-            if( feature->type == Feature::Type::CHAINCODE_BASED ) {
-               auto cell = itObj[ feature->information.name ];
-               dynamic_cast< Feature::ChainCodeBased* >( feature )->Measure( *itCC, cell.data() );
-            } else if( feature->type == Feature::Type::POLYGON_BASED ) {
-               auto cell = itObj[ feature->information.name ];
-               dynamic_cast< Feature::PolygonBased* >( feature )->Measure( polygon, cell.data() );
-            } else if( feature->type == Feature::Type::CONVEXHULL_BASED ) {
-               auto cell = itObj[ feature->information.name ];
-               dynamic_cast< Feature::ConvexHullBased* >( feature )->Measure( convexHull, cell.data() );
+         bool needPolygon = false;
+         bool needConvHull = false;
+         for( dip::uint jj = 0; jj < featureArray.size(); ++jj ) {
+            if( threadSafe[ jj ] == parallelPass ) {
+               needPolygon |= ( featureArray[ jj ]->type == Feature::Type::POLYGON_BASED ) ||
+                              ( featureArray[ jj ]->type == Feature::Type::CONVEXHULL_BASED );
+               needConvHull |= featureArray[ jj ]->type == Feature::Type::CONVEXHULL_BASED;
+            }
+         }
+         dip::uint nThreads = ( !parallelPass || ( nObjects < 100 )) ? 1 : GetNumberOfThreads();
+         std::exception_ptr exception;
+         #ifdef _OPENMP
+         #pragma omp parallel for num_threads( static_cast< int >( nThreads )) schedule( dynamic, 16 )
+         #endif
+         for( dip::sint ii = 0; ii < static_cast< dip::sint >( nObjects ); ++ii ) {
+            try {
+               ChainCode const& chainCode = chainCodeArray[ static_cast< dip::uint >( ii ) ];
+               Measurement::ValueIterator row = measurement.Data() + ii * measurement.Stride();
+               Polygon polygon;
+               ConvexHull convexHull;
+               if( needPolygon ) {
+                  polygon = chainCode.Polygon();
+               }
+               if( needConvHull ) {
+                  convexHull = polygon.ConvexHull();
+               }
+               for( dip::uint jj = 0; jj < featureArray.size(); ++jj ) {
+                  if( threadSafe[ jj ] != parallelPass ) {
+                     continue;
+                  }
+                  Feature::Base* feature = featureArray[ jj ];
+                  if( feature->type == Feature::Type::CHAINCODE_BASED ) {
+                     dynamic_cast< Feature::ChainCodeBased* >( feature )->Measure( chainCode, row + columns[ jj ] );
+                  } else if( feature->type == Feature::Type::POLYGON_BASED ) {
+                     dynamic_cast< Feature::PolygonBased* >( feature )->Measure( polygon, row + columns[ jj ] );
+                  } else if( feature->type == Feature::Type::CONVEXHULL_BASED ) {
+                     dynamic_cast< Feature::ConvexHullBased* >( feature )->Measure( convexHull, row + columns[ jj ] );
+                  }
+               }
+            } catch( ... ) {
+               #ifdef _OPENMP
+               #pragma omp critical( dip__MeasureChainCodeException )
+               #endif
+               if( !exception ) {
+                  exception = std::current_exception();
+               }
             }
          }
-      } while( ++itCC, ++itObj );
+         if( exception ) {
+            std::rethrow_exception( exception );
+         }
+      }
    }
 
    // Let the composite functions do their work
@@ -412,3 +566,124 @@ std::ostream& operator<<(
 
 
 } // namespace dip
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+#include "diplib/generation.h"
+#include "diplib/random.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the ObjectIdToIndexMap") {
+   dip::ObjectIdToIndexMap dense;
+   for( dip::uint ii = 0; ii < 1000; ++ii ) {
+      DOCTEST_CHECK( dense.emplace( ii + 1, ii ).second );
+   }
+   DOCTEST_CHECK( dense.IsDense() );
+   DOCTEST_CHECK( !dense.emplace( 5, 0 ).second );
+   DOCTEST_CHECK( dense.size() == 1000 );
+   DOCTEST_CHECK( dense.find( 5 )->second == 4 );
+   DOCTEST_CHECK( dense.find( 1000 )->second == 999 );
+   DOCTEST_CHECK( dense.count( 0 ) == 0 );
+   DOCTEST_CHECK( dense.count( 1001 ) == 0 );
+   DOCTEST_CHECK( dense.find( 100000 ) == dense.end() );
+
+   dip::ObjectIdToIndexMap sparse;
+   for( dip::uint ii = 0; ii < 1000; ++ii ) {
+      DOCTEST_CHECK( sparse.emplace( ii * 7919 + 3, ii ).second );
+   }
+   DOCTEST_CHECK( !sparse.IsDense() );
+   DOCTEST_CHECK( !sparse.emplace( 3, 0 ).second );
+   DOCTEST_CHECK( sparse.size() == 1000 );
+   bool allFound = true;
+   for( dip::uint ii = 0; ii < 1000; ++ii ) {
+      auto it = sparse.find( ii * 7919 + 3 );
+      allFound &= ( it != sparse.end() ) && ( it->second == ii );
+   }
+   DOCTEST_CHECK( allFound );
+   DOCTEST_CHECK( sparse.count( 4 ) == 0 );
+   DOCTEST_CHECK( sparse.begin()->first == 3 );
+}
+
+DOCTEST_TEST_CASE("[DIPlib] testing the multithreaded MeasurementTool::Measure") {
+   dip::Random random( 0 );
+   dip::Image grey{ dip::UnsignedArray{ 400, 300 }, 1, dip::DT_SFLOAT };
+   grey.Fill( 0 );
+   dip::UniformNoise( grey, grey, random );
+   dip::Image label = dip::Label( grey > 0.6, 2 );
+   dip::MeasurementTool tool;
+   dip::StringArray features{ "Size", "Center", "CartesianBox", "Mean", "Statistics", "MinVal", "Mu", "Perimeter", "Feret" };
+   dip::uint nThreads = dip::GetNumberOfThreads();
+   dip::SetNumberOfThreads( 1 );
+   dip::Measurement serial = tool.Measure( label, grey, features );
+   dip::SetNumberOfThreads( 4 );
+   dip::Measurement parallel = tool.Measure( label, grey, features );
+   dip::SetNumberOfThreads( nThreads );
+   DOCTEST_REQUIRE( serial.NumberOfObjects() > 100 );
+   DOCTEST_REQUIRE( serial.NumberOfObjects() == parallel.NumberOfObjects() );
+   DOCTEST_REQUIRE( serial.NumberOfValues() == parallel.NumberOfValues() );
+   dip::uint n = serial.NumberOfObjects() * serial.NumberOfValues();
+   dip::uint nDifferent = 0;
+   for( dip::uint ii = 0; ii < n; ++ii ) {
+      dip::dfloat a = serial.Data()[ ii ];
+      dip::dfloat b = parallel.Data()[ ii ];
+      if(( std::isnan( a ) != std::isnan( b )) || ( std::abs( a - b ) > 1e-9 * std::max( 1.0, std::abs( a )))) {
+         ++nDifferent;
+      }
+   }
+   DOCTEST_CHECK( nDifferent == 0 );
+}
+
+namespace {
+
+// Numbers the objects in the order in which they are measured: not thread-safe
+class FeatureCallOrder : public dip::Feature::ChainCodeBased {
+   public:
+      FeatureCallOrder() : ChainCodeBased( { "CallOrder", "Order in which objects are measured", false } ) {};
+      virtual dip::Feature::ValueInformationArray Initialize( dip::Image const&, dip::Image const&, dip::uint ) override {
+         count_ = 0;
+         dip::Feature::ValueInformationArray out( 1 );
+         out[ 0 ].name = "CallOrder";
+         return out;
+      }
+      virtual void Measure( dip::ChainCode const&, dip::Measurement::ValueIterator output ) override {
+         *output = static_cast< dip::dfloat >( count_ );
+         ++count_;
+      }
+   private:
+      dip::uint count_ = 0;
+};
+
+} // namespace
+
+DOCTEST_TEST_CASE("[DIPlib] testing MeasurementTool::Measure with a feature that is not thread-safe") {
+   dip::Random random( 0 );
+   dip::Image grey{ dip::UnsignedArray{ 400, 300 }, 1, dip::DT_SFLOAT };
+   grey.Fill( 0 );
+   dip::UniformNoise( grey, grey, random );
+   dip::Image label = dip::Label( grey > 0.6, 2 );
+   dip::MeasurementTool tool;
+   tool.Register( dip::Feature::Pointer( new FeatureCallOrder ));
+   dip::uint nThreads = dip::GetNumberOfThreads();
+   dip::SetNumberOfThreads( 1 );
+   dip::Measurement serial = tool.Measure( label, {}, { "Perimeter" } );
+   dip::SetNumberOfThreads( 4 );
+   dip::Measurement msr = tool.Measure( label, {}, { "CallOrder", "Perimeter" } );
+   dip::SetNumberOfThreads( nThreads );
+   DOCTEST_REQUIRE( msr.NumberOfObjects() > 100 );
+   // The feature that is not thread-safe sees all objects in sequence
+   dip::Measurement::IteratorFeature callOrder = msr[ "CallOrder" ];
+   dip::Measurement::IteratorFeature perimeter = msr[ "Perimeter" ];
+   dip::Measurement::IteratorFeature serialPerimeter = serial[ "Perimeter" ];
+   auto it = callOrder.FirstObject();
+   auto pIt = perimeter.FirstObject();
+   auto sIt = serialPerimeter.FirstObject();
+   bool inOrder = true;
+   bool samePerimeter = true;
+   for( dip::uint ii = 0; it; ++ii, ++it, ++pIt, ++sIt ) {
+      inOrder &= *it == static_cast< dip::dfloat >( ii );
+      samePerimeter &= *pIt == *sIt;
+   }
+   DOCTEST_CHECK( inOrder );
+   DOCTEST_CHECK( samePerimeter );
+}
+
+#endif // DIP__ENABLE_DOCTEST
@@ -1215,6 +1215,23 @@ DOCTEST_TEST_CASE("[DIPlib] testing the basic morphological filters") {
    DOCTEST_CHECK( dip::Count( out ) == 1 ); // Did the erosion return the image to a single pixel?
    DOCTEST_CHECK( out.At( 32, 20 ) == pval ); // Is the main pixel in the right place and with the right value?
 
+   // Grey-value SE morphology -- mirroring an SE that is not point-symmetric also mirrors its grey values
+   seImg = dip::Image( { 5, 1 }, 1, dip::DT_SFLOAT );
+   for( dip::uint ii = 0; ii < 5; ++ii ) {
+      seImg.At( ii, 0 ) = -static_cast< dip::sint >( ii );
+   }
+   se = seImg;
+   dip::detail::BasicMorphology( in, out, se, {}, dip::detail::BasicMorphologyOperation::DILATION );
+   for( dip::uint ii = 0; ii < 5; ++ii ) {
+      DOCTEST_CHECK( out.At( 34 - ii, 20 ) == pval - ii );
+   }
+   se.Mirror();
+   dip::detail::BasicMorphology( in, out, se, {}, dip::detail::BasicMorphologyOperation::DILATION );
+   for( dip::uint ii = 0; ii < 5; ++ii ) {
+      DOCTEST_CHECK( out.At( 30 + ii, 20 ) == pval - ii );
+   }
+   DOCTEST_CHECK( dip::Sum( out ).As< dip::uint >() == 5 * pval - 10 );
+
    // Line morphology
    se = {{ 10, 4 }, "discrete line" };
    dip::detail::BasicMorphology( in, out, se, {}, dip::detail::BasicMorphologyOperation::DILATION );
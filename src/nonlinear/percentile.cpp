@@ -28,39 +28,185 @@ namespace dip {
 
 namespace {
 
+// For 8-bit and 16-bit unsigned integer images we keep a histogram of the values in the neighborhood
+template< typename TPI >
+struct UseHistogram {
+   static constexpr bool value = std::is_same< TPI, uint8 >::value || std::is_same< TPI, uint16 >::value;
+};
+
+// A strict weak ordering that sorts NaN values to the end, `std::less` is not a strict weak ordering for
+// floating-point values. For integer types this reduces to `a < b`.
+template< typename TPI >
+inline bool PercentileLess( TPI a, TPI b ) {
+   return ( a < b ) || (( b != b ) && ( a == a ));
+}
+
+// Equality that is compatible with `PercentileLess`.
+template< typename TPI >
+inline bool PercentileEqual( TPI a, TPI b ) {
+   return ( a == b ) || (( a != a ) && ( b != b ));
+}
+
 template< typename TPI >
 class PercentileLineFilter : public Framework::FullLineFilter {
    public:
       PercentileLineFilter( dfloat percentile ) : fraction_( percentile / 100.0 ) {}
       void SetNumberOfThreads( dip::uint threads ) override {
          buffers_.resize( threads );
+         histograms_.resize( threads );
       }
       virtual void Filter( Framework::FullLineFilterParameters const& params ) override {
+         PixelTableOffsets const& pixelTable = params.pixelTable;
+         dip::uint N = pixelTable.NumberOfPixels();
+         dip::uint rank = std::min( static_cast< dip::uint >( static_cast< dfloat >( N ) * fraction_ ), N - 1 );
+         FilterLine( params, rank, std::integral_constant< bool, UseHistogram< TPI >::value >() );
+      }
+   private:
+      // Per-thread buffers for the non-histogram code paths
+      struct ThreadBuffers {
+         std::vector< TPI > window;    // the values in the neighborhood, sorted
+         std::vector< TPI > newWindow; // the values in the neighborhood for the next pixel
+         std::vector< TPI > outgoing;  // the values that leave the neighborhood
+         std::vector< TPI > incoming;  // the values that enter the neighborhood
+      };
+
+      dfloat fraction_;
+      std::vector< ThreadBuffers > buffers_;
+      std::vector< std::vector< dip::uint >> histograms_;
+
+      // Sliding histogram (Huang's algorithm): for each pixel along the line, the values at the start of
+      // each pixel table run are removed from the histogram, and the values just past the end of each run are
+      // added. We keep track of the current output value and the number of values smaller than it, and move
+      // the output value up or down until it has the right rank. The cost per pixel is proportional to the
+      // number of runs rather than to the number of pixels in the neighborhood.
+      void FilterLine( Framework::FullLineFilterParameters const& params, dip::uint rank, std::true_type ) {
          TPI* in = static_cast< TPI* >( params.inBuffer.buffer );
          dip::sint inStride = params.inBuffer.stride;
          TPI* out = static_cast< TPI* >( params.outBuffer.buffer );
          dip::sint outStride = params.outBuffer.stride;
          dip::uint length = params.bufferLength;
          PixelTableOffsets const& pixelTable = params.pixelTable;
-         dip::uint N = pixelTable.NumberOfPixels();
-         buffers_[ params.thread ].resize( N );
-         dip::sint rank = static_cast< dip::sint >( static_cast< dfloat >( N ) * fraction_ );
+         std::vector< dip::uint >& histogram = histograms_[ params.thread ];
+         if( histogram.empty() ) {
+            histogram.resize( static_cast< dip::uint >( std::numeric_limits< TPI >::max() ) + 1, 0 );
+         }
+         // Fill the histogram for the first pixel. We start the search at the middle of the value range.
+         // The histogram is empty at the start of each line, we leave it empty at the end.
+         TPI value = std::numeric_limits< TPI >::max() / 2;
+         dip::uint below = 0; // number of pixels in the neighborhood with a value smaller than `value`
+         for( auto offset : pixelTable ) {
+            TPI v = in[ offset ];
+            ++histogram[ v ];
+            below += v < value;
+         }
          for( dip::uint ii = 0; ii < length; ++ii ) {
-            TPI* buffer = buffers_[ params.thread ].data();
-            for( auto offset : pixelTable ) {
-               *buffer = in[ offset ];
-               ++buffer;
+            if( ii > 0 ) {
+               for( auto run : pixelTable.Runs() ) {
+                  TPI v = in[ run.offset ];
+                  --histogram[ v ];
+                  below -= v < value;
+                  v = in[ run.offset + static_cast< dip::sint >( run.length ) * inStride ];
+                  ++histogram[ v ];
+                  below += v < value;
+               }
+               in += inStride;
+            }
+            // Find the value with the requested rank, starting at the previous one
+            while( below > rank ) {
+               --value;
+               below -= histogram[ value ];
+            }
+            while( below + histogram[ value ] <= rank ) {
+               below += histogram[ value ];
+               ++value;
+            }
+            *out = value;
+            out += outStride;
+         }
+         // Empty the histogram
+         for( auto offset : pixelTable ) {
+            --histogram[ in[ offset ]];
+         }
+      }
+
+      // For other data types we keep a sorted array of the values in the neighborhood. For each pixel along
+      // the line, the values that leave and enter the neighborhood (one of each per pixel table run) are sorted,
+      // and merged with the sorted array in a single linear pass. This is cheaper than a selection algorithm
+      // on a copy of the neighborhood when there are few runs compared to the number of pixels. Otherwise we
+      // do use selection.
+      void FilterLine( Framework::FullLineFilterParameters const& params, dip::uint rank, std::false_type ) {
+         TPI* in = static_cast< TPI* >( params.inBuffer.buffer );
+         dip::sint inStride = params.inBuffer.stride;
+         TPI* out = static_cast< TPI* >( params.outBuffer.buffer );
+         dip::sint outStride = params.outBuffer.stride;
+         dip::uint length = params.bufferLength;
+         PixelTableOffsets const& pixelTable = params.pixelTable;
+         dip::uint N = pixelTable.NumberOfPixels();
+         dip::uint nRuns = pixelTable.Runs().size();
+         ThreadBuffers& buffers = buffers_[ params.thread ];
+         std::vector< TPI >& window = buffers.window;
+         window.resize( N );
+         if( nRuns * 8 > N ) {
+            for( dip::uint ii = 0; ii < length; ++ii ) {
+               TPI* buffer = window.data();
+               for( auto offset : pixelTable ) {
+                  *buffer = in[ offset ];
+                  ++buffer;
+               }
+               auto ourGuy = window.begin() + static_cast< dip::sint >( rank );
+               std::nth_element( window.begin(), ourGuy, window.end(), PercentileLess< TPI > );
+               *out = *ourGuy;
+               in += inStride;
+               out += outStride;
+            }
+            return;
+         }
+         std::vector< TPI >& newWindow = buffers.newWindow;
+         std::vector< TPI >& outgoing = buffers.outgoing;
+         std::vector< TPI >& incoming = buffers.incoming;
+         newWindow.resize( N );
+         outgoing.resize( nRuns );
+         incoming.resize( nRuns );
+         TPI* buffer = window.data();
+         for( auto offset : pixelTable ) {
+            *buffer = in[ offset ];
+            ++buffer;
+         }
+         std::sort( window.begin(), window.end(), PercentileLess< TPI > );
+         *out = window[ rank ];
+         for( dip::uint ii = 1; ii < length; ++ii ) {
+            dip::uint jj = 0;
+            for( auto run : pixelTable.Runs() ) {
+               outgoing[ jj ] = in[ run.offset ];
+               incoming[ jj ] = in[ run.offset + static_cast< dip::sint >( run.length ) * inStride ];
+               ++jj;
+            }
+            std::sort( outgoing.begin(), outgoing.end(), PercentileLess< TPI > );
+            std::sort( incoming.begin(), incoming.end(), PercentileLess< TPI > );
+            // Merge: copy `window` to `newWindow`, skipping the `outgoing` values and inserting the `incoming` values
+            auto oIt = outgoing.begin();
+            auto iIt = incoming.begin();
+            auto dest = newWindow.begin();
+            for( TPI v : window ) {
+               if(( oIt != outgoing.end() ) && PercentileEqual( v, *oIt )) {
+                  ++oIt;
+                  continue;
+               }
+               while(( iIt != incoming.end() ) && PercentileLess( *iIt, v )) {
+                  *dest = *iIt;
+                  ++dest;
+                  ++iIt;
+               }
+               *dest = v;
+               ++dest;
             }
-            auto ourGuy = buffers_[ params.thread ].begin() + rank;
-            std::nth_element( buffers_[ params.thread ].begin(), ourGuy, buffers_[ params.thread ].end() );
-            *out = *ourGuy;
+            std::copy( iIt, incoming.end(), dest );
+            window.swap( newWindow );
             in += inStride;
             out += outStride;
+            *out = window[ rank ];
          }
       }
-   private:
-      dfloat fraction_;
-      std::vector< std::vector< TPI >> buffers_;
 };
 
 } // namespace
@@ -85,3 +231,36 @@ void PercentileFilter(
 }
 
 } // namespace dip
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+#include "diplib/generation.h"
+#include "diplib/testing.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing the percentile filter") {
+   dip::Image img{ dip::UnsignedArray{ 60, 45 }, 1, dip::DT_SFLOAT };
+   img.Fill( 120.0 );
+   dip::Random random( 0 );
+   dip::GaussianNoise( img, img, random, 900.0 );
+   dip::Image img8 = dip::Convert( img, dip::DT_UINT8 );
+   img = dip::Convert( img8, dip::DT_SFLOAT );
+   dip::Image img16 = dip::Convert( img * 200, dip::DT_UINT16 );
+   // Disk-shaped kernel: histogram for integer images, sorted window for float images
+   dip::Kernel disk( dip::FloatArray{ 11 }, "elliptic" );
+   dip::Image out8 = dip::PercentileFilter( img8, 30.0, disk );
+   dip::Image outF = dip::PercentileFilter( img, 30.0, disk );
+   DOCTEST_CHECK( dip::testing::CompareImages( dip::Convert( out8, dip::DT_SFLOAT ), outF ));
+   dip::Image out16 = dip::PercentileFilter( img16, 30.0, disk );
+   DOCTEST_CHECK( dip::testing::CompareImages( dip::Convert( out16, dip::DT_SFLOAT ), outF * 200 ));
+   // A kernel with many short runs: selection for float images
+   dip::Kernel line( dip::FloatArray{ 1, 7 }, "rectangular" );
+   out8 = dip::MedianFilter( img8, line );
+   outF = dip::MedianFilter( img, line );
+   DOCTEST_CHECK( dip::testing::CompareImages( dip::Convert( out8, dip::DT_SFLOAT ), outF ));
+   // Extreme percentiles
+   out8 = dip::PercentileFilter( img8, 100.0, disk );
+   outF = dip::PercentileFilter( img, 100.0, disk );
+   DOCTEST_CHECK( dip::testing::CompareImages( dip::Convert( out8, dip::DT_SFLOAT ), outF ));
+}
+
+#endif // DIP__ENABLE_DOCTEST
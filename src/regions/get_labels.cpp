@@ -1,6 +1,6 @@
 /*
  * DIPlib 3.0
- * This file contains the definition for the GetObjectLabels function.
+ * This file contains the definition for the GetObjectLabels and SmallObjectsRemove functions.
  *
  * (c)2016-2017, Cris Luengo.
  * Based on original DIPlib code: (c)1995-2014, Delft University of Technology.
@@ -22,9 +22,9 @@
 
 #include "diplib.h"
 #include "diplib/regions.h"
-#include "diplib/measurement.h"
 #include "diplib/framework.h"
 #include "diplib/overload.h"
+#include "map_labels.h"
 
 namespace dip {
 
@@ -69,6 +69,39 @@ class dip__GetLabels : public Framework::ScanLineFilter {
       LabelSet& objectIDs;
 };
 
+template< typename TPI >
+class dip__CountLabels : public Framework::ScanLineFilter {
+   public:
+      virtual void Filter( Framework::ScanLineFilterParameters const& params ) override {
+         TPI const* data = static_cast< TPI const* >( params.inBuffer[ 0 ].buffer );
+         dip::sint stride = params.inBuffer[ 0 ].stride;
+         dip::uint bufferLength = params.bufferLength;
+         // If the label is equal to the previous one, we don't look it up again
+         dip::uint objectID = static_cast< dip::uint >( *data );
+         dip::uint index = Index( objectID );
+         for( dip::uint ii = 0; ii < bufferLength; ++ii ) {
+            dip::uint id = static_cast< dip::uint >( *data );
+            if( id != objectID ) {
+               objectID = id;
+               index = Index( objectID );
+            }
+            ++sizes[ index ];
+            data += stride;
+         }
+      }
+      dip__CountLabels( ObjectIdToIndexMap& objects, std::vector< dip::uint >& sizes ) : objects( objects ), sizes( sizes ) {}
+   private:
+      ObjectIdToIndexMap& objects; // maps labels to indices into `sizes`
+      std::vector< dip::uint >& sizes;
+      dip::uint Index( dip::uint objectID ) {
+         auto res = objects.emplace( objectID, sizes.size() );
+         if( res.second ) {
+            sizes.push_back( 0 );
+         }
+         return res.first->second;
+      }
+};
+
 UnsignedArray GetObjectLabels(
       Image const& label,
       Image const& mask,
@@ -134,12 +167,21 @@ void SmallObjectsRemove(
       Image tmp = Label( in, connectivity, threshold, 0 );
       NotEqual( tmp, Image( 0, tmp.DataType() ), out );
    } else if( in.DataType().IsUnsigned() ) {
-      MeasurementTool msr;
-      Measurement sizes = msr.Measure( in, {}, { "Size" }, {}, 1 );
-      // TODO: It would be more efficient to copy the ObjectToMeasurement function, and make a LUT that does all of the following in a single pass through the image.
-      Image tmp = ObjectToMeasurement( in, sizes[ "Size" ] );
-      tmp = tmp >= threshold;
-      MultiplySampleWise( in, tmp, out, in.DataType() );
+      DIP_THROW_IF( !in.IsScalar(), E::IMAGE_NOT_SCALAR );
+      // The tables grow with the number of objects, not with the value of the largest label
+      ObjectIdToIndexMap objects;
+      std::vector< dip::uint > sizes;
+      std::unique_ptr< Framework::ScanLineFilter >scanLineFilter;
+      DIP_OVL_NEW_UINT( scanLineFilter, dip__CountLabels, ( objects, sizes ), in.DataType() );
+      ImageRefArray outar{};
+      Framework::Scan( { in }, outar, { in.DataType() }, {}, {}, {}, *scanLineFilter, Framework::Scan_NoMultiThreading );
+      ObjectIdToIndexMap map;
+      for( auto const& object : objects ) {
+         if(( object.first != 0 ) && ( sizes[ object.second ] >= threshold )) {
+            map.emplace( object.first, object.first );
+         }
+      }
+      DIP_STACK_TRACE_THIS( MapLabels( in, out, map ));
    } else {
       DIP_THROW( E::DATA_TYPE_NOT_SUPPORTED );
    }
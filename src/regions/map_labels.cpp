@@ -0,0 +1,203 @@
+/*
+ * DIPlib 3.0
+ * This file contains the definition for the MapLabels and Relabel functions.
+ *
+ * (c)2026, DIPlib contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "diplib.h"
+#include "diplib/regions.h"
+#include "diplib/framework.h"
+#include "diplib/overload.h"
+#include "map_labels.h"
+
+namespace dip {
+
+namespace {
+
+template< typename TPI >
+class dip__MapLabels : public Framework::ScanLineFilter {
+   public:
+      virtual void Filter( Framework::ScanLineFilterParameters const& params ) override {
+         TPI const* in = static_cast< TPI const* >( params.inBuffer[ 0 ].buffer );
+         dip::sint inStride = params.inBuffer[ 0 ].stride;
+         TPI* out = static_cast< TPI* >( params.outBuffer[ 0 ].buffer );
+         dip::sint outStride = params.outBuffer[ 0 ].stride;
+         dip::uint bufferLength = params.bufferLength;
+         dip::uint mapSize = map_.size();
+         TPI const* map = map_.data();
+         for( dip::uint ii = 0; ii < bufferLength; ++ii ) {
+            dip::uint index = static_cast< dip::uint >( *in );
+            *out = index < mapSize ? map[ index ] : TPI( 0 );
+            in += inStride;
+            out += outStride;
+         }
+      }
+      dip__MapLabels( UnsignedArray const& map ) : map_( map.size() ) {
+         for( dip::uint ii = 0; ii < map.size(); ++ii ) {
+            map_[ ii ] = clamp_cast< TPI >( map[ ii ] );
+         }
+      }
+   private:
+      std::vector< TPI > map_; // A copy in the image's data type, so the table is as compact as it can be
+};
+
+template< typename TPI >
+class dip__MapLabelsSparse : public Framework::ScanLineFilter {
+   public:
+      virtual void Filter( Framework::ScanLineFilterParameters const& params ) override {
+         TPI const* in = static_cast< TPI const* >( params.inBuffer[ 0 ].buffer );
+         dip::sint inStride = params.inBuffer[ 0 ].stride;
+         TPI* out = static_cast< TPI* >( params.outBuffer[ 0 ].buffer );
+         dip::sint outStride = params.outBuffer[ 0 ].stride;
+         dip::uint bufferLength = params.bufferLength;
+         // If the label is equal to the previous one, we don't look it up again
+         dip::uint objectID = 0;
+         TPI value = Lookup( objectID );
+         for( dip::uint ii = 0; ii < bufferLength; ++ii ) {
+            dip::uint id = static_cast< dip::uint >( *in );
+            if( id != objectID ) {
+               objectID = id;
+               value = Lookup( objectID );
+            }
+            *out = value;
+            in += inStride;
+            out += outStride;
+         }
+      }
+      dip__MapLabelsSparse( ObjectIdToIndexMap const& map ) : map_( map ) {}
+   private:
+      ObjectIdToIndexMap const& map_;
+      TPI Lookup( dip::uint objectID ) const {
+         auto it = map_.find( objectID );
+         return it == map_.end() ? TPI( 0 ) : clamp_cast< TPI >( it->second );
+      }
+};
+
+} // namespace
+
+void MapLabels(
+      Image const& label,
+      Image& out,
+      UnsignedArray const& map
+) {
+   DIP_THROW_IF( !label.IsForged(), E::IMAGE_NOT_FORGED );
+   DIP_THROW_IF( !label.IsScalar(), E::IMAGE_NOT_SCALAR );
+   DIP_THROW_IF( !label.DataType().IsUInt(), E::DATA_TYPE_NOT_SUPPORTED );
+   DataType dataType = label.DataType();
+   std::unique_ptr< Framework::ScanLineFilter >scanLineFilter;
+   DIP_OVL_NEW_UINT( scanLineFilter, dip__MapLabels, ( map ), dataType );
+   ImageRefArray outar{ out };
+   DIP_START_STACK_TRACE
+      Framework::Scan( { label }, outar, { dataType }, { dataType }, { dataType }, { 1 }, *scanLineFilter );
+   DIP_END_STACK_TRACE
+}
+
+void MapLabels(
+      Image const& label,
+      Image& out,
+      ObjectIdToIndexMap const& map
+) {
+   DIP_THROW_IF( !label.IsForged(), E::IMAGE_NOT_FORGED );
+   DIP_THROW_IF( !label.IsScalar(), E::IMAGE_NOT_SCALAR );
+   DIP_THROW_IF( !label.DataType().IsUInt(), E::DATA_TYPE_NOT_SUPPORTED );
+   DataType dataType = label.DataType();
+   std::unique_ptr< Framework::ScanLineFilter >scanLineFilter;
+   DIP_OVL_NEW_UINT( scanLineFilter, dip__MapLabelsSparse, ( map ), dataType );
+   ImageRefArray outar{ out };
+   DIP_START_STACK_TRACE
+      Framework::Scan( { label }, outar, { dataType }, { dataType }, { dataType }, { 1 }, *scanLineFilter );
+   DIP_END_STACK_TRACE
+}
+
+dip::uint Relabel(
+      Image const& label,
+      Image& out
+) {
+   DIP_THROW_IF( !label.IsForged(), E::IMAGE_NOT_FORGED );
+   UnsignedArray objects;
+   DIP_STACK_TRACE_THIS( objects = GetObjectLabels( label, {}, "exclude" ));
+   // `objects` is sorted. The map uses a look-up table only if the labels are compact
+   ObjectIdToIndexMap map;
+   for( dip::uint ii = 0; ii < objects.size(); ++ii ) {
+      map.emplace( objects[ ii ], ii + 1 );
+   }
+   DIP_STACK_TRACE_THIS( MapLabels( label, out, map ));
+   return objects.size();
+}
+
+} // namespace dip
+
+
+#ifdef DIP__ENABLE_DOCTEST
+#include "doctest.h"
+
+DOCTEST_TEST_CASE("[DIPlib] testing MapLabels and Relabel") {
+   dip::Image label( { 6, 4 }, 1, dip::DT_UINT16 );
+   label = 0;
+   label.At( 0, 0 ) = 3;
+   label.At( 1, 0 ) = 3;
+   label.At( 4, 1 ) = 10;
+   label.At( 2, 3 ) = 7;
+   label.At( 5, 3 ) = 200; // beyond the end of the map below
+   dip::Image out = dip::MapLabels( label, { 0, 1, 2, 5, 4, 5, 6, 0, 8, 9, 2 } );
+   DOCTEST_REQUIRE( out.DataType() == dip::DT_UINT16 );
+   DOCTEST_CHECK( out.At( 0, 0 ) == 5 );
+   DOCTEST_CHECK( out.At( 1, 0 ) == 5 );
+   DOCTEST_CHECK( out.At( 4, 1 ) == 2 );
+   DOCTEST_CHECK( out.At( 2, 3 ) == 0 );
+   DOCTEST_CHECK( out.At( 5, 3 ) == 0 );
+   DOCTEST_CHECK( out.At( 3, 2 ) == 0 );
+
+   dip::uint n = dip::Relabel( label, out );
+   DOCTEST_CHECK( n == 4 );
+   DOCTEST_CHECK( out.At( 0, 0 ) == 1 );
+   DOCTEST_CHECK( out.At( 2, 3 ) == 2 );
+   DOCTEST_CHECK( out.At( 4, 1 ) == 3 );
+   DOCTEST_CHECK( out.At( 5, 3 ) == 4 );
+   DOCTEST_CHECK( out.At( 3, 2 ) == 0 );
+
+   out = dip::SmallObjectsRemove( label, 2 );
+   DOCTEST_CHECK( out.At( 0, 0 ) == 3 );
+   DOCTEST_CHECK( out.At( 1, 0 ) == 3 );
+   DOCTEST_CHECK( out.At( 4, 1 ) == 0 );
+   DOCTEST_CHECK( out.At( 5, 3 ) == 0 );
+
+   // In-place operation
+   dip::Relabel( label, label );
+   DOCTEST_CHECK( label.At( 5, 3 ) == 4 );
+
+   // A few objects with very large labels
+   dip::Image large( { 6, 4 }, 1, dip::DT_UINT32 );
+   large = 0;
+   large.At( 0, 0 ) = 4000000000u;
+   large.At( 1, 0 ) = 4000000000u;
+   large.At( 4, 1 ) = 3000000000u;
+   large.At( 2, 3 ) = 5;
+   n = dip::Relabel( large, out );
+   DOCTEST_CHECK( n == 3 );
+   DOCTEST_CHECK( out.At( 0, 0 ) == 3 );
+   DOCTEST_CHECK( out.At( 1, 0 ) == 3 );
+   DOCTEST_CHECK( out.At( 4, 1 ) == 2 );
+   DOCTEST_CHECK( out.At( 2, 3 ) == 1 );
+   DOCTEST_CHECK( out.At( 3, 2 ) == 0 );
+   out = dip::SmallObjectsRemove( large, 2 );
+   DOCTEST_CHECK( out.At( 0, 0 ) == 4000000000u );
+   DOCTEST_CHECK( out.At( 1, 0 ) == 4000000000u );
+   DOCTEST_CHECK( out.At( 4, 1 ) == 0 );
+   DOCTEST_CHECK( out.At( 2, 3 ) == 0 );
+}
+
+#endif // DIP__ENABLE_DOCTEST
@@ -0,0 +1,35 @@
+/*
+ * DIPlib 3.0
+ * This file declares support functionality used by dip::Relabel and dip::SmallObjectsRemove.
+ *
+ * (c)2026, DIPlib contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DIP_MAP_LABELS_H
+#define DIP_MAP_LABELS_H
+
+#include "diplib.h"
+#include "diplib/measurement.h"
+
+namespace dip {
+
+// Like the public `dip::MapLabels`, but each object ID found in `map` is replaced by the value stored for it,
+// and all other labels are set to 0. The size of `map` depends on the number of objects, not on the value of
+// the largest label, so this can be used for images with few objects that have large labels.
+DIP_NO_EXPORT void MapLabels( Image const& label, Image& out, ObjectIdToIndexMap const& map );
+
+} // namespace dip
+
+#endif // DIP_MAP_LABELS_H
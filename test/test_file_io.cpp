@@ -3,8 +3,97 @@
 #include <diplib.h>
 #include <diplib/file_io.h>
 #include <diplib/generation.h>
+#include <diplib/statistics.h>
+#include <diplib/random.h>
+#include <diplib/multithreading.h>
 #include <diplib/testing.h>
 
+// Prints the result of a comparison. Failures are counted, the program returns an error code if there were any.
+int errorCount = 0;
+void Report( bool identical ) {
+   if( identical ) {
+      std::cout << "Identical\n\n";
+   } else {
+      std::cout << "!!!ERROR!!!\n\n";
+      ++errorCount;
+   }
+}
+
+#ifdef DIP__HAS_TIFF
+#include <tiffio.h>
+
+// Writes a 2D 8-bit image as a tiled TIFF file, which `dip::ImageWriteTIFF` doesn't do. The tiles do not evenly
+// divide the image.
+void WriteTiledTIFF( dip::Image const& image, char const* filename, std::uint16_t planarConfig, std::uint16_t compression ) {
+   std::uint32_t width = static_cast< std::uint32_t >( image.Size( 0 ));
+   std::uint32_t height = static_cast< std::uint32_t >( image.Size( 1 ));
+   std::uint16_t nSamples = static_cast< std::uint16_t >( image.TensorElements() );
+   std::uint32_t tileWidth = 48;
+   std::uint32_t tileLength = 32;
+   TIFF* tiff = TIFFOpen( filename, "w" );
+   TIFFSetField( tiff, TIFFTAG_IMAGEWIDTH, width );
+   TIFFSetField( tiff, TIFFTAG_IMAGELENGTH, height );
+   TIFFSetField( tiff, TIFFTAG_BITSPERSAMPLE, std::uint16_t( 8 ));
+   TIFFSetField( tiff, TIFFTAG_SAMPLESPERPIXEL, nSamples );
+   TIFFSetField( tiff, TIFFTAG_SAMPLEFORMAT, std::uint16_t( SAMPLEFORMAT_UINT ));
+   TIFFSetField( tiff, TIFFTAG_PHOTOMETRIC, std::uint16_t( nSamples == 3 ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK ));
+   TIFFSetField( tiff, TIFFTAG_PLANARCONFIG, planarConfig );
+   TIFFSetField( tiff, TIFFTAG_COMPRESSION, compression );
+   TIFFSetField( tiff, TIFFTAG_TILEWIDTH, tileWidth );
+   TIFFSetField( tiff, TIFFTAG_TILELENGTH, tileLength );
+   dip::uint nPlanes = planarConfig == PLANARCONFIG_CONTIG ? 1 : nSamples;
+   dip::uint samplesPerTile = planarConfig == PLANARCONFIG_CONTIG ? nSamples : 1;
+   std::vector< std::uint8_t > buffer( tileWidth * tileLength * samplesPerTile );
+   std::uint32_t tile = 0; // tiles are numbered by row within each plane
+   for( dip::uint plane = 0; plane < nPlanes; ++plane ) {
+      for( std::uint32_t y0 = 0; y0 < height; y0 += tileLength ) {
+         for( std::uint32_t x0 = 0; x0 < width; x0 += tileWidth ) {
+            std::fill( buffer.begin(), buffer.end(), std::uint8_t( 0 ));
+            for( std::uint32_t y = 0; ( y < tileLength ) && ( y0 + y < height ); ++y ) {
+               for( std::uint32_t x = 0; ( x < tileWidth ) && ( x0 + x < width ); ++x ) {
+                  dip::Image::Pixel pixel = image.At( x0 + x, y0 + y );
+                  for( dip::uint s = 0; s < samplesPerTile; ++s ) {
+                     buffer[ ( y * tileWidth + x ) * samplesPerTile + s ] = pixel[ plane + s ].As< std::uint8_t >();
+                  }
+               }
+            }
+            TIFFWriteEncodedTile( tiff, tile, buffer.data(), static_cast< tmsize_t >( buffer.size() ));
+            ++tile;
+         }
+      }
+   }
+   TIFFClose( tiff );
+}
+
+// Writes a 3D 8-bit scalar image as a multi-page TIFF file, one page per image plane, which `dip::ImageWriteTIFF`
+// doesn't do.
+void WriteMultiPageTIFF( dip::Image const& image, char const* filename ) {
+   std::uint32_t width = static_cast< std::uint32_t >( image.Size( 0 ));
+   std::uint32_t height = static_cast< std::uint32_t >( image.Size( 1 ));
+   std::vector< std::uint8_t > buffer( width * height );
+   TIFF* tiff = TIFFOpen( filename, "w" );
+   for( dip::uint z = 0; z < image.Size( 2 ); ++z ) {
+      TIFFSetField( tiff, TIFFTAG_IMAGEWIDTH, width );
+      TIFFSetField( tiff, TIFFTAG_IMAGELENGTH, height );
+      TIFFSetField( tiff, TIFFTAG_BITSPERSAMPLE, std::uint16_t( 8 ));
+      TIFFSetField( tiff, TIFFTAG_SAMPLESPERPIXEL, std::uint16_t( 1 ));
+      TIFFSetField( tiff, TIFFTAG_SAMPLEFORMAT, std::uint16_t( SAMPLEFORMAT_UINT ));
+      TIFFSetField( tiff, TIFFTAG_PHOTOMETRIC, std::uint16_t( PHOTOMETRIC_MINISBLACK ));
+      TIFFSetField( tiff, TIFFTAG_PLANARCONFIG, std::uint16_t( PLANARCONFIG_CONTIG ));
+      TIFFSetField( tiff, TIFFTAG_COMPRESSION, std::uint16_t( COMPRESSION_DEFLATE ));
+      TIFFSetField( tiff, TIFFTAG_ROWSPERSTRIP, height );
+      for( std::uint32_t y = 0; y < height; ++y ) {
+         for( std::uint32_t x = 0; x < width; ++x ) {
+            buffer[ y * width + x ] = image.At( x, y, z ).As< std::uint8_t >();
+         }
+      }
+      TIFFWriteEncodedStrip( tiff, 0, buffer.data(), static_cast< tmsize_t >( buffer.size() ));
+      TIFFWriteDirectory( tiff );
+   }
+   TIFFClose( tiff );
+}
+#endif
+
 int main() {
 
    // Test ICS, 3D grey-value
@@ -20,7 +109,7 @@ int main() {
    dip::Image result = dip::ImageReadICS( "test1", dip::RangeArray{}, {} );
    timer.Stop();
    std::cout << "Reading: " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
 
    timer.Reset();
    dip::ImageWriteICS( image, "test1f.ics", { "line1", "line2 is good" }, 7, { "v1", "gzip", "fast" } );
@@ -30,19 +119,46 @@ int main() {
    result = dip::ImageReadICS( "test1f", dip::RangeArray{}, {}, "fast" );
    timer.Stop();
    std::cout << "Reading (fast): " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
 
    timer.Reset();
    result = dip::ImageReadICS( "test1f", dip::RangeArray{}, {} );
    timer.Stop();
    std::cout << "Reading (fast file): " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
 
    timer.Reset();
    result = dip::ImageReadICS( "test1", dip::RangeArray{}, {}, "fast" );
    timer.Stop();
    std::cout << "Reading (fast, regular file): " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
+
+   timer.Reset();
+   dip::ImageWriteICS( image, "test1u.ics", { "line1", "line2 is good" }, 7, { "v2", "uncompressed" } );
+   timer.Stop();
+   std::cout << "Writing (uncompressed): " << timer << std::endl;
+   timer.Reset();
+   result = dip::ImageReadICS( "test1u", dip::RangeArray{}, {}, "mmap" );
+   timer.Stop();
+   std::cout << "Reading (mmap): " << timer << std::endl;
+   Report( dip::testing::CompareImages( image, result ));
+
+   // A mapped image refers to the data in the file, its strides are those of the file, not those of a copy
+   dip::RangeArray roi{ dip::Range{ 10, 50, 2 }, dip::Range{ 40, 5, 5 }, dip::Range{} };
+   result = dip::ImageReadICS( "test1u", roi, {}, "mmap" );
+   std::cout << "Reading ROI, mirrored (mmap): " << result;
+   Report( dip::testing::CompareImages( image.At( roi ), result ) &&
+           ( result.Stride( 0 ) == 2 ) && ( result.Stride( 1 ) == -5 * image.Stride( 1 )));
+   dip::Image tensorImage{ image.Sizes(), 3, image.DataType() };
+   tensorImage[ 0 ].Copy( image );
+   tensorImage[ 1 ].Copy( image.At( dip::Range{ -1, 0 }, dip::Range{}, dip::Range{} ));
+   tensorImage[ 2 ].Copy( image.At( dip::Range{}, dip::Range{ -1, 0 }, dip::Range{} ));
+   dip::ImageWriteICS( tensorImage, "test3u.ics", {}, 7, { "v2", "uncompressed" } );
+   result = dip::ImageReadICS( "test3u", roi, dip::Range{ 0, 2, 2 }, "mmap" );
+   std::cout << "Reading ROI and channel subset (mmap): " << result;
+   dip::Image channels = tensorImage[ dip::Range{ 0, 2, 2 } ];
+   Report( dip::testing::CompareImages( channels.At( roi ), result ) && ( result.Stride( 0 ) == 2 ) &&
+           ( result.TensorStride() == 2 * static_cast< dip::sint >( image.NumberOfPixels() )));
 
    // Turn it on its side so the image to write has non-standard strides
    std::cout << "\nTEST ICS -- non-standard strides\n\n";
@@ -56,7 +172,7 @@ int main() {
    result = dip::ImageReadICS( "test2", dip::RangeArray{}, {} );
    timer.Stop();
    std::cout << "Reading: " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
 
    timer.Reset();
    dip::ImageWriteICS( image, "test2f.ics", { "key\tvalue" }, 7, { "v1", "gzip", "fast" } );
@@ -66,19 +182,24 @@ int main() {
    result = dip::ImageReadICS( "test2f", dip::RangeArray{}, {}, "fast" );
    timer.Stop();
    std::cout << "Reading (fast): " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
 
    timer.Reset();
    result = dip::ImageReadICS( "test2f", dip::RangeArray{}, {} );
    timer.Stop();
    std::cout << "Reading (fast file): " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
 
    timer.Reset();
    result = dip::ImageReadICS( "test2", dip::RangeArray{}, {}, "fast" );
    timer.Stop();
    std::cout << "Reading (fast, regular file): " << timer << std::endl;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
+
+   dip::ImageWriteICS( image, "test2u.ics", {}, 7, { "v2", "uncompressed", "fast" } );
+   result = dip::ImageReadICS( "test2u", dip::RangeArray{}, {}, "mmap" );
+   std::cout << "Reading (mmap, fast file): " << result;
+   Report( dip::testing::CompareImages( image, result ) && ( result.Strides() == image.Strides() ));
 
    // Test TIFF, 2D grey-value
 
@@ -96,7 +217,7 @@ int main() {
    timer.Stop();
    std::cout << "Reading: " << timer << std::endl;
    std::cout << "Image read back: " << result;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
 
    // Try reading it into an image with non-standard strides
    timer.Reset();
@@ -110,7 +231,17 @@ int main() {
    timer.Stop();
    std::cout << "Reading: " << timer << std::endl;
    std::cout << "Image read back into non-standard strides: " << result;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
+
+   timer.Reset();
+   dip::ImageWriteICS( image, "test1u.ics", { "line1", "line2 is good" }, 7, { "v2", "uncompressed" } );
+   timer.Stop();
+   std::cout << "Writing (uncompressed): " << timer << std::endl;
+   timer.Reset();
+   result = dip::ImageReadICS( "test1u", dip::RangeArray{}, {}, "mmap" );
+   timer.Stop();
+   std::cout << "Reading (mmap): " << timer << std::endl;
+   Report( dip::testing::CompareImages( image, result ));
 
    // Turn it on its side so the image to write has non-standard strides
    image.SwapDimensions( 0, 1 );
@@ -124,7 +255,136 @@ int main() {
    timer.Stop();
    std::cout << "Reading: " << timer << std::endl;
    std::cout << "Image read back: " << result;
-   std::cout << ( dip::testing::CompareImages( image, result ) ? "Identical\n\n" : "!!!ERROR!!!\n\n" );
+   Report( dip::testing::CompareImages( image, result ));
+
+   // Read a series of files, all at once and one at a time
+   dip::StringArray filenames( 20, "test2.tif" );
+   timer.Reset();
+   result = dip::ImageReadTIFFSeries( filenames );
+   timer.Stop();
+   std::cout << "Reading series: " << timer << std::endl;
+   std::cout << "Image read back: " << result;
+   dip::Image slice = result.At( dip::Range{}, dip::Range{}, dip::Range{ 13 } );
+   slice.Squeeze();
+   Report( dip::testing::CompareImages( image, slice ));
+   bool identical = true;
+   timer.Reset();
+   dip::ImageReadTIFFSeries( filenames, [ & ]( dip::Image& plane, dip::uint ) {
+      identical &= dip::testing::CompareImages( image, plane );
+   } );
+   timer.Stop();
+   std::cout << "Reading series one at a time: " << timer << std::endl;
+   Report( identical );
+
+#ifdef DIP__HAS_TIFF
+   // Tiled TIFF files, with contiguous and separate sample planes
+   std::cout << "\nTEST TIFF -- tiled\n\n";
+   image = dip::ImageReadICS( "../test/trui.ics" );
+   dip::Image color{ image.Sizes(), 3, image.DataType() };
+   color[ 0 ].Copy( image );
+   color[ 1 ].Copy( image.At( dip::Range{ -1, 0 }, dip::Range{} ));
+   color[ 2 ].Copy( image.At( dip::Range{}, dip::Range{ -1, 0 } ));
+   WriteTiledTIFF( image, "test3g.tif", PLANARCONFIG_CONTIG, COMPRESSION_DEFLATE );
+   WriteTiledTIFF( color, "test3c.tif", PLANARCONFIG_CONTIG, COMPRESSION_DEFLATE );
+   WriteTiledTIFF( color, "test3s.tif", PLANARCONFIG_SEPARATE, COMPRESSION_DEFLATE );
+   result = dip::ImageReadTIFF( "test3g" );
+   std::cout << "Grey-value, tiled: " << result;
+   Report( dip::testing::CompareImages( image, result ));
+   result = dip::ImageReadTIFF( "test3c" );
+   std::cout << "Color, tiled, contiguous samples: " << result;
+   Report( dip::testing::CompareImages( color, result ));
+   result = dip::ImageReadTIFF( "test3s" );
+   std::cout << "Color, tiled, separate sample planes: " << result;
+   Report( dip::testing::CompareImages( color, result ));
+
+   // Reading a ROI with steps, and with reversed ranges where `start - stop` is not a multiple of `step`
+   std::cout << "\nTEST TIFF -- ROI\n\n";
+   dip::ImageWriteTIFF( image, "test1.tif" );
+   std::vector< std::pair< char const*, dip::RangeArray >> rois{
+         { "steps", { dip::Range{ 3, 250, 4 }, dip::Range{ 10, 200, 6 }}},
+         { "reversed", { dip::Range{ 200, 13, 7 }, dip::Range{ 250, 5, 3 }}},
+         { "one reversed", { dip::Range{ 17, 200, 5 }, dip::Range{ 255, 0, 10 }}}
+   };
+   for( auto const& r : rois ) {
+      dip::RangeArray const& roi = r.second;
+      std::cout << "ROI with " << r.first << std::endl;
+      result = dip::ImageReadTIFF( "test1", dip::Range{ 0 }, roi );
+      std::cout << "Striped: ";
+      Report( dip::testing::CompareImages( image.At( roi ), result ));
+      result = dip::ImageReadTIFF( "test3g", dip::Range{ 0 }, roi );
+      std::cout << "Tiled: ";
+      Report( dip::testing::CompareImages( image.At( roi ), result ));
+      result = dip::ImageReadTIFF( "test3c", dip::Range{ 0 }, roi );
+      std::cout << "Tiled, contiguous samples: ";
+      Report( dip::testing::CompareImages( color.At( roi ), result ));
+      result = dip::ImageReadTIFF( "test3s", dip::Range{ 0 }, roi );
+      std::cout << "Tiled, separate sample planes: ";
+      Report( dip::testing::CompareImages( color.At( roi ), result ));
+   }
+#endif
+
+   // Writing with each compression method, the lossless ones encode strips in multiple threads
+   std::cout << "\nTEST TIFF -- compression\n\n";
+   dip::uint nThreads = dip::GetNumberOfThreads();
+   dip::SetNumberOfThreads( 4 );
+   dip::Random random( 0 );
+   dip::Image large8{ dip::UnsignedArray{ 700, 500 }, 3, dip::DT_UINT8 };
+   large8.Fill( 0 );
+   dip::UniformNoise( large8, large8, random, 0.0, 255.0 );
+   dip::Image large16{ dip::UnsignedArray{ 700, 500 }, 1, dip::DT_UINT16 };
+   large16.Fill( 0 );
+   dip::UniformNoise( large16, large16, random, 0.0, 4000.0 );
+   dip::Image largeF{ dip::UnsignedArray{ 700, 500 }, 1, dip::DT_SFLOAT };
+   largeF.Fill( 0 );
+   dip::GaussianNoise( largeF, largeF, random, 100.0 );
+   for( auto compression : { "none", "deflate", "LZW", "PackBits" } ) {
+      for( dip::Image const* img : { &large8, &large16, &largeF } ) {
+         timer.Reset();
+         dip::ImageWriteTIFF( *img, "test4.tif", compression );
+         timer.Stop();
+         std::cout << "Writing " << img->DataType().Name() << " with " << compression << ": " << timer << std::endl;
+         result = dip::ImageReadTIFF( "test4" );
+         Report( dip::testing::CompareImages( *img, result ));
+      }
+   }
+   // JPEG is lossy, and is not encoded in parallel
+   dip::ImageWriteTIFF( image, "test4.tif", "JPEG", 95 );
+   result = dip::ImageReadTIFF( "test4" );
+   dip::Image difference = dip::Convert( image, dip::DT_SFLOAT ) - dip::Convert( result, dip::DT_SFLOAT );
+   dip::dfloat error = dip::MeanAbs( difference ).As< dip::dfloat >();
+   std::cout << "JPEG, mean absolute error: " << error << std::endl;
+   Report(( image.Sizes() == result.Sizes() ) && ( error < 2.0 ));
+
+#ifdef DIP__HAS_TIFF
+   // Multi-page files, read as a 3D image, in reverse order, and one page at a time
+   std::cout << "\nTEST TIFF -- multi-page\n\n";
+   dip::Image stack{ dip::UnsignedArray{ 300, 200, 12 }, 1, dip::DT_UINT8 };
+   stack.Fill( 0 );
+   dip::UniformNoise( stack, stack, random, 0.0, 255.0 );
+   WriteMultiPageTIFF( stack, "test5.tif" );
+   result = dip::ImageReadTIFF( "test5", dip::Range{ 0, -1 } );
+   std::cout << "All pages: " << result;
+   Report( dip::testing::CompareImages( stack, result ));
+   result = dip::ImageReadTIFF( "test5", dip::Range{ 11, 1, 3 } );
+   std::cout << "Reversed range: " << result;
+   Report( dip::testing::CompareImages( stack.At( dip::Range{}, dip::Range{}, dip::Range{ 11, 1, 3 } ), result ));
+   result = dip::ImageReadTIFF( "test5", dip::Range{ 7 } );
+   dip::Image page = stack.At( dip::Range{}, dip::Range{}, dip::Range{ 7 } );
+   page.Squeeze();
+   std::cout << "Single page: " << result;
+   Report( dip::testing::CompareImages( page, result ));
+   identical = true;
+   dip::uint nPages = 0;
+   dip::ImageReadTIFFPages( "test5", dip::Range{ 10, 0, 2 }, [ & ]( dip::Image& plane, dip::uint index ) {
+      dip::Image expected = stack.At( dip::Range{}, dip::Range{}, dip::Range{ 10 - 2 * static_cast< dip::sint >( index ) } );
+      expected.Squeeze();
+      identical &= dip::testing::CompareImages( expected, plane );
+      ++nPages;
+   } );
+   std::cout << "Pages one at a time, reversed: ";
+   Report( identical && ( nPages == 6 ));
+#endif
+   dip::SetNumberOfThreads( nThreads );
 
-   return 0;
+   return errorCount == 0 ? 0 : 1;
 }